@@ -31,8 +31,9 @@ function reset_state(seq, tracked_state)
     tracked_state.bar_length = nil
     tracked_state.current_bar_length = nil
     tracked_state.delta = 0
-    tracked_state.title = nil
-    tracked_state.rhythm = nil
+    -- text fields already written in this tune (title, rhythm, ...);
+    -- cleared for every tune, so a tune's tokens depend only on itself
+    tracked_state.fields = {}
 end
     
 function update_state(seq, tracked_state, note, duration, is_rest)    
@@ -146,6 +147,7 @@ out_huf = nil  -- output huffman file
 -- - `--timing/--no-timing` preserve the timing changes in the compressed file
 -- - `--bare` turn off everything but the tune itself (no metadata at all)
 -- - `--full` turn on everything (all metadata, including all text)
+-- - `--cache` reuse the tokens of unchanged tunes from <huf_file>.cache
 
 function parse_command_line_args()
    -- set included_elements according to flags    
@@ -171,6 +173,8 @@ function parse_command_line_args()
 
             if k=='debug' then 
                 included_elements.debug = flag
+            elseif k=='cache' then 
+                use_cache = flag
             elseif k=='all-text' then 
                 included_elements.field_text = flag
                 included_elements.title = flag
@@ -219,6 +223,7 @@ function parse_command_line_args()
         io.stderr:write("Options: [--debug] [--all-text] [--no-text] [--title] [--no-title]\n")
         io.stderr:write("         [--rhythm] [--no-rhythm] [--meter] [--no-meter] [--key] [--no-key]\n")
         io.stderr:write("         [--bars] [--no-bars] [--chords] [--no-chords] [--timing] [--no-timing] [--bare] [--full]\n")
+        io.stderr:write("         [--cache]\n")
         os.exit(1)
     end
     return in_abc, out_huf, included_elements
@@ -238,7 +243,7 @@ function code_stream_tune(seq, tracked_state, stream)
             if v.event=='bar' then 
                 table.insert(seq, "|")        
             elseif v.event=="field_text" then 
-                if not tracked_state[v.name] and included_elements[v.name] then                 
+                if not tracked_state.fields[v.name] and included_elements[v.name] then                 
                     table.insert(seq, '*'..v.name)                
                     if v.name=="rhythm" then 
                         table.insert(seq, v.content)
@@ -247,7 +252,7 @@ function code_stream_tune(seq, tracked_state, stream)
                         insert_string(seq, v.content)
                     end                    
                     table.insert(seq, '*')    -- end of text field marker
-                    tracked_state[v.name] = v.content
+                    tracked_state.fields[v.name] = v.content
                 end
             elseif v.event=='key' then 
                 table.insert(seq, '&'..v.key.root..(v.key.mode or 'maj'))
@@ -307,9 +312,16 @@ end
 
 -- output a huffman table in the format
 -- bytes_str bits_code [str] [code padded to byte width]
+-- with the entries in symbol order
 function output_huffman_table(codes)
     local t = {}
+    local symbols = {}
     for str, bin_code in pairs(codes) do
+        table.insert(symbols, str)
+    end
+    table.sort(symbols)
+    for i, str in ipairs(symbols) do
+        local bin_code = codes[str]
         local byte_code = bits_to_bytes(bin_code)        
         table.insert(t, string.char(#str)..string.char(#bin_code)..str..byte_code)    
     end
@@ -328,15 +340,24 @@ function huffman_compress_table(tab)
         local c = tab[i]
         freq[c] = (freq[c] or 0) + 1
     end
-    -- build the tree
+    -- build the tree; ties in frequency are broken by the order the
+    -- nodes were made in (leaves in symbol order), so the same tokens
+    -- always give the same table
+    local symbols = {}
     for i,v in pairs(freq) do
-        table.insert(tree, {v, i})
+        table.insert(symbols, i)
+    end
+    table.sort(symbols)
+    for i,c in ipairs(symbols) do
+        table.insert(tree, {freq[c], c, i})
     end
+    local made = #tree
     while #tree>1 do
-        table.sort(tree, function(a,b) return a[1]<b[1] end)
+        table.sort(tree, function(a,b) return a[1]<b[1] or (a[1]==b[1] and a[3]<b[3]) end)
         local a = table.remove(tree, 1)
         local b = table.remove(tree, 1)
-        table.insert(tree, {a[1]+b[1], {a,b}})
+        made = made + 1
+        table.insert(tree, {a[1]+b[1], {a,b}, made})
     end
     -- build the codes
     local function build_codes(node, prefix)
@@ -382,6 +403,191 @@ function abc_to_tokens(abc_file)
     return seq_out
 end
 
+-- Incremental encoding: each tune's tokens depend only on its own
+-- source, the file header before the first X: field, and the options,
+-- so they can be cached under a hash of those, and only changed tunes
+-- need to be parsed again.
+
+-- split ABC source into the file header and one string per tune,
+-- each starting at its X: line
+function split_abc_tunes(text)
+    local tunes = {}
+    local starts = {}
+    if text:sub(1,2)=="X:" then 
+        table.insert(starts, 1)
+    end
+    local pos = 1
+    while true do 
+        local s = text:find("\nX:", pos, true)
+        if s==nil then break end
+        table.insert(starts, s+1)
+        pos = s+1
+    end
+    if #starts==0 then 
+        return "", {text}
+    end
+    local header = text:sub(1, starts[1]-1)
+    for i=1,#starts do
+        local finish = (starts[i+1] or #text+1) - 1
+        table.insert(tunes, text:sub(starts[i], finish))
+    end
+    return header, tunes
+end
+
+-- hash a string to a hex key, with two polynomial hashes modulo
+-- primes below 2^32 (exact in double arithmetic, so no bit operations
+-- are needed) and the length
+function hash_string(s)
+    local h1, h2 = 0, 0
+    local chunk = 4096
+    for i=1,#s,chunk do
+        local bytes = {s:byte(i, math.min(i+chunk-1, #s))}
+        for j=1,#bytes do
+            h1 = (h1*31 + bytes[j]) % 4294967291
+            h2 = (h2*37 + bytes[j]) % 4294967279
+        end
+    end
+    return string.format("%08x%08x%x", h1, h2, #s)
+end
+
+-- the options that change the token stream, as a string
+function options_signature()
+    local names = {}
+    for k,v in pairs(included_elements) do 
+        if k~='debug' then
+            table.insert(names, k.."="..tostring(v))
+        end
+    end
+    table.sort(names)
+    return table.concat(names, ",")
+end
+
+-- tokenise the tunes in one ABC file, returning a list of token
+-- lists, one per song (empty for songs with no title)
+function abc_to_tune_tokens(abc_file)
+    local songs = parse_abc_file(abc_file)
+    local tunes = {}
+    for i, song in ipairs(songs) do    
+        local seq = {}
+        local state = {}
+        if song.metadata.title then                
+            reset_state(seq, state)
+            for j,voice in pairs(song.voices) do 
+                code_stream_tune(seq, state, voice.stream)
+            end        
+            table.insert(seq, tune_terminator)    
+        end     
+        table.insert(tunes, seq)
+    end
+    return tunes
+end
+
+-- The cache is plain data rather than Lua, so that a tampered cache
+-- cannot run code when it is read:
+--   huf_cache 1\n
+-- then for each tune
+--   <key> <number of tokens>\n <length>:<token> ... \n
+
+-- read a cache written by save_token_cache; if it is missing or
+-- malformed, an empty cache is returned and every tune is encoded
+function load_token_cache(cache_file)
+    local f = io.open(cache_file, "rb")
+    if f==nil then return {} end
+    local text = f:read("*a")
+    f:close()
+    local magic = "huf_cache 1\n"
+    if text:sub(1, #magic)~=magic then return {} end
+    local cache = {}
+    local pos = #magic+1
+    while pos <= #text do
+        local key, n, after = text:match("^(%x+) (%d+)\n()", pos)
+        if key==nil then return {} end
+        pos = after
+        local tokens = {}
+        for i=1,tonumber(n) do
+            local len, start = text:match("^(%d+):()", pos)
+            if len==nil or start+tonumber(len)-1 > #text then return {} end
+            table.insert(tokens, text:sub(start, start+tonumber(len)-1))
+            pos = start+tonumber(len)
+        end
+        if text:sub(pos, pos)~="\n" then return {} end
+        pos = pos+1
+        cache[key] = tokens
+    end
+    return cache
+end
+
+-- write the cache of key -> token list, in the format above
+function save_token_cache(cache_file, cache)
+    local f = io.open(cache_file, "wb")
+    if f==nil then 
+        io.stderr:write("Could not write cache "..cache_file.."\n")
+        return
+    end
+    f:write("huf_cache 1\n")
+    local keys = {}
+    for k,v in pairs(cache) do table.insert(keys, k) end
+    table.sort(keys)
+    for i,k in ipairs(keys) do 
+        local parts = {}
+        for j,token in ipairs(cache[k]) do 
+            table.insert(parts, #token..":"..token)
+        end
+        f:write(k.." "..#cache[k].."\n"..table.concat(parts).."\n")
+    end
+    f:close()
+end
+
+-- as abc_to_tokens, but reusing the tokens of tunes whose source,
+-- file header and options are unchanged since the last run. Changed
+-- tunes are parsed one at a time, each written with the file header
+-- to a temporary file. The cache is rewritten with only the tunes
+-- in this file.
+function abc_to_tokens_cached(abc_file, cache_file)
+    local f = io.open(abc_file, "rb")
+    if f==nil then 
+        io.stderr:write("Could not open "..abc_file.."\n")
+        os.exit(1)
+    end
+    local text = f:read("*a")
+    f:close()
+    local header, tunes = split_abc_tunes(text)
+    local context = hash_string(header.."\0"..options_signature())
+    local old_cache = load_token_cache(cache_file)
+    local new_cache = {}
+    local seq_out = {}
+    local reused = 0
+    for i, tune in ipairs(tunes) do 
+        local key = context..hash_string(tune)
+        local tokens = old_cache[key] or new_cache[key]
+        if tokens then 
+            reused = reused + 1
+        else
+            local tmp = os.tmpname()
+            local tf = io.open(tmp, "wb")
+            tf:write(header..tune)
+            tf:close()
+            tokens = {}
+            for j, seq in ipairs(abc_to_tune_tokens(tmp)) do
+                for k, token in ipairs(seq) do 
+                    table.insert(tokens, token)
+                end
+            end
+            os.remove(tmp)
+        end
+        new_cache[key] = tokens
+        for k, token in ipairs(tokens) do 
+            table.insert(seq_out, token)
+        end
+    end
+    -- double end-of-tune indicates end of all tunes
+    table.insert(seq_out, tune_terminator)    
+    table.insert(seq_out, tune_terminator)
+    save_token_cache(cache_file, new_cache)
+    io.stderr:write(#tunes.." tunes, "..reused.." from cache, "..(#tunes-reused).." encoded\n")
+    return seq_out
+end
+
 function bytes_to_hex(s)
     local t = {}
     for i=1,#s do
@@ -412,7 +618,11 @@ end
 
 -- main
 in_abc, out_file, included_elements = parse_command_line_args()
-seq_out = abc_to_tokens(in_abc)
+if use_cache then 
+    seq_out = abc_to_tokens_cached(in_abc, out_file..".cache")
+else
+    seq_out = abc_to_tokens(in_abc)
+end
 bit_stream, codes = huffman_compress_table(seq_out)
 code_count = table_len(codes)
 byte_stream = bits_to_bytes(bit_stream)
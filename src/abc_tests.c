@@ -3,7 +3,8 @@
 #include <stdint.h>
 #include "huffman.h"
 #include "huffman_tunes.h"
-void wav_callback(tune_context *ctx, uint32_t event_code);
+#include "huffman_validate.h"
+#include "wav_writer.h"
 void note_callback(tune_context *ctx, uint32_t event_code);
 
 void dump_tune(huffman_buffer *h_buffer)
@@ -17,7 +18,7 @@ void dump_tune(huffman_buffer *h_buffer)
             printf("Error: invalid code\n");
             break;
         }
-        printf("%s ", h_buffer->table->entries[symbol]->token_string);
+        printf("%s ", TOKEN_STRING(h_buffer->table, symbol));
     }
 }
 
@@ -44,15 +45,19 @@ int main(int argc, char **argv)
     fread(buf, 1, file_size, fp);
     fclose(fp);
 
-    /* Read the huffman table */
-    h_buffer = read_huffman(buf);
+    /* Validate and read the huffman table */
+    h_buffer = load_huffman((uint8_t*)buf, file_size);
+    if(h_buffer==NULL) {
+        printf("Error: invalid file %s\n", argv[1]);
+        return 1;
+    }
 
     /* Print out the size of the table, the number of bits in the compressed data, and the table itself */
     printf("Table size: %d\n", h_buffer->table->n_entries);
     printf("Compressed data size: %d\n", h_buffer->n_bits);
     uint32_t i;
     for(i=0; i<h_buffer->table->n_entries; i++) {
-         printf("%s %d %d\n", h_buffer->table->entries[i]->token_string,  h_buffer->table->entries[i]->n_bits, h_buffer->table->entries[i]->code);
+         printf("%s %d %d\n", TOKEN_STRING(h_buffer->table, i),  h_buffer->table->n_bits[i], h_buffer->table->codes[i]);
     }
 
     /* Decode all of the symbols until we reach the end of the buffer */
@@ -62,7 +67,7 @@ int main(int argc, char **argv)
     //         printf("Error: invalid code\n");
     //         break;
     //     }
-    //     printf("%s ", h_buffer->table->entries[symbol]->token_string);
+    //     printf("%s ", TOKEN_STRING(h_buffer->table, symbol));
     // }
 
     
@@ -96,7 +101,19 @@ int main(int argc, char **argv)
     printf("\nSeeking to tune 0\n");
     //parse_tune(h_buffer, NULL);
     seek_to_tune(atoi(argv[2]), index, h_buffer);
-    parse_tune(h_buffer, wav_callback);
+#ifdef HUF_STATS
+    /* Count only the rendering of the selected tune */
+    huf_stats stats;
+    reset_stats(&stats);
+    h_buffer->stats = &stats;
+#endif
+    /* Sized up front from the tune's summary, so this could be a pipe */
+    fp = fopen("tune.wav", "wb");
+    write_tune_wav(h_buffer, NULL, index, atoi(argv[2]), fp);
+    fclose(fp);
+#ifdef HUF_STATS
+    dump_stats(&stats, stdout);
+#endif
     
 
     
@@ -18,26 +18,39 @@ void write_u8(FILE *f, uint8_t val)
     write_bytes(f, &val, 1);
 }
 
+/* All words are little endian, whatever the host */
+static void write_le(FILE *f, uint64_t val, uint32_t n_bytes)
+{
+    uint8_t buf[8];
+    uint32_t i;
+    for(i=0; i<n_bytes; i++) {
+        buf[i] = val & 0xFF;
+        val >>= 8;
+    }
+    write_bytes(f, buf, n_bytes);
+}
+
 void write_u16(FILE *f, uint16_t val)
 {
     /* Write a uint16_t to the file */
-    write_bytes(f, &val, 2);
+    write_le(f, val, 2);
 }
 
 void write_u32(FILE *f, uint32_t val)
 {
     /* Write a uint32_t to the file */
-    write_bytes(f, &val, 4);
+    write_le(f, val, 4);
 }
 
 void write_u64(FILE *f, uint64_t val)
 {
     /* Write a uint64_t to the file */
-    write_bytes(f, &val, 8);
+    write_le(f, val, 8);
 }
 
 
-/* Read words from a memory buffer */
+/* Read words from a memory buffer. These read byte by byte, so
+the buffer need not be aligned, and are little endian on any host */
 uint8_t readbuf_u8(uint8_t **buf)
 {
     /* Read a uint8_t from the buffer */
@@ -49,7 +62,8 @@ uint8_t readbuf_u8(uint8_t **buf)
 uint16_t readbuf_u16(uint8_t **buf)
 {
     /* Read a uint16_t from the buffer */
-    uint16_t val = *((uint16_t*)*buf);
+    uint8_t *p = *buf;
+    uint16_t val = p[0] | (uint16_t)p[1]<<8;
     *buf += 2;
     return val;
 }
@@ -57,7 +71,8 @@ uint16_t readbuf_u16(uint8_t **buf)
 uint32_t readbuf_u32(uint8_t **buf)
 {
     /* Read a uint32_t from the buffer */
-    uint32_t val = *((uint32_t*)*buf);
+    uint8_t *p = *buf;
+    uint32_t val = p[0] | (uint32_t)p[1]<<8 | (uint32_t)p[2]<<16 | (uint32_t)p[3]<<24;
     *buf += 4;
     return val;
 }
@@ -65,7 +80,9 @@ uint32_t readbuf_u32(uint8_t **buf)
 uint64_t readbuf_u64(uint8_t **buf)
 {
     /* Read a uint64_t from the buffer */
-    uint64_t val = *((uint64_t*)*buf);
+    uint8_t *p = *buf;
+    uint64_t val = readbuf_u32(&p);
+    val |= (uint64_t)readbuf_u32(&p)<<32;
     *buf += 8;
     return val;
 }
@@ -86,3 +103,47 @@ void readbuf_bytes(uint8_t **buf, uint8_t *dest, uint32_t n_bytes)
     *buf += n_bytes;
 }
 
+/* Write words to a memory buffer */
+void writebuf_u8(uint8_t **buf, uint8_t val)
+{
+    /* Write a uint8_t to the buffer */
+    **buf = val;
+    *buf += 1;
+}
+
+void writebuf_u32(uint8_t **buf, uint32_t val)
+{
+    /* Write a little endian uint32_t to the buffer */
+    uint8_t *p = *buf;
+    p[0] = val & 0xFF;
+    p[1] = (val>>8) & 0xFF;
+    p[2] = (val>>16) & 0xFF;
+    p[3] = (val>>24) & 0xFF;
+    *buf += 4;
+}
+
+/* Read a whole file into memory */
+uint8_t *load_file(const char *fname, uint32_t *size)
+{
+    /* Return a malloc'd copy of the file, setting *size, or NULL on failure */
+    FILE *fp = fopen(fname, "rb");
+    uint8_t *buf;
+    long file_size;
+    if(!fp) {
+        printf("Error: could not open file %s\n", fname);
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    buf = malloc(file_size);
+    if(fread(buf, 1, file_size, fp)!=(size_t)file_size) {
+        printf("Error: could not read file %s\n", fname);
+        free(buf);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *size = file_size;
+    return buf;
+}
@@ -12,5 +12,8 @@ uint32_t readbuf_u32(uint8_t **buf);
 uint64_t readbuf_u64(uint8_t **buf);
 char *readbuf_string(uint8_t **buf);
 void readbuf_bytes(uint8_t **buf, uint8_t *dest, uint32_t n_bytes);
+void writebuf_u8(uint8_t **buf, uint8_t val);
+void writebuf_u32(uint8_t **buf, uint32_t val);
+uint8_t *load_file(const char *fname, uint32_t *size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_sections.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "book_archive.h"
+#include "binary.h"
+
+/* Many books under one table. Opening an archive loads the table once;
+moving to any tune of any book is then two reads from the sections. */
+
+static uint8_t *book_record(book_archive *archive, uint32_t book)
+{
+    /* The directory record for a book */
+    return archive->books + 4 + 12*book;
+}
+
+static int check_archive(book_archive *archive, uint32_t index_length, uint32_t books_length)
+{
+    /* Check the index and directory lie within their sections and agree
+    with each other and the data, so nothing after this is bounds checked */
+    uint8_t *p;
+    uint32_t *index;
+    uint32_t i, first, n, name_offset;
+    int good;
+
+    if(index_length < 4 || books_length < 4) {
+        printf("Error: truncated archive sections\n");
+        return 0;
+    }
+    /* The index is checked as a single book's is, on a copy of its words */
+    n = index_length/4;
+    index = malloc(sizeof(uint32_t)*n);
+    p = archive->tune_index;
+    for(i=0; i<n; i++)
+        index[i] = readbuf_u32(&p);
+    good = index_length%4==0 && check_tune_index(index, n, archive->buffer->n_bits);
+    archive->n_tunes = index[0];
+    free(index);
+    if(!good) {
+        printf("Error: tune index does not match the data\n");
+        return 0;
+    }
+    p = archive->books;
+    archive->n_books = readbuf_u32(&p);
+    if(archive->n_books > (books_length-4)/12) {
+        printf("Error: truncated book directory\n");
+        return 0;
+    }
+    for(i=0; i<archive->n_books; i++) {
+        first = readbuf_u32(&p);
+        n = readbuf_u32(&p);
+        name_offset = readbuf_u32(&p);
+        if(first > archive->n_tunes || n > archive->n_tunes-first) {
+            printf("Error: book %d tunes out of range\n", i);
+            return 0;
+        }
+        if(name_offset >= books_length || archive->books[name_offset] > books_length-name_offset-1) {
+            printf("Error: book %d name out of range\n", i);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+book_archive *open_archive(uint8_t *buf, uint32_t size)
+{
+    /* Validate and open an archive held in the size bytes at buf, which
+    must stay in memory until close_archive. Returns NULL if it is not a
+    valid archive. */
+    book_archive *archive;
+    uint32_t index_length, books_length;
+    huffman_buffer *buffer = load_huffman(buf, size);
+
+    if(buffer==NULL)
+        return NULL;
+    archive = malloc(sizeof(book_archive));
+    archive->buffer = buffer;
+    archive->tune_index = find_section(buffer, buf+size, TUNE_INDEX_TAG, &index_length);
+    archive->books = find_section(buffer, buf+size, BOOK_DIRECTORY_TAG, &books_length);
+    if(archive->tune_index==NULL || archive->books==NULL) {
+        printf("Error: not an archive (no tune index or book directory)\n");
+        close_archive(archive);
+        return NULL;
+    }
+    if(!check_archive(archive, index_length, books_length)) {
+        close_archive(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+uint32_t archive_tune_count(book_archive *archive, uint32_t book)
+{
+    /* The number of tunes in a book, or 0 if there is no such book */
+    uint8_t *p;
+    if(book >= archive->n_books)
+        return 0;
+    p = book_record(archive, book) + 4;
+    return readbuf_u32(&p);
+}
+
+uint32_t archive_global_tune(book_archive *archive, uint32_t book, uint32_t tune)
+{
+    /* The index across the whole archive of a tune in a book,
+    or INVALID_CODE if there is no such tune */
+    uint8_t *p;
+    uint32_t first;
+    if(tune >= archive_tune_count(archive, book))
+        return INVALID_CODE;
+    p = book_record(archive, book);
+    first = readbuf_u32(&p);
+    return first + tune;
+}
+
+int archive_seek(book_archive *archive, uint32_t book, uint32_t tune)
+{
+    /* Move the archive's buffer to the start of a tune in a book.
+    Returns 1 on success, 0 if there is no such tune. */
+    uint32_t ix = archive_global_tune(archive, book, tune);
+    uint8_t *p;
+    if(ix==INVALID_CODE) {
+        printf("Error: no tune %d in book %d\n", tune, book);
+        return 0;
+    }
+    p = archive->tune_index + 4 + 4*ix;
+    archive->buffer->pos = readbuf_u32(&p);
+    return 1;
+}
+
+void archive_book_name(book_archive *archive, uint32_t book, char *name)
+{
+    /* Copy the name of a book into name, which must have room
+    for 256 characters; the name is empty if there is no such book */
+    uint8_t *p;
+    uint32_t name_offset;
+    name[0] = '\0';
+    if(book >= archive->n_books)
+        return;
+    p = book_record(archive, book) + 8;
+    name_offset = readbuf_u32(&p);
+    p = archive->books + name_offset;
+    memcpy(name, p+1, p[0]);
+    name[p[0]] = '\0';
+}
+
+uint32_t find_book(book_archive *archive, const char *name)
+{
+    /* The number of the book called name, or INVALID_CODE */
+    uint32_t i, len = strlen(name), name_offset;
+    uint8_t *p;
+    for(i=0; i<archive->n_books; i++) {
+        p = book_record(archive, i) + 8;
+        name_offset = readbuf_u32(&p);
+        p = archive->books + name_offset;
+        if(p[0]==len && !memcmp(p+1, name, len))
+            return i;
+    }
+    return INVALID_CODE;
+}
+
+void close_archive(book_archive *archive)
+{
+    /* Free the archive; the file data itself belongs to the caller */
+    free_huffman_table(archive->buffer->table);
+    free(archive->buffer);
+    free(archive);
+}
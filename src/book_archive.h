@@ -0,0 +1,40 @@
+#ifndef BOOK_ARCHIVE_H
+#define BOOK_ARCHIVE_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+#define BOOK_DIRECTORY_TAG "BOOK"
+
+/*
+    An archive is an ordinary HUFM file holding the tunes of several books
+    under one shared table, one book after another in the data. It must
+    have a tune index section (TIDX) covering every tune, and a book
+    directory section:
+        [n_books:u32] [record:u32*3*n_books] [names]
+    Each record:
+        [first tune (global index):u32] [n_tunes:u32] [name offset from start of payload:u32]
+    Each name:
+        [N:u8] [name:u8*N]
+    Both sections are read in place, so the whole archive can be mapped
+    into memory and used without copying anything but the table.
+*/
+
+typedef struct book_archive
+{
+    huffman_buffer *buffer;
+    uint8_t *tune_index; /* TIDX payload */
+    uint32_t n_tunes; /* in all books */
+    uint8_t *books; /* BOOK payload */
+    uint32_t n_books;
+} book_archive;
+
+book_archive *open_archive(uint8_t *buf, uint32_t size);
+uint32_t archive_tune_count(book_archive *archive, uint32_t book);
+uint32_t archive_global_tune(book_archive *archive, uint32_t book, uint32_t tune);
+int archive_seek(book_archive *archive, uint32_t book, uint32_t tune);
+void archive_book_name(book_archive *archive, uint32_t book, char *name);
+uint32_t find_book(book_archive *archive, const char *name);
+void close_archive(book_archive *archive);
+
+#endif
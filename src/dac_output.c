@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "synth.h"
+#include "dac_output.h"
+
+/* Pull-model playback: symbols are decoded only when the oscillator
+has finished the previous note, so at most one note's worth of
+decoding is done per refill, and none at all in the interrupt. */
+
+void init_dac_output(dac_output *out, uint8_t *half_0, uint8_t *half_1, uint32_t buffer_samples, uint8_t bits, uint32_t sample_rate)
+{
+    /* Set up the output with two caller-supplied halves, both silent.
+    Half 0 is played first. */
+    out->halves[0] = half_0;
+    out->halves[1] = half_1;
+    out->buffer_samples = buffer_samples;
+    out->bits = bits==8 ? 8 : 16;
+    memset(half_0, 0, buffer_samples*(out->bits/8));
+    memset(half_1, 0, buffer_samples*(out->bits/8));
+    out->ready[0] = 1;
+    out->ready[1] = 1;
+    out->playing = 0;
+    out->underruns = 0;
+    out->request = NULL;
+    out->request_context = NULL;
+    init_synth(&out->synth, sample_rate, SYNTH_AMPLITUDE);
+    out->buffer = NULL;
+    out->ctx = NULL;
+    out->in_tune = 0;
+}
+
+static void dac_callback(tune_context *ctx, uint32_t event_code)
+{
+    /* Pass notes and rests to the oscillator */
+    dac_output *out = (dac_output*)ctx->callback_context;
+    if(event_code==EVENT_NOTE)
+        synth_note(&out->synth, ctx->current_note, ctx->current_duration, 0);
+    else if(event_code==EVENT_REST)
+        synth_note(&out->synth, 0, ctx->current_duration, 1);
+}
+
+void dac_start_tune(dac_output *out, huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix, tune_context *ctx)
+{
+    /* Start tune ix, decoding with ctx (which can be static: see
+    init_context). Takes over ctx's callback. Call from the main loop,
+    not while dac_refill may be running. */
+    if(ix>=tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return;
+    }
+    out->buffer = buffer;
+    out->ctx = ctx;
+    ctx->event_callback = dac_callback;
+    ctx->callback_context = out;
+    buffer->pos = tune_index[ix+1];
+    out->synth.samples_left = 0;
+    begin_tune(ctx);
+    out->in_tune = 1;
+}
+
+uint8_t *dac_isr(dac_output *out)
+{
+    /* The hardware has finished playing the current half: hand back the
+    other half to play, and mark this one for refilling */
+    uint8_t done = out->playing;
+    uint8_t next = done ^ 1;
+    if(!out->ready[next])
+        out->underruns++;
+    out->ready[done] = 0;
+    out->playing = next;
+    if(out->request)
+        out->request(out->request_context);
+    return out->halves[next];
+}
+
+static void fill_half(dac_output *out, uint8_t *dest)
+{
+    /* Synthesise a whole half, decoding notes as the oscillator needs them */
+    uint32_t done = 0, bytes = out->bits/8;
+    while(done < out->buffer_samples) {
+        if(out->synth.samples_left==0) {
+            if(out->in_tune) {
+                out->in_tune = step_tune(out->buffer, out->ctx);
+                continue;
+            }
+            /* Tune over: pad with silence */
+            memset(dest+done*bytes, 0, (out->buffer_samples-done)*bytes);
+            break;
+        }
+        done += synth_render(&out->synth, dest+done*bytes, out->buffer_samples-done, out->bits);
+    }
+}
+
+int dac_refill(dac_output *out)
+{
+    /* Fill any half that has been played; returns the number filled */
+    int filled = 0;
+    uint8_t i;
+    for(i=0; i<2; i++) {
+        if(!out->ready[i] && out->playing!=i) {
+            fill_half(out, out->halves[i]);
+            out->ready[i] = 1;
+            filled++;
+        }
+    }
+    return filled;
+}
+
+int dac_finished(dac_output *out)
+{
+    /* 1 once the tune has been fully synthesised (the last half may
+    still be playing) */
+    return !out->in_tune && out->synth.samples_left==0;
+}
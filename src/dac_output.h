@@ -0,0 +1,50 @@
+#ifndef DAC_OUTPUT_H
+#define DAC_OUTPUT_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "synth.h"
+
+/*
+    Double-buffered sample output for a DMA-fed DAC or PWM timer.
+    The hardware plays one half while dac_refill fills the other:
+
+    - dac_isr is called from the interrupt raised when a half has been
+      played (DMA half/full transfer, or a timer counting out the samples).
+      It only swaps halves and flips flags, and returns the half to
+      play next. If that half is not ready it is played anyway, and
+      counted as an underrun.
+    - dac_refill decodes and synthesises into any half that has been
+      played. It touches only the dac_output, allocates nothing and does
+      no I/O, so it can run in the main loop, or in a lower-priority
+      interrupt pended from dac_isr via the request callback.
+
+    All storage is supplied by the caller.
+*/
+
+typedef void(*dac_request_type)(void *request_context);
+
+typedef struct dac_output
+{
+    uint8_t *halves[2]; /* each buffer_samples * bits/8 bytes */
+    uint32_t buffer_samples;
+    uint8_t bits; /* 8 (unsigned) or 16 */
+    volatile uint8_t ready[2]; /* set by dac_refill, cleared by dac_isr */
+    volatile uint8_t playing; /* the half the hardware is reading */
+    volatile uint32_t underruns;
+    dac_request_type request; /* NULL, or called from dac_isr when a half needs refilling */
+    void *request_context;
+    square_synth synth;
+    huffman_buffer *buffer;
+    tune_context *ctx;
+    uint8_t in_tune; /* 1 while there are symbols of the tune still to decode */
+} dac_output;
+
+void init_dac_output(dac_output *out, uint8_t *half_0, uint8_t *half_1, uint32_t buffer_samples, uint8_t bits, uint32_t sample_rate);
+void dac_start_tune(dac_output *out, huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix, tune_context *ctx);
+uint8_t *dac_isr(dac_output *out);
+int dac_refill(dac_output *out);
+int dac_finished(dac_output *out);
+
+#endif
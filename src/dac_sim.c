@@ -0,0 +1,179 @@
+/* Host-side stand-in for the DMA interrupt that drives dac_output, to
+check that decoding and synthesis keep up at a given sample rate.
+
+    dac_sim [--rate <hz>] [--bits 8|16] [--samples <n>] [--speed <x>] in.huf <tune> [out.raw]
+
+A SIGALRM timer fires once per half (samples/rate seconds, divided by
+--speed to emulate a slower processor) and calls dac_isr, as the DMA
+interrupt would; the main loop calls dac_refill. The halves played are
+written to out.raw, if given, as raw unsigned 8 bit or 16 bit samples.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "dac_output.h"
+#include "binary.h"
+
+static dac_output sim_output;
+static int raw_fd = -1;
+static volatile sig_atomic_t halves_played = 0;
+
+void usage()
+{
+    printf("Usage: dac_sim [--rate <hz>] [--bits 8|16] [--samples <n>] [--speed <x>] <in.huf> <tune> [out.raw]\n");
+}
+
+static void timer_isr(int sig)
+{
+    /* The half being played has finished: record it, and switch */
+    uint8_t *played = sim_output.halves[sim_output.playing];
+    (void)sig;
+    if(raw_fd>=0)
+        if(write(raw_fd, played, sim_output.buffer_samples*(sim_output.bits/8)) < 0)
+            raw_fd = -1;
+    dac_isr(&sim_output);
+    halves_played++;
+}
+
+static uint64_t now_ns()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+}
+
+static int needs_refill(dac_output *out)
+{
+    return (!out->ready[0] && out->playing!=0) || (!out->ready[1] && out->playing!=1);
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *tune_arg = NULL, *raw_name = NULL;
+    uint32_t rate = 22050, samples = 256, size, *index;
+    int bits = 8, i, end_halves = -1;
+    double speed = 1.0, period_us;
+    uint8_t *buf, *half_0, *half_1;
+    uint64_t t0, dt, busy = 0, worst = 0, start;
+    uint32_t refills = 0;
+    huffman_buffer *h_buffer;
+    tune_context *ctx;
+    struct sigaction sa;
+    struct itimerval timer;
+    sigset_t block, old;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--rate") && i+1<argc)
+            rate = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--bits") && i+1<argc)
+            bits = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--samples") && i+1<argc)
+            samples = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--speed") && i+1<argc)
+            speed = atof(argv[++i]);
+        else if(in_name==NULL)
+            in_name = argv[i];
+        else if(tune_arg==NULL)
+            tune_arg = argv[i];
+        else if(raw_name==NULL)
+            raw_name = argv[i];
+    }
+    if(in_name==NULL || tune_arg==NULL || rate==0 || samples==0 || speed<=0 || (bits!=8 && bits!=16)) {
+        usage();
+        return 1;
+    }
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    index = load_tune_index(h_buffer, buf+size);
+    if((uint32_t)atoi(tune_arg)>=index[0]) {
+        printf("Error: tune index out of range\n");
+        return 1;
+    }
+    if(raw_name) {
+        raw_fd = open(raw_name, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        if(raw_fd<0) {
+            printf("Error: could not open file %s\n", raw_name);
+            return 1;
+        }
+    }
+
+    half_0 = malloc(samples*(bits/8));
+    half_1 = malloc(samples*(bits/8));
+    init_dac_output(&sim_output, half_0, half_1, samples, bits, rate);
+    ctx = new_context();
+    dac_start_tune(&sim_output, h_buffer, index, atoi(tune_arg), ctx);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = timer_isr;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+    sigemptyset(&block);
+    sigaddset(&block, SIGALRM);
+
+    period_us = samples*1e6/rate/speed;
+    timer.it_interval.tv_sec = (long)(period_us/1e6);
+    timer.it_interval.tv_usec = (long)period_us % 1000000;
+    if(timer.it_interval.tv_sec==0 && timer.it_interval.tv_usec==0)
+        timer.it_interval.tv_usec = 1;
+    timer.it_value = timer.it_interval;
+    start = now_ns();
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    while(1) {
+        /* Refill with the timer live, as the interrupt would preempt it */
+        t0 = now_ns();
+        if(dac_refill(&sim_output)) {
+            dt = now_ns()-t0;
+            busy += dt;
+            if(dt>worst)
+                worst = dt;
+            refills++;
+        }
+        /* Once synthesis is done, let both halves play out */
+        if(end_halves<0 && dac_finished(&sim_output))
+            end_halves = halves_played+2;
+        if(end_halves>=0 && halves_played>=end_halves)
+            break;
+        /* Sleep until the next interrupt */
+        sigprocmask(SIG_BLOCK, &block, &old);
+        if(!needs_refill(&sim_output) && !(end_halves>=0 && halves_played>=end_halves))
+            sigsuspend(&old);
+        sigprocmask(SIG_SETMASK, &old, NULL);
+    }
+    timer.it_interval.tv_sec = timer.it_interval.tv_usec = 0;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    printf("%d halves of %d samples at %d Hz, %d bit, speed %gx (%.2f s)\n", (int)halves_played, samples, rate, bits,
+           speed, (now_ns()-start)/1e9);
+    printf("refill: %d calls, mean %.1f us, worst %.1f us, of a %.1f us period\n", refills,
+           refills ? busy/1e3/refills : 0.0, worst/1e3, period_us);
+    printf("load: %.2f%%\n", 100.0*busy/(now_ns()-start));
+    printf("underruns: %d\n", sim_output.underruns);
+
+    if(raw_fd>=0)
+        close(raw_fd);
+    free_context(ctx);
+    free(half_0);
+    free(half_1);
+    free(index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return sim_output.underruns ? 2 : 0;
+}
@@ -0,0 +1,292 @@
+/* Fuzz target for load_huffman and everything that reads a loaded file.
+
+    make fuzz LIBFUZZER=1 && ./fuzz_load corpus/       (clang, libFuzzer)
+    make fuzz && ./fuzz_load [--runs <n>] [--seed <n>] seed.huf...   (any compiler)
+
+Both builds use AddressSanitizer and UBSan. Each input is validated
+whole with validate_huffman, then opened as huf_server opens it (only
+the table checked up front) and, if that is accepted, used as a player
+would, unchecked tunes included: the tune index is loaded and every
+tune checked, the catalogue, title directory and phrase index are read
+and searched, and every tune is parsed, header scanned and summarised
+from its offset; the summary and checksum sections are read too.
+Validation promises none of this can read out of bounds or hang, so any
+sanitizer report or timeout is a validation bug. So is a lookup table
+that decodes differently from read_symbol_checked, which is compared
+over the first FUZZ_COMPARE_SYMBOLS symbols and aborts on a difference.
+
+Good seeds are the example books, with and without huf_index sections,
+and the hand-built files in fuzz_seeds/:
+    deep_codes.huf    codes down to 30 bits, needing a 2 M entry lookup
+                      table: loads
+    lut_overflow.huf  two chains of 32 bit codes, whose lookup table
+                      would need 16 M entries: refused
+    phrase_wrap.huf   p_hardy.huf with a phrase index whose posting list
+                      for "2 2 1 2" goes past the last tune and wraps
+                      round: searched by a full scan
+
+The standalone driver runs each seed file unchanged, then --runs
+(default 10000) mutations of it: bytes overwritten, bits flipped, runs
+of bytes duplicated or cut, and truncation. The input that failed is
+written to fuzz_crash.huf (on a sanitizer report or abort, or if one
+input takes longer than FUZZ_TIMEOUT seconds).
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "title_directory.h"
+#include "phrase_index.h"
+#include "tune_summary.h"
+#include "huffman_crc.h"
+#include "binary.h"
+
+#define FUZZ_TIMEOUT 10 /* seconds for one input */
+#define FUZZ_COMPARE_SYMBOLS 4096
+
+static void compare_decoders(huffman_buffer *buffer)
+{
+    /* Decode from the start with the lookup table and bit by bit,
+    aborting if they ever disagree */
+    huffman_buffer fast = *buffer, slow = *buffer;
+    uint32_t i, a, b;
+    fast.pos = slow.pos = 0;
+    for(i=0; i<FUZZ_COMPARE_SYMBOLS; i++) {
+        b = read_symbol_checked(&slow);
+        if(b==INVALID_CODE)
+            break;
+        a = read_symbol_unchecked(&fast);
+        if(a!=b || fast.pos!=slow.pos) {
+            fprintf(stderr, "Error: lookup table decodes symbol %u as %u\n", b, a);
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    huffman_buffer *buffer;
+    tune_context *ctx;
+    tune_summary summary;
+    tune_metadata *catalogue;
+    title_directory *dir;
+    phrase_index *phrases;
+    phrase_match found[4];
+    int8_t intervals[4] = {2, 2, 1, 2};
+    uint32_t matches[4];
+    crc_check *check;
+    uint32_t *tune_index, i;
+    uint8_t *buf, *end, *summaries;
+
+    if(size > 0xFFFFFFFF)
+        return 0;
+    /* A private copy, so reads past the end are caught */
+    buf = malloc(size ? size : 1);
+    memcpy(buf, data, size);
+    end = buf+size;
+    validate_huffman(buf, (uint32_t)size);
+    /* Then as huf_server loads it: only the table checked up front */
+    buffer = open_huffman(buf, (uint32_t)size);
+    if(buffer==NULL) {
+        free(buf);
+        return 0;
+    }
+    if(!check_huffman_table(buffer)) {
+        free_huffman_table(buffer->table);
+        free(buffer);
+        free(buf);
+        return 0;
+    }
+    compare_decoders(buffer);
+    tune_index = load_tune_index(buffer, end);
+    for(i=0; i<tune_index[0]; i++)
+        check_huffman_tune(buffer, tune_index, i);
+    summaries = load_summary_section(buffer, end, tune_index[0]);
+    ctx = new_context();
+    ctx->event_callback = NULL;
+    for(i=0; i<tune_index[0]; i++) {
+        seek_to_tune(i, tune_index, buffer);
+        parse_tune_context(buffer, ctx);
+        seek_to_tune(i, tune_index, buffer);
+        scan_tune_header(buffer, ctx);
+        get_tune_summary(buffer, summaries, tune_index, i, SUMMARY_SAMPLE_RATE, &summary);
+    }
+    free_context(ctx);
+    catalogue = read_catalogue(buffer, end, tune_index);
+    free(catalogue);
+    dir = load_title_directory(buffer, end, tune_index[0]);
+    if(dir) {
+        find_tune_by_title(dir, "the");
+        find_tunes_by_prefix(dir, "a", matches, 4);
+        free_title_directory(dir);
+    }
+    phrases = load_phrase_index(buffer, end);
+    if(phrases) {
+        find_phrase(phrases, buffer, tune_index, intervals, NULL, 4, found, 4);
+        free_phrase_index(phrases);
+    }
+    check = load_crc_check(buf, buffer, end);
+    if(check) {
+        for(i=0; i<tune_index[0]; i++)
+            check_tune(check, tune_index, i, buffer->n_bits);
+        check_all(check);
+        free_crc_check(check);
+    }
+    free(tune_index);
+    free_huffman_table(buffer->table);
+    free(buffer);
+    free(buf);
+    return 0;
+}
+
+#ifndef HUF_LIBFUZZER
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+static const uint8_t *current_input;
+static size_t current_size;
+
+static void save_input()
+{
+    /* Write the input being run to fuzz_crash.huf; async-signal-safe */
+    int fd = open("fuzz_crash.huf", O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    ssize_t written;
+    if(fd>=0) {
+        written = write(fd, current_input, current_size);
+        (void)written;
+        close(fd);
+    }
+}
+
+/* Called by AddressSanitizer before it reports an error */
+void __asan_on_error()
+{
+    save_input();
+}
+
+static void on_timeout(int sig)
+{
+    static const char message[] = "Error: input timed out; saved to fuzz_crash.huf\n";
+    ssize_t written;
+    (void)sig;
+    save_input();
+    written = write(2, message, sizeof(message)-1);
+    (void)written;
+    _exit(1);
+}
+
+static void on_abort(int sig)
+{
+    static const char message[] = "Error: input aborted; saved to fuzz_crash.huf\n";
+    ssize_t written;
+    (void)sig;
+    save_input();
+    written = write(2, message, sizeof(message)-1);
+    (void)written;
+    _exit(1);
+}
+
+static void run_input(const uint8_t *data, size_t size)
+{
+    current_input = data;
+    current_size = size;
+    alarm(FUZZ_TIMEOUT);
+    LLVMFuzzerTestOneInput(data, size);
+    alarm(0);
+}
+
+static size_t mutate(const uint8_t *seed, size_t size, uint8_t *out, size_t max_size)
+{
+    /* Write a mutation of seed to out, returning its size */
+    size_t n = size, at, len, k, i;
+    uint32_t n_changes = 1 + rand()%4;
+    memcpy(out, seed, size);
+    while(n_changes--) {
+        if(n==0)
+            break;
+        at = rand()%n;
+        switch(rand()%5) {
+            case 0: /* overwrite a byte */
+                out[at] = rand();
+                break;
+            case 1: /* flip a bit */
+                out[at] ^= 1<<(rand()%8);
+                break;
+            case 2: /* small numbers where lengths and counts live */
+                out[at] = rand()%4 ? rand()%3 : 0xFF;
+                break;
+            case 3: /* duplicate a run of bytes */
+                len = 1 + rand()%16;
+                if(at+len > n)
+                    len = n-at;
+                if(n+len > max_size)
+                    break;
+                memmove(out+at+len, out+at, n-at);
+                n += len;
+                break;
+            case 4: /* cut a run of bytes, or truncate */
+                if(rand()%4==0) {
+                    n = at;
+                    break;
+                }
+                len = 1 + rand()%16;
+                if(at+len > n)
+                    len = n-at;
+                for(k=at, i=at+len; i<n; k++, i++)
+                    out[k] = out[i];
+                n -= len;
+                break;
+        }
+    }
+    return n;
+}
+
+void usage()
+{
+    printf("Usage: fuzz_load [--runs <n>] [--seed <n>] <seed.huf>...\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t runs = 10000, seed = 1, size, r;
+    uint8_t *buf, *input;
+    size_t n;
+    int a, n_files = 0;
+
+    signal(SIGALRM, on_timeout);
+    signal(SIGABRT, on_abort);
+    for(a=1; a<argc; a++) {
+        if(!strcmp(argv[a], "--runs") && a+1<argc)
+            runs = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--seed") && a+1<argc)
+            seed = strtoul(argv[++a], NULL, 10);
+        else {
+            buf = load_file(argv[a], &size);
+            if(buf==NULL)
+                return 1;
+            srand(seed);
+            run_input(buf, size);
+            input = malloc((size_t)size + 64);
+            for(r=0; r<runs; r++) {
+                n = mutate(buf, size, input, (size_t)size + 64);
+                run_input(input, n);
+            }
+            fprintf(stderr, "%s: %u runs\n", argv[a], runs+1);
+            free(input);
+            free(buf);
+            n_files++;
+        }
+    }
+    if(n_files==0) {
+        usage();
+        return 1;
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,279 @@
+/* Pack several .huf books into one archive with a shared table, or list
+the books in an archive.
+
+    huf_archive <out.huf> <book.huf> [<book.huf> ...]
+    huf_archive --list <archive.huf>
+
+Every tune is decoded and re-encoded with a table built from the token
+counts of all the books together, so the archive carries one table
+rather than one per book. Books are named after their files, without
+the directory or .huf extension.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "huffman_validate.h"
+#include "huffman_encode.h"
+#include "tune_catalogue.h"
+#include "book_archive.h"
+#include "binary.h"
+
+typedef struct source_book
+{
+    char *name;
+    uint8_t *buf;
+    uint32_t size;
+    huffman_buffer *buffer;
+    uint32_t *map; /* book symbol -> archive symbol */
+    uint32_t first_tune;
+    uint32_t n_tunes;
+} source_book;
+
+/* Tokens of all the books, in order of first use */
+typedef struct token_set
+{
+    char **tokens;
+    uint64_t *counts;
+    uint32_t n_tokens;
+    uint32_t max_tokens;
+} token_set;
+
+void usage()
+{
+    printf("Usage: huf_archive <out.huf> <book.huf> [<book.huf> ...]\n");
+    printf("       huf_archive --list <archive.huf>\n");
+}
+
+static uint32_t archive_symbol(token_set *set, source_book *book, uint32_t symbol)
+{
+    /* The archive symbol for one of a book's symbols, adding its token
+    to the set the first time it is seen */
+    char *token;
+    uint32_t i;
+    if(book->map[symbol]!=INVALID_CODE)
+        return book->map[symbol];
+    token = TOKEN_STRING(book->buffer->table, symbol);
+    for(i=0; i<set->n_tokens; i++)
+        if(!strcmp(set->tokens[i], token))
+            break;
+    if(i==set->n_tokens) {
+        if(set->n_tokens==set->max_tokens) {
+            set->max_tokens = set->max_tokens ? 2*set->max_tokens : 256;
+            set->tokens = realloc(set->tokens, sizeof(char*)*set->max_tokens);
+            set->counts = realloc(set->counts, sizeof(uint64_t)*set->max_tokens);
+        }
+        set->tokens[i] = token;
+        set->counts[i] = 0;
+        set->n_tokens++;
+    }
+    book->map[symbol] = i;
+    return i;
+}
+
+static uint32_t copy_book(source_book *book, token_set *set, bit_writer *bw, huffman_table *table, uint32_t *tune_index)
+{
+    /* Walk every tune of a book. Without a writer, count the archive
+    symbols; with one, write them and record where each tune starts.
+    Returns the number of tunes. */
+    huffman_buffer *buffer = book->buffer;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, buffer->table);
+    uint32_t symbol, n_tunes = 0, ix;
+
+    reset_buffer(buffer);
+    while((symbol = read_symbol(buffer))!=nl) {
+        if(bw)
+            tune_index[book->first_tune+n_tunes+1] = (uint32_t)bw->n_bits;
+        while(1) {
+            if(bw)
+                write_symbol(bw, table, book->map[symbol]);
+            else {
+                ix = archive_symbol(set, book, symbol); /* may grow counts */
+                set->counts[ix]++;
+            }
+            if(symbol==nl)
+                break;
+            symbol = read_symbol(buffer);
+        }
+        n_tunes++;
+    }
+    return n_tunes;
+}
+
+static char *book_name(char *fname)
+{
+    /* The file name without its directory or .huf extension */
+    char *name, *p;
+    uint32_t len;
+    p = strrchr(fname, '/');
+    fname = p ? p+1 : fname;
+    len = strlen(fname);
+    if(len>4 && !strcmp(fname+len-4, ".huf"))
+        len -= 4;
+    if(len>255)
+        len = 255;
+    name = malloc(len+1);
+    memcpy(name, fname, len);
+    name[len] = '\0';
+    return name;
+}
+
+static uint8_t *build_book_directory(source_book *books, uint32_t n_books, uint32_t *length)
+{
+    /* Return a malloc'd book directory section payload, setting *length */
+    uint32_t i, size = 4 + 12*n_books, name_offset = size;
+    uint8_t *data, *p, len;
+    for(i=0; i<n_books; i++)
+        size += 1 + strlen(books[i].name);
+    data = malloc(size);
+    p = data;
+    writebuf_u32(&p, n_books);
+    for(i=0; i<n_books; i++) {
+        writebuf_u32(&p, books[i].first_tune);
+        writebuf_u32(&p, books[i].n_tunes);
+        writebuf_u32(&p, name_offset);
+        name_offset += 1 + strlen(books[i].name);
+    }
+    for(i=0; i<n_books; i++) {
+        len = strlen(books[i].name);
+        *p++ = len;
+        memcpy(p, books[i].name, len);
+        p += len;
+    }
+    *length = size;
+    return data;
+}
+
+int write_archive(char *out_name, char **book_names, uint32_t n_books)
+{
+    /* Build an archive of the n_books files named in book_names */
+    source_book *books = calloc(n_books, sizeof(source_book));
+    token_set set = {NULL, NULL, 0, 0};
+    huffman_table *table = NULL;
+    uint32_t *tune_index = NULL;
+    uint32_t i, k, n_tunes = 0, length, nl;
+    uint64_t n_bits, in_size = 0, section_size = 0;
+    uint8_t *section;
+    bit_writer bw;
+    FILE *f = NULL;
+    int result = 1;
+
+    /* Count the tokens of every book, in archive symbols */
+    for(i=0; i<n_books; i++) {
+        books[i].name = book_name(book_names[i]);
+        books[i].buf = load_file(book_names[i], &books[i].size);
+        if(books[i].buf==NULL)
+            goto done;
+        books[i].buffer = load_huffman(books[i].buf, books[i].size);
+        if(books[i].buffer==NULL) {
+            printf("Error: %s is not a valid file\n", book_names[i]);
+            goto done;
+        }
+        in_size += books[i].size;
+        books[i].map = malloc(sizeof(uint32_t)*books[i].buffer->table->n_entries);
+        for(k=0; k<books[i].buffer->table->n_entries; k++)
+            books[i].map[k] = INVALID_CODE;
+        books[i].first_tune = n_tunes;
+        books[i].n_tunes = copy_book(&books[i], &set, NULL, NULL, NULL);
+        n_tunes += books[i].n_tunes;
+    }
+    /* The data ends with an empty tune, written twice as the encoder does */
+    nl = archive_symbol(&set, &books[0], lookup_symbol_index(TUNE_TERMINATOR, books[0].buffer->table));
+    set.counts[nl] += 2;
+
+    table = build_huffman_codes(set.tokens, set.counts, set.n_tokens);
+    if(table==NULL)
+        goto done;
+    n_bits = encoded_bits(table, set.counts);
+    if(n_bits > 0xFFFFFFFF) {
+        printf("Error: archive data too long\n");
+        goto done;
+    }
+    f = fopen(out_name, "wb");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        goto done;
+    }
+    write_huffman_header(f, table, (uint32_t)n_bits);
+    init_bit_writer(&bw, f);
+    tune_index = malloc(sizeof(uint32_t)*(n_tunes+1));
+    tune_index[0] = n_tunes;
+    for(i=0; i<n_books; i++)
+        copy_book(&books[i], &set, &bw, table, tune_index);
+    write_symbol(&bw, table, nl);
+    write_symbol(&bw, table, nl);
+    flush_bits(&bw);
+
+    section = build_index_section(tune_index, &length);
+    write_section(f, TUNE_INDEX_TAG, section, length);
+    section_size += 8 + length;
+    free(section);
+    section = build_book_directory(books, n_books, &length);
+    write_section(f, BOOK_DIRECTORY_TAG, section, length);
+    section_size += 8 + length;
+    free(section);
+
+    printf("%d books, %d tunes, %d tokens\n", n_books, n_tunes, set.n_tokens);
+    printf("%llu bytes in, %ld bytes out, of which %llu are index\n", (unsigned long long)in_size,
+           ftell(f), (unsigned long long)section_size);
+    result = 0;
+
+done:
+    if(f)
+        fclose(f);
+    for(i=0; i<n_books; i++) {
+        if(books[i].buffer) {
+            free_huffman_table(books[i].buffer->table);
+            free(books[i].buffer);
+        }
+        free(books[i].map);
+        free(books[i].buf);
+        free(books[i].name);
+    }
+    if(table)
+        free_huffman_table(table);
+    free(tune_index);
+    free(set.tokens);
+    free(set.counts);
+    free(books);
+    return result;
+}
+
+int list_books(char *in_name)
+{
+    /* Print the number, tune count and name of every book */
+    uint8_t *buf;
+    uint32_t size, i;
+    book_archive *archive;
+    char name[256];
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    archive = open_archive(buf, size);
+    if(archive==NULL) {
+        free(buf);
+        return 1;
+    }
+    for(i=0; i<archive->n_books; i++) {
+        archive_book_name(archive, i, name);
+        printf("%d\t%d\t%s\n", i, archive_tune_count(archive, i), name);
+    }
+    close_archive(archive);
+    free(buf);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc==3 && !strcmp(argv[1], "--list"))
+        return list_books(argv[2]);
+    if(argc<3 || argv[1][0]=='-') {
+        usage();
+        return 1;
+    }
+    return write_archive(argv[1], argv+2, argc-2);
+}
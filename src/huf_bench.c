@@ -0,0 +1,125 @@
+/* Time loading, indexing and decoding a .huf file, for charting how
+they scale with file size (see huf_gen, and make scaling).
+
+    huf_bench [--checked] [--seeks <n>] in.huf
+
+Prints "name value" lines: times in milliseconds, sizes in bytes.
+--checked also decodes everything without the lookup table, with
+read_symbol's table scan (slow on large files).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "binary.h"
+
+void usage()
+{
+    printf("Usage: huf_bench [--checked] [--seeks <n>] <in.huf>\n");
+}
+
+static double elapsed_ms(clock_t t0)
+{
+    return 1000.0*(clock()-t0)/CLOCKS_PER_SEC;
+}
+
+static void decode_all(huffman_buffer *h_buffer, uint32_t *index, tune_context *ctx)
+{
+    /* Decode every tune, in order */
+    uint32_t i;
+    for(i=0; i<index[0]; i++) {
+        h_buffer->pos = index[i+1];
+        parse_tune_context(h_buffer, ctx);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL;
+    int checked = 0, i;
+    uint32_t n_seeks = 1000, size, *index, j, s;
+    uint8_t *buf;
+    huffman_buffer *h_buffer;
+    tune_context *ctx;
+    clock_t t0;
+    double ms;
+    size_t table_bytes;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--checked"))
+            checked = 1;
+        else if(!strcmp(argv[i], "--seeks") && i+1<argc)
+            n_seeks = strtoul(argv[++i], NULL, 10);
+        else if(in_name==NULL)
+            in_name = argv[i];
+    }
+    if(in_name==NULL) {
+        usage();
+        return 1;
+    }
+
+    t0 = clock();
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    printf("file_bytes %u\n", size);
+    printf("read_ms %.3f\n", elapsed_ms(t0));
+
+    t0 = clock();
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    printf("validate_ms %.3f\n", elapsed_ms(t0));
+
+    t0 = clock();
+    index = create_tune_index(h_buffer);
+    printf("index_ms %.3f\n", elapsed_ms(t0));
+    printf("tunes %u\n", index[0]);
+    printf("data_bits %u\n", h_buffer->n_bits);
+
+    table_bytes = sizeof(huffman_table) + h_buffer->table->n_entries*(sizeof(uint8_t)+sizeof(uint32_t)+sizeof(huf_offset_t)+sizeof(huffman_op));
+    table_bytes += sizeof(huf_offset_t) + h_buffer->table->token_offsets[h_buffer->table->n_entries];
+    table_bytes += sizeof(huffman_lut) + h_buffer->table->lut->n_entries*sizeof(uint32_t);
+    printf("table_entries %u\n", h_buffer->table->n_entries);
+    printf("table_ram_bytes %lu\n", (unsigned long)table_bytes);
+    printf("index_ram_bytes %lu\n", (unsigned long)(sizeof(uint32_t)*(index[0]+1)));
+
+    ctx = new_context();
+    ctx->event_callback = NULL;
+    t0 = clock();
+    decode_all(h_buffer, index, ctx);
+    ms = elapsed_ms(t0);
+    printf("decode_ms %.3f\n", ms);
+    printf("decode_mbit_per_s %.1f\n", ms>0 ? h_buffer->n_bits/ms/1000.0 : 0.0);
+
+    /* Random access: decode n_seeks tunes picked by a simple LCG */
+    t0 = clock();
+    for(j=0, s=12345; j<n_seeks && index[0]; j++) {
+        s = s*1103515245u + 12345u;
+        h_buffer->pos = index[(s>>8)%index[0]+1];
+        parse_tune_context(h_buffer, ctx);
+    }
+    ms = elapsed_ms(t0);
+    printf("seek_us_per_tune %.3f\n", n_seeks ? 1000.0*ms/n_seeks : 0.0);
+
+    if(checked) {
+        /* The same decode, without the lookup table */
+        huffman_lut *lut = h_buffer->table->lut;
+        h_buffer->table->lut = NULL;
+        t0 = clock();
+        decode_all(h_buffer, index, ctx);
+        printf("checked_decode_ms %.3f\n", elapsed_ms(t0));
+        h_buffer->table->lut = lut;
+    }
+
+    free_context(ctx);
+    free(index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,528 @@
+/* Equivalence checks: decoders that should agree are run over the same
+book and their results compared. make check runs these on the example
+books, as they come and with index sections added by huf_index.
+
+    huf_check <file.huf>...
+    huf_check --archive <archive.huf> <book.huf>...
+
+Checks, printed as "<file> <check> ok" or "<file> <check> FAILED":
+    stream  the tune index made (and, if the file has one, read) through a
+            huffman_stream matches create_tune_index, and every tune
+            parsed through a 64 byte ring gives the same events as
+            parse_tune_context. Even tunes are read from a file
+            descriptor, skipping the odd ones with lseek; odd tunes
+            from a FILE*.
+    cache   every tune replayed from a tune_cache, in an order that mixes
+            hits with misses and evictions, gives the same notes, rests
+            and bars (pitch, start, duration, bar start and count) as
+            parse_tune_context.
+    set     a set of tunes played straight on by a set_player, pulled in
+            blocks of an odd size with little prefetch, gives the same
+            samples as render_serial over the same tunes.
+    dac     tunes played through a dac_output, with dac_isr and dac_refill
+            called in turn as the DMA interrupt and main loop would,
+            give the samples of render_serial followed only by silence,
+            with no underruns.
+    archive (with --archive) the archive made by huf_archive from the
+            books lists them in order, under their file names, with
+            their tune counts, and every tune read with archive_seek
+            gives the same events and metadata (title, key, rhythm,
+            meter, bar length) as in its own book.
+
+Exits 1 if any check failed.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "huffman_stream.h"
+#include "tune_cache.h"
+#include "tune_summary.h"
+#include "set_player.h"
+#include "render_pipeline.h"
+#include "dac_output.h"
+#include "book_archive.h"
+#include "binary.h"
+
+#define CHECK_RING 64 /* bytes; smaller than most tunes */
+#define CHECK_CACHE_BUDGET 4096 /* bytes; a few tunes, so tunes are evicted */
+#define CHECK_SET 12 /* most tunes in the set */
+#define CHECK_SET_BLOCK 333 /* samples per set_render; not a power of two */
+#define CHECK_DAC_TUNES 8 /* tunes played, spread over the book */
+#define CHECK_DAC_HALF 500 /* samples in each half of the dac_output */
+
+/* The parts of the context an event leaves for the callback */
+typedef struct event_record
+{
+    uint32_t code;
+    uint8_t note;
+    uint32_t time;
+    uint32_t note_start_time;
+    uint32_t note_end_time;
+} event_record;
+
+typedef struct event_log
+{
+    event_record *events;
+    uint32_t n_events;
+    uint32_t size;
+} event_log;
+
+/* Samples collected from an output callback */
+typedef struct sample_log
+{
+    uint8_t *data;
+    size_t n_bytes;
+    size_t size;
+} sample_log;
+
+void usage()
+{
+    printf("Usage: huf_check <file.huf>...\n");
+    printf("       huf_check --archive <archive.huf> <book.huf>...\n");
+}
+
+static void log_event(tune_context *ctx, uint32_t event_code)
+{
+    /* Callback appending each event to the event_log in callback_context */
+    event_log *log = (event_log*)ctx->callback_context;
+    event_record *e;
+    if(log->n_events==log->size) {
+        log->size = log->size ? log->size*2 : 256;
+        log->events = realloc(log->events, sizeof(event_record)*log->size);
+    }
+    e = &log->events[log->n_events++];
+    memset(e, 0, sizeof(event_record)); /* padding too, for memcmp */
+    e->code = event_code;
+    e->note = ctx->current_note;
+    e->time = ctx->time;
+    e->note_start_time = ctx->note_start_time;
+    e->note_end_time = ctx->note_end_time;
+}
+
+static void log_played(tune_context *ctx, uint32_t event_code)
+{
+    /* Callback logging only what a replay from a tune_cache promises:
+    notes and rests with their pitch, start and duration, and bars with
+    their start and count */
+    event_log *log = (event_log*)ctx->callback_context;
+    event_record *e;
+    if(event_code!=EVENT_NOTE && event_code!=EVENT_REST && event_code!=EVENT_BAR)
+        return;
+    log_event(ctx, event_code);
+    e = &log->events[log->n_events-1];
+    if(event_code==EVENT_BAR) {
+        e->note = 0;
+        e->time = ctx->bar_count;
+        e->note_start_time = ctx->bar_start_time;
+        e->note_end_time = 0;
+    }
+    else {
+        e->time = ctx->current_duration;
+        e->note_end_time = ctx->note_start_time + ctx->current_duration;
+    }
+}
+
+static int same_events(event_log *a, event_log *b)
+{
+    return a->n_events==b->n_events &&
+           !memcmp(a->events, b->events, sizeof(event_record)*a->n_events);
+}
+
+static int same_index(uint32_t *a, uint32_t *b)
+{
+    return a && b && a[0]==b[0] && !memcmp(a, b, sizeof(uint32_t)*(a[0]+1));
+}
+
+static int check_stream(char *fname, huffman_buffer *buffer, uint32_t *tune_index)
+{
+    /* 1 if indexing and parsing through a stream agree with the buffer */
+    FILE *f = fopen(fname, "rb");
+    int fd = open(fname, O_RDONLY), ok = 1;
+    huffman_stream *file_stream = NULL, *fd_stream = NULL;
+    uint32_t *index, i;
+    tune_context *ctx = new_context();
+    event_log expected = {NULL, 0, 0}, got = {NULL, 0, 0};
+
+    if(f==NULL || fd<0) {
+        printf("Error: could not open file %s\n", fname);
+        ok = 0;
+        goto done;
+    }
+    /* The index, found by decoding, and from the section if there is one */
+    file_stream = open_huffman_file_stream(f, CHECK_RING);
+    if(file_stream==NULL) {
+        ok = 0;
+        goto done;
+    }
+    index = stream_create_tune_index(file_stream);
+    ok = same_index(index, tune_index);
+    free(index);
+    close_huffman_stream(file_stream);
+    fd_stream = open_huffman_stream(fd_stream_read, fd_stream_skip, &fd, NULL, CHECK_RING);
+    index = fd_stream ? stream_load_tune_index(fd_stream) : NULL;
+    if(index && !same_index(index, tune_index))
+        ok = 0;
+    free(index);
+    if(fd_stream)
+        close_huffman_stream(fd_stream);
+
+    /* Reopen both from the start, and parse every tune */
+    rewind(f);
+    lseek(fd, 0, SEEK_SET);
+    file_stream = open_huffman_file_stream(f, CHECK_RING);
+    fd_stream = open_huffman_stream(fd_stream_read, fd_stream_skip, &fd, NULL, CHECK_RING);
+    if(file_stream==NULL || fd_stream==NULL) {
+        ok = 0;
+        goto done;
+    }
+    ctx->event_callback = log_event;
+    for(i=0; ok && i<tune_index[0]; i++) {
+        expected.n_events = got.n_events = 0;
+        ctx->callback_context = &expected;
+        seek_to_tune(i, tune_index, buffer);
+        parse_tune_context(buffer, ctx);
+        ctx->callback_context = &got;
+        if(!stream_seek_to_tune(i, tune_index, i%2 ? file_stream : fd_stream)) {
+            ok = 0;
+            break;
+        }
+        stream_parse_tune_context(i%2 ? file_stream : fd_stream, ctx);
+        if(!same_events(&expected, &got)) {
+            printf("tune %u differs\n", i);
+            ok = 0;
+        }
+    }
+
+done:
+    if(file_stream)
+        close_huffman_stream(file_stream);
+    if(fd_stream)
+        close_huffman_stream(fd_stream);
+    if(f)
+        fclose(f);
+    if(fd>=0)
+        close(fd);
+    free(expected.events);
+    free(got.events);
+    free_context(ctx);
+    return ok;
+}
+
+static int check_cache(huffman_buffer *buffer, uint32_t *tune_index)
+{
+    /* 1 if every tune replayed from a tune_cache plays as it parses. Each
+    tune is replayed on a miss, again on a hit, and then an earlier tune
+    that has most likely been evicted is replayed. */
+    tune_cache *cache = new_tune_cache(buffer, tune_index, CHECK_CACHE_BUDGET);
+    tune_context *ctx = new_context();
+    event_log expected = {NULL, 0, 0}, got = {NULL, 0, 0};
+    uint32_t i, j, ix, n = tune_index[0];
+    int ok = 1;
+
+    ctx->event_callback = log_played;
+    ctx->callback_context = &expected;
+    for(i=0; ok && i<n; i++) {
+        for(j=0; ok && j<3; j++) {
+            ix = j<2 ? i : (i*7919) % (i+1);
+            expected.n_events = got.n_events = 0;
+            seek_to_tune(ix, tune_index, buffer);
+            parse_tune_context(buffer, ctx);
+            replay_tune(cache, ix, log_played, &got);
+            if(!same_events(&expected, &got)) {
+                printf("tune %u differs on replay\n", ix);
+                ok = 0;
+            }
+        }
+    }
+    /* Make sure the budget really did force evictions and hits */
+    if(n > 1 && (cache->evictions==0 || cache->hits==0)) {
+        printf("cache check had %u hits and %u evictions\n", cache->hits, cache->evictions);
+        ok = 0;
+    }
+    free(expected.events);
+    free(got.events);
+    free_context(ctx);
+    free_tune_cache(cache);
+    return ok;
+}
+
+static int log_samples(void *output_context, const uint8_t *samples, uint32_t n_bytes)
+{
+    /* pipeline_output_type appending the samples to the sample_log */
+    sample_log *log = (sample_log*)output_context;
+    while(log->n_bytes + n_bytes > log->size) {
+        log->size = log->size ? log->size*2 : 65536;
+        log->data = realloc(log->data, log->size);
+    }
+    memcpy(log->data + log->n_bytes, samples, n_bytes);
+    log->n_bytes += n_bytes;
+    return 1;
+}
+
+static int check_set(huffman_buffer *buffer, uint8_t *file_end, uint32_t *tune_index)
+{
+    /* 1 if a set played straight on sounds the same as render_serial:
+    the first tunes of the book, the last, and the first again */
+    uint32_t tunes[CHECK_SET], n_tunes = 0, i, got;
+    uint8_t *summaries = load_summary_section(buffer, file_end, tune_index[0]);
+    sample_log expected = {NULL, 0, 0};
+    uint8_t *block;
+    pipeline_config pipeline;
+    pipeline_stats stats;
+    set_config config;
+    set_player *player;
+    size_t pos = 0;
+    int ok;
+
+    for(i=0; i<tune_index[0] && n_tunes<CHECK_SET-2; i++)
+        tunes[n_tunes++] = i;
+    tunes[n_tunes++] = tune_index[0]-1;
+    tunes[n_tunes++] = 0;
+
+    default_pipeline_config(&pipeline);
+    ok = render_serial(buffer, tune_index, tunes, n_tunes, &pipeline, log_samples, &expected, &stats);
+
+    default_set_config(&config);
+    config.sample_rate = pipeline.sample_rate;
+    config.bits = pipeline.bits;
+    config.prefetch_symbols = 1; /* so some tunes are primed late */
+    player = new_set_player(buffer, summaries, tune_index, tunes, n_tunes, &config);
+    if(player==NULL)
+        ok = 0;
+    if(ok && set_length(player)*(config.bits/8)!=expected.n_bytes) {
+        printf("set length %llu samples, serial render %llu\n", (unsigned long long)set_length(player),
+               (unsigned long long)(expected.n_bytes/(config.bits/8)));
+        ok = 0;
+    }
+    block = malloc(CHECK_SET_BLOCK*(config.bits/8));
+    while(ok && !set_finished(player)) {
+        got = set_render(player, block, CHECK_SET_BLOCK)*(config.bits/8);
+        if(pos+got > expected.n_bytes || memcmp(block, expected.data+pos, got)) {
+            printf("set differs from the serial render after %llu bytes\n", (unsigned long long)pos);
+            ok = 0;
+        }
+        pos += got;
+        if(got < CHECK_SET_BLOCK*(config.bits/8))
+            break;
+    }
+    if(ok && pos!=expected.n_bytes) {
+        printf("set ended after %llu of %llu bytes\n", (unsigned long long)pos, (unsigned long long)expected.n_bytes);
+        ok = 0;
+    }
+    if(player)
+        free_set_player(player);
+    free(block);
+    free(expected.data);
+    return ok;
+}
+
+static int check_dac_tune(huffman_buffer *buffer, uint32_t *tune_index, uint32_t ix, pipeline_config *pipeline)
+{
+    /* 1 if tune ix played through a fresh dac_output matches render_serial.
+    Both halves start out silent, so the tune begins with the third half
+    played. */
+    uint32_t half_bytes = CHECK_DAC_HALF*(pipeline->bits/8), n_halves = 0;
+    uint8_t *halves = calloc(2, half_bytes), *played;
+    sample_log expected = {NULL, 0, 0};
+    pipeline_stats stats;
+    dac_output out;
+    tune_context *ctx = new_context();
+    size_t pos = 0, n;
+    int ok = render_serial(buffer, tune_index, &ix, 1, pipeline, log_samples, &expected, &stats);
+
+    init_dac_output(&out, halves, halves+half_bytes, CHECK_DAC_HALF, pipeline->bits, pipeline->sample_rate);
+    dac_start_tune(&out, buffer, tune_index, ix, ctx);
+    played = out.halves[out.playing];
+    while(ok && (!dac_finished(&out) || n_halves < 2 || pos < expected.n_bytes)) {
+        /* The hardware has played a half; compare it with what was due */
+        if(n_halves >= 2) {
+            n = expected.n_bytes-pos < half_bytes ? expected.n_bytes-pos : half_bytes;
+            if(memcmp(played, expected.data+pos, n)) {
+                printf("tune %u differs through the DAC after %llu bytes\n", ix, (unsigned long long)pos);
+                ok = 0;
+            }
+            for(; ok && n<half_bytes; n++)
+                if(played[n]!=0) {
+                    printf("tune %u not silent after its end through the DAC\n", ix);
+                    ok = 0;
+                }
+            pos += half_bytes;
+        }
+        n_halves++;
+        played = dac_isr(&out);
+        /* The main loop refills the half just played, and only that */
+        if(dac_refill(&out)!=1 || dac_refill(&out)!=0) {
+            printf("tune %u: dac_refill did not fill exactly one half\n", ix);
+            ok = 0;
+        }
+    }
+    if(out.underruns) {
+        printf("tune %u: %u underruns\n", ix, out.underruns);
+        ok = 0;
+    }
+    free_context(ctx);
+    free(halves);
+    free(expected.data);
+    return ok;
+}
+
+static int check_dac(huffman_buffer *buffer, uint32_t *tune_index)
+{
+    /* 1 if every tune tried plays the same through a dac_output as
+    through render_serial */
+    pipeline_config pipeline;
+    uint32_t i, step = tune_index[0]/CHECK_DAC_TUNES + 1;
+    int ok = 1;
+    default_pipeline_config(&pipeline);
+    for(i=0; ok && i<tune_index[0]; i+=step)
+        ok = check_dac_tune(buffer, tune_index, i, &pipeline);
+    return ok;
+}
+
+static void parse_logged(huffman_buffer *buffer, tune_context *ctx, event_log *log, tune_metadata *meta)
+{
+    /* Parse the tune at buffer->pos, logging its events and copying the
+    metadata it leaves into meta */
+    log->n_events = 0;
+    ctx->event_callback = log_event;
+    ctx->callback_context = log;
+    parse_tune_context(buffer, ctx);
+    *meta = *ctx->meta;
+}
+
+static int same_metadata(tune_metadata *a, tune_metadata *b)
+{
+    return !strcmp(a->title, b->title) && !strcmp(a->key, b->key) && !strcmp(a->rhythm, b->rhythm) &&
+           a->meter_numerator==b->meter_numerator && a->meter_denominator==b->meter_denominator &&
+           a->bar_duration==b->bar_duration;
+}
+
+static int check_book(book_archive *archive, uint32_t book, char *fname)
+{
+    /* 1 if book of the archive is named after fname, and holds the same
+    tunes */
+    char name[256], *base = strrchr(fname, '/');
+    uint8_t *buf;
+    uint32_t size, *tune_index = NULL, t, len;
+    huffman_buffer *buffer = NULL;
+    tune_context *ctx = new_context();
+    tune_metadata expected_meta, got_meta;
+    event_log expected = {NULL, 0, 0}, got = {NULL, 0, 0};
+    int ok = 1;
+
+    /* Named as huf_archive names books: no directory, no .huf */
+    base = base ? base+1 : fname;
+    len = strlen(base);
+    if(len > 4 && !strcmp(base+len-4, ".huf"))
+        len -= 4;
+    archive_book_name(archive, book, name);
+    if(len >= sizeof(name) || strncmp(name, base, len) || name[len]!='\0' || find_book(archive, name)!=book) {
+        printf("book %u is called %s, not after %s\n", book, name, fname);
+        ok = 0;
+    }
+    buf = load_file(fname, &size);
+    buffer = buf ? load_huffman(buf, size) : NULL;
+    if(buffer==NULL)
+        ok = 0;
+    else {
+        tune_index = create_tune_index(buffer);
+        if(archive_tune_count(archive, book)!=tune_index[0]) {
+            printf("book %u has %u tunes, %s has %u\n", book, archive_tune_count(archive, book), fname, tune_index[0]);
+            ok = 0;
+        }
+    }
+    for(t=0; ok && t<tune_index[0]; t++) {
+        seek_to_tune(t, tune_index, buffer);
+        parse_logged(buffer, ctx, &expected, &expected_meta);
+        ok = archive_seek(archive, book, t);
+        if(ok)
+            parse_logged(archive->buffer, ctx, &got, &got_meta);
+        if(ok && (!same_events(&expected, &got) || !same_metadata(&expected_meta, &got_meta))) {
+            printf("tune %u of book %u differs from %s\n", t, book, fname);
+            ok = 0;
+        }
+    }
+    if(buffer) {
+        free_huffman_table(buffer->table);
+        free(buffer);
+    }
+    free(tune_index);
+    free(buf);
+    free(expected.events);
+    free(got.events);
+    free_context(ctx);
+    return ok;
+}
+
+static int check_archive_books(char *archive_name, char **book_names, uint32_t n_books)
+{
+    /* 1 if the archive holds exactly the books named, in order */
+    uint8_t *buf;
+    uint32_t size, i;
+    book_archive *archive;
+    int ok = 1;
+
+    buf = load_file(archive_name, &size);
+    archive = buf ? open_archive(buf, size) : NULL;
+    if(archive==NULL) {
+        free(buf);
+        return 0;
+    }
+    if(archive->n_books!=n_books) {
+        printf("%u books in the archive, %u given\n", archive->n_books, n_books);
+        ok = 0;
+    }
+    for(i=0; ok && i<n_books; i++)
+        ok = check_book(archive, i, book_names[i]);
+    close_archive(archive);
+    free(buf);
+    return ok;
+}
+
+static int report(char *fname, char *check, int ok)
+{
+    printf("%s %s %s\n", fname, check, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t *buf;
+    uint32_t size, *tune_index;
+    huffman_buffer *buffer;
+    int i, ok = 1;
+
+    if(argc < 2 || (!strcmp(argv[1], "--archive") && argc < 4)) {
+        usage();
+        return 1;
+    }
+    if(!strcmp(argv[1], "--archive"))
+        return !report(argv[2], "archive", check_archive_books(argv[2], argv+3, argc-3));
+    for(i=1; i<argc; i++) {
+        buf = load_file(argv[i], &size);
+        buffer = buf ? load_huffman(buf, size) : NULL;
+        if(buffer==NULL) {
+            report(argv[i], "load", 0);
+            free(buf);
+            ok = 0;
+            continue;
+        }
+        tune_index = create_tune_index(buffer);
+        ok &= report(argv[i], "stream", check_stream(argv[i], buffer, tune_index));
+        ok &= report(argv[i], "cache", check_cache(buffer, tune_index));
+        ok &= report(argv[i], "set", check_set(buffer, buf+size, tune_index));
+        ok &= report(argv[i], "dac", check_dac(buffer, tune_index));
+        free(tune_index);
+        free_huffman_table(buffer->table);
+        free(buffer);
+        free(buf);
+    }
+    return !ok;
+}
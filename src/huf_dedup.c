@@ -0,0 +1,380 @@
+/* Find near-duplicate tunes, and optionally write a copy of the file
+without them.
+
+    huf_dedup [--threshold <j>] [--hashes <n>] [--rows <n>] [--shingle <n>]
+              [--threads <n>] [--out <out.huf>] in.huf
+
+Each tune is reduced to its sequence of pitch (+n, -n) and duration
+(/n/d) tokens, and the set of runs of --shingle (default 4) consecutive
+tokens is summarised by a MinHash signature of --hashes (default 64)
+minima, computed across --threads threads (default: one per core). Only
+the low byte of each minimum is kept, so the signatures take --hashes
+bytes a tune, and are the only memory that grows with the number of
+tunes besides the tune index and a few words a tune while clustering.
+
+Signatures are split into bands of --rows (default 4) bytes. Tunes whose
+signatures share a band are candidates, and are joined into a cluster if
+their estimated similarity (the Jaccard index of their runs) is at least
+--threshold (default 0.8). Prints "tune<TAB>first tune of its cluster"
+for every tune in a cluster of two or more, then a summary line.
+--out writes the file keeping only the first tune of each cluster (and
+every tune not in one). Sections are not copied, as their tune numbers
+would no longer be right; use huf_index to add them again.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "huffman_encode.h"
+#include "tune_catalogue.h"
+#include "binary.h"
+
+#define MAX_HASHES 256
+#define MAX_SHINGLE 16
+#define MAX_THREADS 64
+
+typedef struct dedup_options
+{
+    double threshold;
+    uint32_t n_hashes;
+    uint32_t rows;
+    uint32_t shingle;
+    uint32_t n_threads;
+} dedup_options;
+
+/* The signatures for a range of tunes, computed by one thread */
+typedef struct signature_job
+{
+    huffman_buffer buffer; /* a private copy, sharing the table */
+    uint32_t *tune_index;
+    uint32_t first, last; /* tunes [first, last) */
+    dedup_options *opts;
+    uint64_t *mul, *add; /* the hash functions */
+    uint8_t *signatures; /* n_hashes bytes per tune */
+    uint8_t *has_notes; /* 0 for tunes with no pitch or duration tokens */
+} signature_job;
+
+void usage()
+{
+    printf("Usage: huf_dedup [--threshold <j>] [--hashes <n>] [--rows <n>] [--shingle <n>]\n");
+    printf("                 [--threads <n>] [--out <out.huf>] <in.huf>\n");
+}
+
+static uint64_t mix64(uint64_t x)
+{
+    /* splitmix64 finaliser */
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static int is_melodic(char op)
+{
+    return op=='+' || op=='-' || op=='/';
+}
+
+static void tune_signature(signature_job *job, uint32_t ix)
+{
+    /* Decode tune ix and compute its signature */
+    huffman_buffer *buffer = &job->buffer;
+    huffman_table *table = buffer->table;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, table);
+    uint32_t window[MAX_SHINGLE], n_window = 0, symbol, k, h_ix;
+    uint32_t minima[MAX_HASHES];
+    uint64_t shingle;
+    int string_mode = 0, n_shingles = 0;
+    char *token;
+
+    for(k=0; k<job->opts->n_hashes; k++)
+        minima[k] = UINT32_MAX;
+    buffer->pos = job->tune_index[ix+1];
+    while((symbol = read_symbol(buffer))!=nl) {
+        token = TOKEN_STRING(table, symbol);
+        if(string_mode) {
+            string_mode = strcmp(token, STRING_TERMINATOR)!=0;
+            continue;
+        }
+        if(token[0]=='*' && (!strcmp(token+1, "title") || !strcmp(token+1, "rhythm")))
+            string_mode = 1;
+        if(!is_melodic(table->ops[symbol].op))
+            continue;
+        /* Slide the window of the last few melodic symbols */
+        if(n_window==job->opts->shingle) {
+            memmove(window, window+1, sizeof(uint32_t)*(n_window-1));
+            n_window--;
+        }
+        window[n_window++] = symbol;
+        if(n_window < job->opts->shingle)
+            continue;
+        for(k=0, shingle=0; k<n_window; k++)
+            shingle = mix64(shingle ^ window[k]);
+        for(k=0; k<job->opts->n_hashes; k++) {
+            h_ix = (uint32_t)((shingle*job->mul[k] + job->add[k]) >> 32);
+            if(h_ix < minima[k])
+                minima[k] = h_ix;
+        }
+        n_shingles++;
+    }
+    /* Tunes shorter than a shingle are one shingle of what they have */
+    if(n_shingles==0 && n_window>0) {
+        for(k=0, shingle=0; k<n_window; k++)
+            shingle = mix64(shingle ^ window[k]);
+        for(k=0; k<job->opts->n_hashes; k++)
+            minima[k] = (uint32_t)((shingle*job->mul[k] + job->add[k]) >> 32);
+    }
+    job->has_notes[ix] = n_window>0;
+    for(k=0; k<job->opts->n_hashes; k++)
+        job->signatures[(size_t)ix*job->opts->n_hashes+k] = minima[k] & 0xFF;
+}
+
+static void *signature_thread(void *arg)
+{
+    signature_job *job = (signature_job*)arg;
+    uint32_t ix;
+    for(ix=job->first; ix<job->last; ix++)
+        tune_signature(job, ix);
+    return NULL;
+}
+
+static uint32_t find_root(uint32_t *parent, uint32_t x)
+{
+    /* Union-find root, halving the path on the way */
+    while(parent[x]!=x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+static void join(uint32_t *parent, uint32_t a, uint32_t b)
+{
+    /* Join two clusters; the root is always the lowest numbered tune */
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if(a<b)
+        parent[b] = a;
+    else if(b<a)
+        parent[a] = b;
+}
+
+static double similarity(uint8_t *x, uint8_t *y, uint32_t n_hashes)
+{
+    /* Estimated Jaccard index from one-byte minima, which also
+    agree by chance one time in 256 */
+    uint32_t k, same = 0;
+    double p;
+    for(k=0; k<n_hashes; k++)
+        same += x[k]==y[k];
+    p = (double)same/n_hashes;
+    return (p - 1.0/256) / (1 - 1.0/256);
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x<y ? -1 : x>y;
+}
+
+static uint32_t cluster(uint8_t *signatures, uint8_t *has_notes, uint32_t n_tunes, dedup_options *opts, uint32_t *parent)
+{
+    /* Join candidate pairs from each band into clusters; returns the
+    number of candidate pairs checked */
+    uint64_t *keys = malloc(sizeof(uint64_t)*n_tunes);
+    uint32_t band, i, k, n, run, a, b, key, n_checked = 0;
+    uint8_t *band_bytes;
+
+    for(i=0; i<n_tunes; i++)
+        parent[i] = i;
+    for(band=0; band+opts->rows<=opts->n_hashes; band+=opts->rows) {
+        /* Sort tunes by a hash of their bytes in this band */
+        for(i=0, n=0; i<n_tunes; i++) {
+            if(!has_notes[i])
+                continue;
+            band_bytes = signatures + (size_t)i*opts->n_hashes + band;
+            for(k=0, key=2166136261u; k<opts->rows; k++)
+                key = (key ^ band_bytes[k]) * 16777619u;
+            keys[n++] = (uint64_t)key << 32 | i;
+        }
+        qsort(keys, n, sizeof(uint64_t), compare_keys);
+        /* Compare each tune with the first and previous of its bucket */
+        for(i=1, run=0; i<n; i++) {
+            if(keys[i]>>32 != keys[run]>>32) {
+                run = i;
+                continue;
+            }
+            b = (uint32_t)keys[i];
+            a = (uint32_t)keys[run];
+            if(find_root(parent, a)!=find_root(parent, b)) {
+                n_checked++;
+                if(similarity(signatures+(size_t)a*opts->n_hashes, signatures+(size_t)b*opts->n_hashes, opts->n_hashes) >= opts->threshold)
+                    join(parent, a, b);
+            }
+            a = (uint32_t)keys[i-1];
+            if(a!=(uint32_t)keys[run] && find_root(parent, a)!=find_root(parent, b)) {
+                n_checked++;
+                if(similarity(signatures+(size_t)a*opts->n_hashes, signatures+(size_t)b*opts->n_hashes, opts->n_hashes) >= opts->threshold)
+                    join(parent, a, b);
+            }
+        }
+    }
+    free(keys);
+    return n_checked;
+}
+
+static uint32_t tune_end(huffman_buffer *buffer, uint32_t *tune_index, uint32_t ix)
+{
+    /* The bit offset just after tune ix */
+    if(ix+1 < tune_index[0])
+        return tune_index[ix+2];
+    buffer->pos = tune_index[ix+1];
+    seek_forward_one_tune(buffer);
+    return buffer->pos;
+}
+
+static int write_deduped(char *out_name, huffman_buffer *buffer, uint32_t *tune_index, uint32_t *parent)
+{
+    /* Write the file keeping only the root of each cluster */
+    FILE *f = fopen(out_name, "wb");
+    huffman_table *table = buffer->table;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, table), ix, end;
+    uint64_t n_bits = 2*table->n_bits[nl];
+    bit_writer bw;
+
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        return 1;
+    }
+    for(ix=0; ix<tune_index[0]; ix++)
+        if(find_root(parent, ix)==ix)
+            n_bits += tune_end(buffer, tune_index, ix) - tune_index[ix+1];
+    write_huffman_header(f, table, (uint32_t)n_bits);
+    init_bit_writer(&bw, f);
+    for(ix=0; ix<tune_index[0]; ix++) {
+        if(find_root(parent, ix)!=ix)
+            continue;
+        /* Codes are unchanged, so symbols are copied as they are */
+        end = tune_end(buffer, tune_index, ix);
+        buffer->pos = tune_index[ix+1];
+        while(buffer->pos < end)
+            write_symbol(&bw, table, read_symbol(buffer));
+    }
+    write_symbol(&bw, table, nl);
+    write_symbol(&bw, table, nl);
+    flush_bits(&bw);
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    dedup_options opts = {0.8, 64, 4, 4, 0};
+    char *in_name = NULL, *out_name = NULL;
+    uint8_t *buf, *signatures, *has_notes;
+    uint32_t size, *tune_index, *parent, n_tunes, i, t, root, n_clustered = 0, n_clusters = 0, n_checked;
+    uint64_t mul[MAX_HASHES], add[MAX_HASHES];
+    huffman_buffer *h_buffer;
+    signature_job jobs[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    struct timespec t0, t1, t2;
+    int result = 0, a;
+
+    for(a=1; a<argc; a++) {
+        if(!strcmp(argv[a], "--threshold") && a+1<argc)
+            opts.threshold = atof(argv[++a]);
+        else if(!strcmp(argv[a], "--hashes") && a+1<argc)
+            opts.n_hashes = atoi(argv[++a]);
+        else if(!strcmp(argv[a], "--rows") && a+1<argc)
+            opts.rows = atoi(argv[++a]);
+        else if(!strcmp(argv[a], "--shingle") && a+1<argc)
+            opts.shingle = atoi(argv[++a]);
+        else if(!strcmp(argv[a], "--threads") && a+1<argc)
+            opts.n_threads = atoi(argv[++a]);
+        else if(!strcmp(argv[a], "--out") && a+1<argc)
+            out_name = argv[++a];
+        else if(in_name==NULL)
+            in_name = argv[a];
+    }
+    if(in_name==NULL || opts.n_hashes<1 || opts.n_hashes>MAX_HASHES || opts.rows<1 ||
+       opts.rows>opts.n_hashes || opts.shingle<1 || opts.shingle>MAX_SHINGLE) {
+        usage();
+        return 1;
+    }
+    if(opts.n_threads==0)
+        opts.n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if(opts.n_threads<1)
+        opts.n_threads = 1;
+    if(opts.n_threads>MAX_THREADS)
+        opts.n_threads = MAX_THREADS;
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    tune_index = load_tune_index(h_buffer, buf+size);
+    n_tunes = tune_index[0];
+    signatures = malloc((size_t)n_tunes*opts.n_hashes);
+    has_notes = malloc(n_tunes);
+    parent = malloc(sizeof(uint32_t)*n_tunes);
+    /* Hash functions h(x) = (mul*x + add) >> 32, with odd multipliers */
+    for(i=0; i<opts.n_hashes; i++) {
+        mul[i] = mix64(2*i+1) | 1;
+        add[i] = mix64(2*i+2);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(t=0; t<opts.n_threads; t++) {
+        jobs[t].buffer = *h_buffer;
+        jobs[t].tune_index = tune_index;
+        jobs[t].first = (uint64_t)n_tunes*t/opts.n_threads;
+        jobs[t].last = (uint64_t)n_tunes*(t+1)/opts.n_threads;
+        jobs[t].opts = &opts;
+        jobs[t].mul = mul;
+        jobs[t].add = add;
+        jobs[t].signatures = signatures;
+        jobs[t].has_notes = has_notes;
+        pthread_create(&threads[t], NULL, signature_thread, &jobs[t]);
+    }
+    for(t=0; t<opts.n_threads; t++)
+        pthread_join(threads[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    n_checked = cluster(signatures, has_notes, n_tunes, &opts, parent);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    /* has_notes is done with, and now marks roots already counted */
+    memset(has_notes, 0, n_tunes);
+    for(i=0; i<n_tunes; i++) {
+        root = find_root(parent, i);
+        if(root==i)
+            continue;
+        printf("%u\t%u\n", i, root);
+        n_clustered++;
+        n_clusters += !has_notes[root];
+        has_notes[root] = 1;
+    }
+    printf("# %u tunes, %u clusters, %u duplicates, %u pairs checked, signatures %.1f ms on %u threads, clustering %.1f ms\n",
+           n_tunes, n_clusters, n_clustered, n_checked,
+           (t1.tv_sec-t0.tv_sec)*1000.0 + (t1.tv_nsec-t0.tv_nsec)/1e6, opts.n_threads,
+           (t2.tv_sec-t1.tv_sec)*1000.0 + (t2.tv_nsec-t1.tv_nsec)/1e6);
+    if(out_name)
+        result = write_deduped(out_name, h_buffer, tune_index, parent);
+
+    free(signatures);
+    free(has_notes);
+    free(parent);
+    free(tune_index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return result;
+}
@@ -0,0 +1,202 @@
+/* Report where the bits of a .huf file go, to judge encoder options
+(such as --bare, --no-bars and --chords) and format changes.
+
+    huf_entropy [--tunes] in.huf
+
+Every symbol is assigned to a class by what it does: pitch (+n, -n),
+rest (~), duration (/n/d), bar (|), chord (#), key (&), meter (%),
+tempo (^), field (* markers), text (title and rhythm characters) and
+end (tune terminators). For each class, prints "name value" lines:
+    class_<c>_symbols     symbols decoded
+    class_<c>_distinct    different tokens used
+    class_<c>_entropy     entropy of the tokens within the class, bits/symbol
+    class_<c>_ideal_bits  bits at -log2(p) each, p over the whole file
+    class_<c>_actual_bits bits the codes actually take
+    class_<c>_mean_code   actual_bits / symbols
+    class_<c>_share       fraction of all data bits
+The ideal is the order-0 bound for the file's own token frequencies, so
+actual - ideal is the loss from whole-bit codes; a class whose entropy
+is far below its mean code would pay off with its own table. --tunes
+also prints tune_<ix>_bits and tune_<ix>_notes for every tune.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "binary.h"
+
+enum token_class {
+    CLASS_PITCH, CLASS_REST, CLASS_DURATION, CLASS_BAR, CLASS_CHORD, CLASS_KEY,
+    CLASS_METER, CLASS_TEMPO, CLASS_FIELD, CLASS_TEXT, CLASS_END, CLASS_OTHER,
+    N_CLASSES
+};
+
+static const char *class_names[N_CLASSES] = {
+    "pitch", "rest", "duration", "bar", "chord", "key",
+    "meter", "tempo", "field", "text", "end", "other"
+};
+
+void usage()
+{
+    printf("Usage: huf_entropy [--tunes] <in.huf>\n");
+}
+
+static int token_class(char *token, int string_mode)
+{
+    /* The class of a token, given whether a text field is being read */
+    if(string_mode)
+        return strcmp(token, STRING_TERMINATOR) ? CLASS_TEXT : CLASS_FIELD;
+    switch(token[0]) {
+        case '+': case '-': return CLASS_PITCH;
+        case '~': return CLASS_REST;
+        case '/': return CLASS_DURATION;
+        case '|': return CLASS_BAR;
+        case '#': return CLASS_CHORD;
+        case '&': return CLASS_KEY;
+        case '%': return CLASS_METER;
+        case '^': return CLASS_TEMPO;
+        case '*': return CLASS_FIELD;
+        case '\n': return CLASS_END;
+    }
+    return CLASS_OTHER;
+}
+
+static double entropy_bits(uint64_t *counts, uint32_t n, uint64_t total)
+{
+    /* Total -log2(p) over total symbols with the given counts */
+    double bits = 0;
+    uint32_t i;
+    for(i=0; i<n; i++)
+        if(counts[i])
+            bits -= counts[i] * log2((double)counts[i]/total);
+    return bits;
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *token;
+    int per_tune = 0, i, c, string_mode;
+    uint8_t *buf;
+    uint32_t size, n_entries, nl, symbol, s, n_tunes = 0;
+    huffman_buffer *h_buffer;
+    uint64_t *counts; /* [class][symbol] */
+    uint64_t totals[N_CLASSES], class_bits[N_CLASSES], distinct, n_symbols = 0;
+    uint64_t *symbol_totals, data_bits = 0, notes, tune_start, tune_notes;
+    uint64_t min_tune = UINT64_MAX, max_tune = 0;
+    double ideal[N_CLASSES], ideal_total = 0;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--tunes"))
+            per_tune = 1;
+        else if(in_name==NULL)
+            in_name = argv[i];
+    }
+    if(in_name==NULL) {
+        usage();
+        return 1;
+    }
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+
+    n_entries = h_buffer->table->n_entries;
+    counts = calloc((size_t)N_CLASSES*n_entries, sizeof(uint64_t));
+    symbol_totals = calloc(n_entries, sizeof(uint64_t));
+    memset(totals, 0, sizeof(totals));
+    memset(class_bits, 0, sizeof(class_bits));
+    nl = lookup_symbol_index(TUNE_TERMINATOR, h_buffer->table);
+
+    /* One pass over the data, classifying each symbol as the parser
+    would. The end marker (empty tunes) counts towards the end class. */
+    reset_buffer(h_buffer);
+    tune_start = 0;
+    tune_notes = 0;
+    string_mode = 0;
+    while(h_buffer->pos < h_buffer->n_bits) {
+        symbol = read_symbol(h_buffer);
+        token = TOKEN_STRING(h_buffer->table, symbol);
+        c = token_class(token, string_mode);
+        if(string_mode)
+            string_mode = c==CLASS_TEXT;
+        else if(token[0]=='*' && (!strcmp(token+1, "title") || !strcmp(token+1, "rhythm")))
+            string_mode = 1;
+        counts[(size_t)c*n_entries+symbol]++;
+        symbol_totals[symbol]++;
+        totals[c]++;
+        class_bits[c] += h_buffer->table->n_bits[symbol];
+        n_symbols++;
+        if(c==CLASS_PITCH || c==CLASS_REST)
+            tune_notes++;
+        if(symbol!=nl)
+            continue;
+        if(h_buffer->pos - tune_start > h_buffer->table->n_bits[nl]) {
+            if(per_tune) {
+                printf("tune_%u_bits %llu\n", n_tunes, (unsigned long long)(h_buffer->pos - tune_start));
+                printf("tune_%u_notes %llu\n", n_tunes, (unsigned long long)tune_notes);
+            }
+            if(h_buffer->pos - tune_start < min_tune)
+                min_tune = h_buffer->pos - tune_start;
+            if(h_buffer->pos - tune_start > max_tune)
+                max_tune = h_buffer->pos - tune_start;
+            n_tunes++;
+        }
+        tune_start = h_buffer->pos;
+        tune_notes = 0;
+    }
+
+    /* Ideal costs use each symbol's probability over the whole file */
+    for(c=0; c<N_CLASSES; c++) {
+        ideal[c] = 0;
+        for(s=0; s<n_entries; s++)
+            if(counts[(size_t)c*n_entries+s])
+                ideal[c] -= counts[(size_t)c*n_entries+s] * log2((double)symbol_totals[s]/n_symbols);
+        ideal_total += ideal[c];
+        data_bits += class_bits[c];
+    }
+    notes = totals[CLASS_PITCH] + totals[CLASS_REST];
+
+    printf("file_bytes %u\n", size);
+    printf("table_bytes %lu\n", (unsigned long)((uint8_t*)h_buffer->buf - 4 - buf));
+    printf("data_bits %u\n", h_buffer->n_bits);
+    printf("table_entries %u\n", n_entries);
+    printf("tunes %u\n", n_tunes);
+    printf("symbols %llu\n", (unsigned long long)n_symbols);
+    printf("notes %llu\n", (unsigned long long)notes);
+    printf("entropy %.4f\n", entropy_bits(symbol_totals, n_entries, n_symbols)/n_symbols);
+    printf("mean_code %.4f\n", (double)data_bits/n_symbols);
+    printf("ideal_bits %.0f\n", ideal_total);
+    printf("actual_bits %llu\n", (unsigned long long)data_bits);
+    printf("gap_bits %.0f\n", data_bits - ideal_total);
+    printf("efficiency %.4f\n", ideal_total/data_bits);
+    printf("bits_per_note %.3f\n", notes ? (double)data_bits/notes : 0.0);
+    printf("bits_per_tune %.1f\n", n_tunes ? (double)data_bits/n_tunes : 0.0);
+    printf("min_tune_bits %llu\n", (unsigned long long)(n_tunes ? min_tune : 0));
+    printf("max_tune_bits %llu\n", (unsigned long long)max_tune);
+    for(c=0; c<N_CLASSES; c++) {
+        if(totals[c]==0)
+            continue;
+        for(s=0, distinct=0; s<n_entries; s++)
+            distinct += counts[(size_t)c*n_entries+s]!=0;
+        printf("class_%s_symbols %llu\n", class_names[c], (unsigned long long)totals[c]);
+        printf("class_%s_distinct %llu\n", class_names[c], (unsigned long long)distinct);
+        printf("class_%s_entropy %.4f\n", class_names[c], entropy_bits(counts+(size_t)c*n_entries, n_entries, totals[c])/totals[c]);
+        printf("class_%s_ideal_bits %.0f\n", class_names[c], ideal[c]);
+        printf("class_%s_actual_bits %llu\n", class_names[c], (unsigned long long)class_bits[c]);
+        printf("class_%s_mean_code %.4f\n", class_names[c], (double)class_bits[c]/totals[c]);
+        printf("class_%s_share %.4f\n", class_names[c], (double)class_bits[c]/data_bits);
+    }
+
+    free(counts);
+    free(symbol_totals);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return 0;
+}
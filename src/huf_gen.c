@@ -0,0 +1,481 @@
+/* Generate synthetic tunebooks, for benchmarking on files much larger
+than the examples.
+
+    huf_gen [--fit <in.huf>] [--tunes <n>] [--length <tokens>] [--alphabet <n>]
+            [--zipf <s>] [--unigram] [--seed <n>] <out.huf>
+
+With --fit, tunes are drawn from a first-order Markov model of the
+tokens in an existing file (or, with --unigram, from their frequencies),
+so the token distribution and tune length match it. Without, tokens are
+drawn independently from a Zipf distribution (exponent --zipf) over a
+made-up alphabet of notes, rests, durations, bars, keys and chords.
+--alphabet keeps only the n most frequent tokens; --length sets the mean
+number of tokens per tune (lengths vary uniformly by +/-50%).
+
+Every tune has a title ("Tune <n>"). Pitches and durations are kept in
+range by redrawing tokens that would take them out. The output is
+generated twice from the same seed, once to count the tokens and once
+to write the codes, so memory use does not grow with --tunes.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "huffman_encode.h"
+#include "binary.h"
+
+#define MIN_NOTE 24
+#define MAX_NOTE 108
+#define MAX_REDRAWS 16
+#define TITLE_CHARS "Tune 0123456789"
+
+typedef struct gen_options
+{
+    char *fit_name;
+    uint32_t n_tunes;
+    uint32_t length; /* 0 = fitted mean */
+    uint32_t alphabet; /* 0 = all */
+    double zipf;
+    int unigram;
+    uint64_t seed;
+} gen_options;
+
+/* Tokens, and the cumulative distribution of the next token for each
+state. State 0 is the start of a tune; for a Markov model, state i+1
+follows token i. A unigram model has only state 0. */
+typedef struct gen_model
+{
+    uint32_t n_tokens;
+    char **tokens;
+    uint32_t n_states;
+    double *cdf; /* n_states rows of n_tokens */
+    double mean_length;
+    /* every token the output uses: the model's, then \n, *title, *, and title characters */
+    uint32_t n_symbols;
+    char **symbols;
+    uint32_t nl, title, end_string, title_chars[256];
+    /* pitch and duration change of each model token, to keep them in range */
+    int32_t *pitch_step;
+    double *duration_step; /* 0 for a bar duration change, which resets the duration */
+} gen_model;
+
+typedef struct generator
+{
+    uint64_t rng;
+    void (*emit)(struct generator *gen, uint32_t symbol);
+    uint64_t *counts; /* when counting */
+    bit_writer bw; /* when writing */
+    huffman_table *table;
+} generator;
+
+void usage()
+{
+    printf("Usage: huf_gen [--fit <in.huf>] [--tunes <n>] [--length <tokens>] [--alphabet <n>]\n");
+    printf("               [--zipf <s>] [--unigram] [--seed <n>] <out.huf>\n");
+}
+
+static double random_unit(generator *gen)
+{
+    /* xorshift64*, uniform in [0,1) */
+    gen->rng ^= gen->rng >> 12;
+    gen->rng ^= gen->rng << 25;
+    gen->rng ^= gen->rng >> 27;
+    return ((gen->rng * 2685821657736338717ULL) >> 11) * (1.0/9007199254740992.0);
+}
+
+static uint32_t draw(generator *gen, double *cdf, uint32_t n)
+{
+    /* Draw an index from a cumulative distribution */
+    double u = random_unit(gen) * cdf[n-1];
+    uint32_t lo = 0, hi = n-1, mid;
+    while(lo<hi) {
+        mid = (lo+hi)/2;
+        if(cdf[mid] > u)
+            hi = mid;
+        else
+            lo = mid+1;
+    }
+    return lo;
+}
+
+static uint32_t add_token(char ***tokens, uint32_t *n, uint32_t *max, const char *token)
+{
+    /* Add token to a list if it is not already there; return its index */
+    uint32_t i;
+    for(i=0; i<*n; i++)
+        if(!strcmp((*tokens)[i], token))
+            return i;
+    if(*n==*max) {
+        *max = *max ? *max*2 : 64;
+        *tokens = realloc(*tokens, sizeof(char*)**max);
+    }
+    (*tokens)[*n] = malloc(strlen(token)+1);
+    strcpy((*tokens)[*n], token);
+    return (*n)++;
+}
+
+static int is_body_token(char *token)
+{
+    /* Tokens the model draws: everything but tune ends and text fields */
+    return strcmp(token, TUNE_TERMINATOR) && token[0]!='*';
+}
+
+static int fit_counts(char *fname, char ***tokens, uint32_t *n_tokens, double **counts, double *mean_length)
+{
+    /* Count the body tokens of every tune in fname, and the transitions
+    between them (from the start of a tune to the first token, and
+    from each token to the next) into counts, (n_tokens+1) x n_tokens */
+    uint8_t *buf;
+    uint32_t size, symbol, nl, max_tokens = 0, n_tunes = 0, i, state;
+    uint64_t n_body = 0;
+    huffman_buffer *h_buffer;
+    uint32_t *token_of; /* table symbol -> model token, or INVALID_CODE */
+    char *token;
+    int string_mode;
+
+    buf = load_file(fname, &size);
+    if(buf==NULL)
+        return 0;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 0;
+    nl = lookup_symbol_index(TUNE_TERMINATOR, h_buffer->table);
+    token_of = malloc(sizeof(uint32_t)*h_buffer->table->n_entries);
+    *n_tokens = 0;
+    *tokens = NULL;
+    for(i=0; i<h_buffer->table->n_entries; i++) {
+        token = TOKEN_STRING(h_buffer->table, i);
+        token_of[i] = is_body_token(token) ? add_token(tokens, n_tokens, &max_tokens, token) : INVALID_CODE;
+    }
+    *counts = calloc((size_t)(*n_tokens+1)**n_tokens, sizeof(double));
+
+    reset_buffer(h_buffer);
+    while((symbol = read_symbol(h_buffer))!=nl) {
+        /* One tune */
+        state = 0;
+        string_mode = 0;
+        for(; symbol!=nl; symbol = read_symbol(h_buffer)) {
+            token = TOKEN_STRING(h_buffer->table, symbol);
+            if(string_mode) {
+                if(!strcmp(token, STRING_TERMINATOR))
+                    string_mode = 0;
+                continue;
+            }
+            if(token[0]=='*') {
+                string_mode = strcmp(token, STRING_TERMINATOR)!=0;
+                continue;
+            }
+            (*counts)[(size_t)state**n_tokens + token_of[symbol]] += 1;
+            state = token_of[symbol]+1;
+            n_body++;
+        }
+        n_tunes++;
+    }
+    *mean_length = n_tunes ? (double)n_body/n_tunes : 0;
+    free(token_of);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return 1;
+}
+
+static void zipf_counts(uint32_t alphabet, char ***tokens, uint32_t *n_tokens, double **counts, double s)
+{
+    /* Make up an alphabet of alphabet tokens, most common first, with
+    Zipf-distributed frequencies */
+    static const char *common[] = {"|", "+0", "+2", "-2", "+1", "-1", "/2/1", "/1/2", "~", "+3", "-3",
+        "+4", "-4", "+5", "-5", "/3/2", "/2/3", "+7", "-7", "^2000000", "&gmaj", "&dmaj", "%6\\8",
+        "#Gmaj", "#Dmaj", "#Cmaj", "#Amin", "/3/1", "/1/3", "+12", "-12"};
+    uint32_t n_common = sizeof(common)/sizeof(common[0]), max_tokens = 0, i, k;
+    char token[MAX_TOKEN];
+
+    *n_tokens = 0;
+    *tokens = NULL;
+    for(i=0; i<n_common && *n_tokens<alphabet; i++)
+        add_token(tokens, n_tokens, &max_tokens, common[i]);
+    for(k=6; k<=99 && *n_tokens<alphabet; k++) {
+        sprintf(token, "+%d", k);
+        add_token(tokens, n_tokens, &max_tokens, token);
+        if(*n_tokens<alphabet) {
+            sprintf(token, "-%d", k);
+            add_token(tokens, n_tokens, &max_tokens, token);
+        }
+    }
+    for(k=0; *n_tokens<alphabet; k++) {
+        sprintf(token, "#c%d", k); /* chords of up to six characters */
+        add_token(tokens, n_tokens, &max_tokens, token);
+    }
+    *counts = malloc(sizeof(double)**n_tokens);
+    for(i=0; i<*n_tokens; i++)
+        (*counts)[i] = 1.0/pow(i+1, s);
+}
+
+static void keep_most_frequent(gen_model *model, double *counts, uint32_t alphabet)
+{
+    /* Drop all but the alphabet most frequent tokens (by their total count)
+    from a fitted model */
+    uint32_t n = model->n_tokens, n_rows = model->n_states, i, j, k, best;
+    double *totals = calloc(n, sizeof(double));
+    uint8_t *keep = calloc(n, 1);
+    uint32_t *new_index = malloc(sizeof(uint32_t)*n);
+    double *new_counts;
+
+    for(i=0; i<n_rows; i++)
+        for(j=0; j<n; j++)
+            totals[j] += counts[(size_t)i*n+j];
+    for(k=0; k<alphabet && k<n; k++) {
+        best = INVALID_CODE;
+        for(j=0; j<n; j++)
+            if(!keep[j] && (best==INVALID_CODE || totals[j]>totals[best]))
+                best = j;
+        keep[best] = 1;
+    }
+    for(j=0, k=0; j<n; j++)
+        new_index[j] = keep[j] ? k++ : INVALID_CODE;
+    new_counts = calloc((size_t)(n_rows==1 ? 1 : k+1)*k, sizeof(double));
+    for(i=0; i<n_rows; i++) {
+        if(i>0 && !keep[i-1])
+            continue;
+        for(j=0; j<n; j++)
+            if(keep[j])
+                new_counts[(size_t)(i==0 ? 0 : new_index[i-1]+1)*k + new_index[j]] = counts[(size_t)i*n+j];
+    }
+    for(j=0; j<n; j++) {
+        if(keep[j])
+            model->tokens[new_index[j]] = model->tokens[j];
+        else
+            free(model->tokens[j]);
+    }
+    model->n_tokens = k;
+    model->n_states = n_rows==1 ? 1 : k+1;
+    memcpy(counts, new_counts, sizeof(double)*model->n_states*k);
+    free(new_counts);
+    free(new_index);
+    free(keep);
+    free(totals);
+}
+
+static void token_steps(gen_model *model)
+{
+    /* How each token moves the pitch and duration */
+    uint32_t i;
+    huffman_op op;
+    model->pitch_step = malloc(sizeof(int32_t)*model->n_tokens);
+    model->duration_step = malloc(sizeof(double)*model->n_tokens);
+    for(i=0; i<model->n_tokens; i++) {
+        parse_op(model->tokens[i], &op);
+        model->pitch_step[i] = op.op=='+' ? op.a : (op.op=='-' ? -op.a : 0);
+        if(op.op=='/')
+            model->duration_step[i] = op.b ? (double)op.a/op.b : 1.0;
+        else
+            model->duration_step[i] = op.op=='^' ? 0.0 : 1.0;
+    }
+}
+
+static gen_model *build_model(gen_options *opts)
+{
+    /* Fit or make up the token distribution, then add the symbols
+    every tune needs */
+    gen_model *model = malloc(sizeof(gen_model));
+    double *counts, *row, sum;
+    uint32_t i, j, max_symbols = 0;
+    char ch[2] = " ";
+    const char *p;
+
+    if(opts->fit_name) {
+        if(!fit_counts(opts->fit_name, &model->tokens, &model->n_tokens, &counts, &model->mean_length))
+            return NULL;
+        model->n_states = model->n_tokens+1;
+        if(opts->unigram) {
+            /* Collapse the transitions to plain frequencies */
+            for(i=1; i<model->n_states; i++)
+                for(j=0; j<model->n_tokens; j++)
+                    counts[j] += counts[(size_t)i*model->n_tokens+j];
+            model->n_states = 1;
+        }
+        if(opts->alphabet && opts->alphabet < model->n_tokens)
+            keep_most_frequent(model, counts, opts->alphabet);
+    }
+    else {
+        zipf_counts(opts->alphabet ? opts->alphabet : 64, &model->tokens, &model->n_tokens, &counts, opts->zipf);
+        model->n_states = 1;
+        model->mean_length = 200;
+    }
+    if(model->n_tokens==0) {
+        printf("Error: no tokens to generate from\n");
+        return NULL;
+    }
+    if(opts->length)
+        model->mean_length = opts->length;
+
+    /* Cumulative rows; a state never seen falls back to the start state */
+    model->cdf = malloc(sizeof(double)*model->n_states*model->n_tokens);
+    for(i=0; i<model->n_states; i++) {
+        row = counts + (size_t)i*model->n_tokens;
+        for(sum=0, j=0; j<model->n_tokens; j++)
+            sum += row[j];
+        if(sum==0)
+            row = counts;
+        for(sum=0, j=0; j<model->n_tokens; j++) {
+            sum += row[j];
+            model->cdf[(size_t)i*model->n_tokens+j] = sum;
+        }
+    }
+    free(counts);
+    token_steps(model);
+
+    model->n_symbols = 0;
+    model->symbols = NULL;
+    for(i=0; i<model->n_tokens; i++)
+        add_token(&model->symbols, &model->n_symbols, &max_symbols, model->tokens[i]);
+    model->nl = add_token(&model->symbols, &model->n_symbols, &max_symbols, TUNE_TERMINATOR);
+    model->title = add_token(&model->symbols, &model->n_symbols, &max_symbols, "*title");
+    model->end_string = add_token(&model->symbols, &model->n_symbols, &max_symbols, STRING_TERMINATOR);
+    for(p=TITLE_CHARS; *p; p++) {
+        ch[0] = *p;
+        model->title_chars[(uint8_t)*p] = add_token(&model->symbols, &model->n_symbols, &max_symbols, ch);
+    }
+    return model;
+}
+
+static void free_model(gen_model *model)
+{
+    uint32_t i;
+    for(i=0; i<model->n_tokens; i++)
+        free(model->tokens[i]);
+    for(i=0; i<model->n_symbols; i++)
+        free(model->symbols[i]);
+    free(model->tokens);
+    free(model->symbols);
+    free(model->cdf);
+    free(model->pitch_step);
+    free(model->duration_step);
+    free(model);
+}
+
+static void generate(gen_model *model, gen_options *opts, generator *gen)
+{
+    /* Generate every tune, passing each symbol to gen->emit */
+    uint32_t tune, i, length, state, token, tries;
+    int32_t pitch;
+    double duration;
+    char title[32], *p;
+
+    gen->rng = opts->seed ? opts->seed : 1;
+    for(tune=0; tune<opts->n_tunes; tune++) {
+        sprintf(title, "Tune %u", tune);
+        gen->emit(gen, model->title);
+        for(p=title; *p; p++)
+            gen->emit(gen, model->title_chars[(uint8_t)*p]);
+        gen->emit(gen, model->end_string);
+
+        length = (uint32_t)(model->mean_length * (0.5 + random_unit(gen)));
+        if(length==0)
+            length = 1;
+        state = 0;
+        pitch = BASE_NOTE;
+        duration = 1.0;
+        for(i=0; i<length; i++) {
+            /* Redraw tokens that would take the pitch or duration out of range */
+            for(tries=0; tries<MAX_REDRAWS; tries++) {
+                token = draw(gen, model->cdf + (size_t)state*model->n_tokens, model->n_tokens);
+                if(pitch+model->pitch_step[token] >= MIN_NOTE && pitch+model->pitch_step[token] <= MAX_NOTE &&
+                   duration*model->duration_step[token] <= 16.0 && (model->duration_step[token]==0 || duration*model->duration_step[token] >= 1.0/64))
+                    break;
+            }
+            pitch += model->pitch_step[token];
+            duration = model->duration_step[token]==0 ? 1.0 : duration*model->duration_step[token];
+            gen->emit(gen, token); /* model tokens come first in the symbols */
+            if(model->n_states>1)
+                state = token+1;
+        }
+        gen->emit(gen, model->nl);
+    }
+    /* An empty tune marks the end, as huf_compress_tune.lua writes */
+    gen->emit(gen, model->nl);
+    gen->emit(gen, model->nl);
+}
+
+static void count_symbol(generator *gen, uint32_t symbol)
+{
+    gen->counts[symbol]++;
+}
+
+static void write_symbol_bits(generator *gen, uint32_t symbol)
+{
+    write_symbol(&gen->bw, gen->table, symbol);
+}
+
+int main(int argc, char **argv)
+{
+    gen_options opts = {NULL, 1000, 0, 0, 1.0, 0, 1};
+    char *out_name = NULL;
+    gen_model *model;
+    generator gen;
+    uint64_t n_bits;
+    FILE *f;
+    int i;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--fit") && i+1<argc)
+            opts.fit_name = argv[++i];
+        else if(!strcmp(argv[i], "--tunes") && i+1<argc)
+            opts.n_tunes = strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--length") && i+1<argc)
+            opts.length = strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--alphabet") && i+1<argc)
+            opts.alphabet = strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--zipf") && i+1<argc)
+            opts.zipf = atof(argv[++i]);
+        else if(!strcmp(argv[i], "--seed") && i+1<argc)
+            opts.seed = strtoull(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--unigram"))
+            opts.unigram = 1;
+        else if(out_name==NULL)
+            out_name = argv[i];
+    }
+    if(out_name==NULL) {
+        usage();
+        return 1;
+    }
+    model = build_model(&opts);
+    if(model==NULL)
+        return 1;
+
+    /* Pass 1: count */
+    gen.counts = calloc(model->n_symbols, sizeof(uint64_t));
+    gen.emit = count_symbol;
+    generate(model, &opts, &gen);
+    gen.table = build_huffman_codes(model->symbols, gen.counts, model->n_symbols);
+    if(gen.table==NULL)
+        return 1;
+    n_bits = encoded_bits(gen.table, gen.counts);
+    if(n_bits > 0xFFFFFFFFu) {
+        printf("Error: %llu bits of data is too many for a HUFM file\n", (unsigned long long)n_bits);
+        return 1;
+    }
+
+    /* Pass 2: write */
+    f = fopen(out_name, "wb");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        return 1;
+    }
+    write_huffman_header(f, gen.table, (uint32_t)n_bits);
+    init_bit_writer(&gen.bw, f);
+    gen.emit = write_symbol_bits;
+    generate(model, &opts, &gen);
+    flush_bits(&gen.bw);
+    fclose(f);
+    fprintf(stderr, "Wrote %s (%u tunes, %u symbols, %llu bytes of data)\n", out_name,
+            opts.n_tunes, model->n_symbols, (unsigned long long)(n_bits+7)/8);
+
+    free_huffman_table(gen.table);
+    free(gen.counts);
+    free_model(model);
+    return 0;
+}
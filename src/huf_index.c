@@ -0,0 +1,314 @@
+/* Append optional index sections to a .huf file, or look tunes up in them.
+
+    huf_index [--no-titles] [--no-tunes] [--no-meta] [--no-summary] [--no-crc]
+              [--chunk <bytes>] in.huf out.huf
+    huf_index --find <title> in.huf
+    huf_index --prefix <prefix> in.huf
+    huf_index --list in.huf
+    huf_index --summary in.huf
+    huf_index --verify in.huf
+
+The checksum section (see huffman_crc.h) covers the header and every
+--chunk bytes (default 1024) of the data. --verify checks them all and
+prints "name value" lines: header and table (ok or bad), chunks,
+bad_chunks, bad_tunes, mbyte_per_s, then "bad_tune <n>" for each tune
+that crosses a corrupt chunk or does not decode. Only the header and
+table must be intact for the rest to be checked.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "title_directory.h"
+#include "tune_catalogue.h"
+#include "tune_summary.h"
+#include "huffman_crc.h"
+#include "huffman_validate.h"
+#include "binary.h"
+
+#define MAX_MATCHES 64
+
+/* Which sections to write */
+typedef struct index_options
+{
+    int titles;
+    int tunes;
+    int meta;
+    int summary;
+    int crc;
+    uint32_t chunk_bytes;
+} index_options;
+
+void usage()
+{
+    printf("Usage: huf_index [--no-titles] [--no-tunes] [--no-meta] [--no-summary] [--no-crc]\n");
+    printf("                 [--chunk <bytes>] <in.huf> <out.huf>\n");
+    printf("       huf_index --find <title> <in.huf>\n");
+    printf("       huf_index --prefix <prefix> <in.huf>\n");
+    printf("       huf_index --list <in.huf>\n");
+    printf("       huf_index --summary <in.huf>\n");
+    printf("       huf_index --verify <in.huf>\n");
+}
+
+int is_rewritten(uint8_t *tag, index_options *opts)
+{
+    /* Is this a section that we are about to write afresh? */
+    return (opts->titles && !memcmp(tag, TITLE_DIRECTORY_TAG, 4)) ||
+           (opts->tunes && !memcmp(tag, TUNE_INDEX_TAG, 4)) ||
+           (opts->meta && !memcmp(tag, TUNE_METADATA_TAG, 4)) ||
+           (opts->summary && !memcmp(tag, TUNE_SUMMARY_TAG, 4)) ||
+           (opts->crc && !memcmp(tag, CRC_TAG, 4));
+}
+
+int write_index(huffman_buffer *h_buffer, uint8_t *buf, uint8_t *file_end, char *out_name, index_options *opts)
+{
+    /* Write the file with fresh index sections to out_name */
+    FILE *f;
+    uint8_t *p = data_end(h_buffer), *tag;
+    uint32_t length;
+    uint32_t *index;
+    uint8_t *section;
+    title_directory *dir;
+
+    f = fopen(out_name, "wb");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        return 1;
+    }
+    /* Header, table and compressed data are copied unchanged */
+    write_bytes(f, buf, p-buf);
+    /* Keep any existing sections we don't regenerate */
+    while(p+8 <= file_end) {
+        tag = p;
+        p += 4;
+        length = readbuf_u32(&p);
+        if(!is_rewritten(tag, opts))
+            write_section(f, (char*)tag, p, length);
+        p += length;
+    }
+    index = create_tune_index(h_buffer);
+    if(opts->tunes) {
+        section = build_index_section(index, &length);
+        write_section(f, TUNE_INDEX_TAG, section, length);
+        printf("%d tunes\n", index[0]);
+        free(section);
+    }
+    if(opts->titles) {
+        dir = build_title_directory(h_buffer, index);
+        if(dir) {
+            write_section(f, TITLE_DIRECTORY_TAG, dir->data, dir->length);
+            printf("%d titles\n", dir->n_titles);
+            free_title_directory(dir);
+        }
+        else
+            printf("No title directory written\n");
+    }
+    if(opts->meta) {
+        section = build_metadata_section(h_buffer, index, &length);
+        write_section(f, TUNE_METADATA_TAG, section, length);
+        free(section);
+    }
+    if(opts->summary) {
+        section = build_summary_section(h_buffer, index, &length);
+        write_section(f, TUNE_SUMMARY_TAG, section, length);
+        free(section);
+    }
+    if(opts->crc) {
+        section = build_crc_section(buf, h_buffer, opts->chunk_bytes, &length);
+        write_section(f, CRC_TAG, section, length);
+        free(section);
+    }
+    free(index);
+    fclose(f);
+    return 0;
+}
+
+int find_titles(huffman_buffer *h_buffer, uint8_t *file_end, char *title, int prefix)
+{
+    /* Print the tunes matching title, using the directory in the file
+    if there is one, or building one otherwise */
+    uint32_t tunes[MAX_MATCHES];
+    uint32_t i, n, *index = load_tune_index(h_buffer, file_end);
+    title_directory *dir = load_title_directory(h_buffer, file_end, index[0]);
+    if(dir==NULL) {
+        printf("No usable title directory in file; building one\n");
+        dir = build_title_directory(h_buffer, index);
+    }
+    free(index);
+    if(dir==NULL)
+        return 1;
+    if(prefix)
+        n = find_tunes_by_prefix(dir, title, tunes, MAX_MATCHES);
+    else {
+        tunes[0] = find_tune_by_title(dir, title);
+        n = tunes[0]!=INVALID_CODE;
+    }
+    for(i=0; i<n; i++)
+        printf("%d\n", tunes[i]);
+    free_title_directory(dir);
+    return n==0;
+}
+
+int list_tunes(huffman_buffer *h_buffer, uint8_t *file_end)
+{
+    /* Print the metadata of every tune, one per line */
+    uint32_t *index = load_tune_index(h_buffer, file_end);
+    tune_metadata *catalogue = read_catalogue(h_buffer, file_end, index);
+    uint32_t i;
+    for(i=0; i<index[0]; i++) {
+        printf("%d\t%s\t%s\t%d/%d\t%s\t%d\n", i, catalogue[i].title, catalogue[i].key,
+               catalogue[i].meter_numerator, catalogue[i].meter_denominator,
+               catalogue[i].rhythm, catalogue[i].bar_duration);
+    }
+    free(catalogue);
+    free(index);
+    return 0;
+}
+
+int summarise_tunes(huffman_buffer *h_buffer, uint8_t *file_end)
+{
+    /* Print the duration, sample count at SUMMARY_SAMPLE_RATE, note
+    range, bars and tempo of every tune, one per line, from the summary
+    section if there is one */
+    uint32_t *index = load_tune_index(h_buffer, file_end);
+    uint8_t *section = load_summary_section(h_buffer, file_end, index[0]);
+    tune_summary summary;
+    uint32_t i;
+    for(i=0; i<index[0]; i++) {
+        get_tune_summary(h_buffer, section, index, i, SUMMARY_SAMPLE_RATE, &summary);
+        printf("%d\t%.3f\t%llu\t%d\t%d\t%d-%d\t%d\t%d\t%d\n", i, summary.duration_us/1e6,
+               (unsigned long long)summary.n_samples, summary.n_notes, summary.n_rests,
+               summary.min_note, summary.max_note, summary.n_bars,
+               summary.bar_duration, summary.n_tempo_changes);
+    }
+    free(index);
+    return 0;
+}
+
+int verify_file(uint8_t *buf, uint32_t size)
+{
+    /* Check the header, then every chunk against the checksum section,
+    and list the tunes that cross a corrupt one or do not decode. The
+    file is opened without checking its tunes, so that a flipped bit
+    costs only the tunes around it, and its table is only checked once
+    the header is known to be intact. */
+    uint8_t *file_end = buf+size, *bad;
+    huffman_buffer *h_buffer = open_huffman(buf, size);
+    crc_check *check;
+    uint32_t *index = NULL, i, n_bad_tunes = 0;
+    int table_ok, ok;
+    clock_t t0;
+    double ms;
+    if(h_buffer==NULL)
+        return 1;
+    check = load_crc_check(buf, h_buffer, file_end);
+    if(check==NULL) {
+        printf("Error: no checksum section\n");
+        free_huffman_table(h_buffer->table);
+        free(h_buffer);
+        return 1;
+    }
+    table_ok = check->header_ok && check_huffman_table(h_buffer);
+    t0 = clock();
+    check_all(check);
+    ms = 1000.0*(clock()-t0)/CLOCKS_PER_SEC;
+    /* Without an index section, the index is found by decoding, which
+    a bad chunk can throw off; the tunes listed are then approximate */
+    if(table_ok)
+        index = load_tune_index(h_buffer, file_end);
+    bad = calloc(index ? index[0]+1 : 1, 1);
+    for(i=0; index && i<index[0]; i++) {
+        bad[i] = !check_tune(check, index, i, h_buffer->n_bits) || !check_huffman_tune(h_buffer, index, i);
+        n_bad_tunes += bad[i];
+    }
+    printf("header %s\n", check->header_ok ? "ok" : "bad");
+    printf("table %s\n", table_ok ? "ok" : "bad");
+    printf("chunks %u\n", check->n_chunks);
+    printf("bad_chunks %u\n", check->n_bad);
+    printf("bad_tunes %u\n", n_bad_tunes);
+    printf("mbyte_per_s %.1f\n", ms>0 ? check->data_bytes/ms/1000.0 : 0.0);
+    for(i=0; index && i<index[0]; i++)
+        if(bad[i])
+            printf("bad_tune %u\n", i);
+    ok = table_ok && check->n_bad==0 && n_bad_tunes==0;
+    free(bad);
+    free(index);
+    free_crc_check(check);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    return !ok;
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *out_name = NULL, *title = NULL;
+    int prefix = 0, list = 0, summary = 0, verify = 0;
+    index_options opts = {1, 1, 1, 1, 1, DEFAULT_CRC_CHUNK};
+    int i, result;
+    uint8_t *buf;
+    uint32_t size;
+    huffman_buffer *h_buffer;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--no-titles"))
+            opts.titles = 0;
+        else if(!strcmp(argv[i], "--no-tunes"))
+            opts.tunes = 0;
+        else if(!strcmp(argv[i], "--no-meta"))
+            opts.meta = 0;
+        else if(!strcmp(argv[i], "--no-summary"))
+            opts.summary = 0;
+        else if(!strcmp(argv[i], "--no-crc"))
+            opts.crc = 0;
+        else if(!strcmp(argv[i], "--chunk") && i+1<argc)
+            opts.chunk_bytes = strtoul(argv[++i], NULL, 10);
+        else if(!strcmp(argv[i], "--verify"))
+            verify = 1;
+        else if(!strcmp(argv[i], "--list"))
+            list = 1;
+        else if(!strcmp(argv[i], "--summary"))
+            summary = 1;
+        else if((!strcmp(argv[i], "--find") || !strcmp(argv[i], "--prefix")) && i+1<argc) {
+            prefix = !strcmp(argv[i], "--prefix");
+            title = argv[++i];
+        }
+        else if(in_name==NULL)
+            in_name = argv[i];
+        else if(out_name==NULL)
+            out_name = argv[i];
+    }
+    if(in_name==NULL || (title==NULL && !list && !summary && !verify && out_name==NULL)) {
+        usage();
+        return 1;
+    }
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    if(verify) {
+        result = verify_file(buf, size);
+        free(buf);
+        return result;
+    }
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+
+    if(title)
+        result = find_titles(h_buffer, buf+size, title, prefix);
+    else if(list)
+        result = list_tunes(h_buffer, buf+size);
+    else if(summary)
+        result = summarise_tunes(h_buffer, buf+size);
+    else
+        result = write_index(h_buffer, buf, buf+size, out_name, &opts);
+
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return result;
+}
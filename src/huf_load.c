@@ -0,0 +1,274 @@
+/* Load generator for huf_server: many clients requesting random tunes
+at once, reporting throughput and latency.
+
+    huf_load [--socket <path>] [--clients <n>] [--requests <n>]
+             [--kind pcm|events|list] [--seed <n>]
+
+Each client (a thread with its own connection) sends --requests
+(default 100) requests one after another, for random tunes of random
+books, and reads each whole response. Prints "name value" lines:
+requests, errors, bytes, seconds, requests_per_s, mbyte_per_s, and the
+latency from sending a request to its last byte at the 50th, 90th, 99th
+percentiles and the maximum, in milliseconds.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "tune_server.h"
+#include "binary.h"
+
+#define MAX_BOOKS 256
+
+typedef struct load_options
+{
+    char *socket_path;
+    uint32_t n_clients;
+    uint32_t n_requests;
+    char *kind; /* "PCM", "EVENTS" or "LIST" */
+    uint32_t seed;
+    uint32_t n_books;
+    uint32_t n_tunes[MAX_BOOKS];
+} load_options;
+
+typedef struct client
+{
+    load_options *opts;
+    uint32_t id;
+    double *latencies; /* ms, one per request */
+    uint64_t bytes;
+    uint32_t errors;
+} client;
+
+void usage()
+{
+    printf("Usage: huf_load [--socket <path>] [--clients <n>] [--requests <n>]\n");
+    printf("                [--kind pcm|events|list] [--seed <n>]\n");
+}
+
+static double now_ms()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1000.0 + t.tv_nsec/1e6;
+}
+
+static int connect_server(char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("Error: could not connect to %s\n", path);
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int read_full(int fd, uint8_t *dest, uint32_t n)
+{
+    /* Read exactly n bytes; returns 0 if the connection closes first */
+    ssize_t got;
+    while(n > 0) {
+        got = recv(fd, dest, n, 0);
+        if(got <= 0)
+            return 0;
+        dest += got;
+        n -= got;
+    }
+    return 1;
+}
+
+static int64_t read_response(int fd, uint8_t *scratch, uint32_t scratch_size, char *status, uint32_t status_size, char *text, uint32_t text_size)
+{
+    /* Read a whole response, copying the status chunk and, if text is
+    not NULL, the start of the data. Returns the number of bytes read,
+    or -1 if the connection failed. */
+    uint8_t header[4], *p;
+    uint32_t length, part, copy, n_chunks = 0, text_len = 0;
+    int64_t total = 0;
+    while(1) {
+        if(!read_full(fd, header, 4))
+            return -1;
+        p = header;
+        length = readbuf_u32(&p);
+        total += 4 + length;
+        if(length==0)
+            return total;
+        while(length > 0) {
+            part = length < scratch_size ? length : scratch_size;
+            if(!read_full(fd, scratch, part))
+                return -1;
+            if(n_chunks==0) {
+                copy = part < status_size-1 ? part : status_size-1;
+                memcpy(status, scratch, copy);
+                status[copy] = '\0';
+            }
+            else if(text && text_len+1 < text_size) {
+                copy = part < text_size-1-text_len ? part : text_size-1-text_len;
+                memcpy(text+text_len, scratch, copy);
+                text_len += copy;
+                text[text_len] = '\0';
+            }
+            length -= part;
+        }
+        n_chunks++;
+    }
+}
+
+static void *client_thread(void *arg)
+{
+    client *cl = (client*)arg;
+    load_options *opts = cl->opts;
+    uint8_t scratch[SERVER_CHUNK];
+    char request[MAX_REQUEST], status[64];
+    uint32_t r, book, state = opts->seed*2654435761u + cl->id*40503u + 1;
+    int64_t n;
+    double t0;
+    int fd = connect_server(opts->socket_path);
+
+    for(r=0; r<opts->n_requests; r++) {
+        if(fd < 0) {
+            cl->errors++;
+            cl->latencies[r] = 0;
+            continue;
+        }
+        /* xorshift32 */
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        book = state % opts->n_books;
+        if(!strcmp(opts->kind, "LIST"))
+            snprintf(request, sizeof(request), "LIST %u\n", book);
+        else
+            snprintf(request, sizeof(request), "%s %u %u\n", opts->kind, book, (state>>8) % opts->n_tunes[book]);
+        t0 = now_ms();
+        send(fd, request, strlen(request), MSG_NOSIGNAL);
+        n = read_response(fd, scratch, sizeof(scratch), status, sizeof(status), NULL, 0);
+        cl->latencies[r] = now_ms() - t0;
+        if(n < 0 || strcmp(status, "OK")) {
+            cl->errors++;
+            if(n < 0) {
+                close(fd);
+                fd = -1;
+            }
+            continue;
+        }
+        cl->bytes += n;
+    }
+    if(fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+static int get_books(load_options *opts)
+{
+    /* Ask the server how many tunes each book has */
+    int fd = connect_server(opts->socket_path);
+    uint8_t scratch[SERVER_CHUNK];
+    char status[64], *text, *line;
+    uint32_t text_size = MAX_BOOKS*(MAX_REQUEST+32);
+    if(fd < 0)
+        return 0;
+    text = malloc(text_size);
+    text[0] = '\0';
+    send(fd, "BOOKS\n", 6, MSG_NOSIGNAL);
+    read_response(fd, scratch, sizeof(scratch), status, sizeof(status), text, text_size);
+    close(fd);
+    opts->n_books = 0;
+    for(line=strtok(text, "\n"); line && opts->n_books<MAX_BOOKS; line=strtok(NULL, "\n")) {
+        if(sscanf(line, "%*u %u", &opts->n_tunes[opts->n_books])==1 && opts->n_tunes[opts->n_books]>0)
+            opts->n_books++;
+    }
+    free(text);
+    if(opts->n_books==0)
+        printf("Error: the server has no tunes\n");
+    return opts->n_books>0;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return x<y ? -1 : x>y;
+}
+
+int main(int argc, char **argv)
+{
+    load_options opts = {DEFAULT_SOCKET, 8, 100, "PCM", 1, 0, {0}};
+    client *clients;
+    pthread_t *threads;
+    double *all, t0, seconds;
+    uint64_t bytes = 0, n_all;
+    uint32_t errors = 0, c;
+    int i;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--socket") && i+1<argc)
+            opts.socket_path = argv[++i];
+        else if(!strcmp(argv[i], "--clients") && i+1<argc)
+            opts.n_clients = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--requests") && i+1<argc)
+            opts.n_requests = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--seed") && i+1<argc)
+            opts.seed = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--kind") && i+1<argc) {
+            i++;
+            opts.kind = !strcmp(argv[i], "events") ? "EVENTS" : (!strcmp(argv[i], "list") ? "LIST" : "PCM");
+        }
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if(opts.n_clients==0 || opts.n_requests==0) {
+        usage();
+        return 1;
+    }
+    if(!get_books(&opts))
+        return 1;
+
+    clients = calloc(opts.n_clients, sizeof(client));
+    threads = malloc(sizeof(pthread_t)*opts.n_clients);
+    n_all = (uint64_t)opts.n_clients*opts.n_requests;
+    all = malloc(sizeof(double)*n_all);
+    t0 = now_ms();
+    for(c=0; c<opts.n_clients; c++) {
+        clients[c].opts = &opts;
+        clients[c].id = c;
+        clients[c].latencies = all + (uint64_t)c*opts.n_requests;
+        pthread_create(&threads[c], NULL, client_thread, &clients[c]);
+    }
+    for(c=0; c<opts.n_clients; c++) {
+        pthread_join(threads[c], NULL);
+        bytes += clients[c].bytes;
+        errors += clients[c].errors;
+    }
+    seconds = (now_ms() - t0)/1000;
+    qsort(all, n_all, sizeof(double), compare_doubles);
+
+    printf("requests %llu\n", (unsigned long long)n_all);
+    printf("errors %u\n", errors);
+    printf("bytes %llu\n", (unsigned long long)bytes);
+    printf("seconds %.3f\n", seconds);
+    printf("requests_per_s %.1f\n", n_all/seconds);
+    printf("mbyte_per_s %.2f\n", bytes/seconds/1e6);
+    printf("latency_p50_ms %.3f\n", all[n_all*50/100]);
+    printf("latency_p90_ms %.3f\n", all[n_all*90/100]);
+    printf("latency_p99_ms %.3f\n", all[n_all*99/100]);
+    printf("latency_max_ms %.3f\n", all[n_all-1]);
+
+    free(all);
+    free(threads);
+    free(clients);
+    return errors!=0;
+}
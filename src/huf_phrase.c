@@ -0,0 +1,182 @@
+/* Build a melodic phrase index for a .huf file, or search one.
+
+    huf_phrase [--n <intervals>] [--durations] in.huf out.huf
+    huf_phrase --find <intervals> [--steps <steps>] in.huf
+    huf_phrase --pitches <notes> [--steps <steps>] in.huf
+
+Building copies in.huf to out.huf with a fresh phrase index section
+(n-grams of --n intervals, default 4; with --durations, keyed on duration
+steps as well). Searching prints the tune and bar of each match, one per
+line. The phrase is given either as intervals in semitones ("2 2 1 -3")
+or as MIDI note numbers ("62 64 66 67"); --steps optionally adds the
+duration change between notes, as round(log2(new/old)) ("0 0 1").
+Files without the section are searched by decoding every tune.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "phrase_index.h"
+#include "binary.h"
+
+#define MAX_MATCHES 1000
+
+void usage()
+{
+    printf("Usage: huf_phrase [--n <intervals>] [--durations] <in.huf> <out.huf>\n");
+    printf("       huf_phrase --find <intervals> [--steps <steps>] <in.huf>\n");
+    printf("       huf_phrase --pitches <notes> [--steps <steps>] <in.huf>\n");
+}
+
+static uint32_t parse_numbers(char *text, int *values, uint32_t max_values)
+{
+    /* Read whitespace or comma separated integers */
+    char *end;
+    uint32_t n = 0;
+    while(n < max_values) {
+        while(*text==' ' || *text==',')
+            text++;
+        if(*text=='\0')
+            break;
+        values[n] = strtol(text, &end, 10);
+        if(end==text) {
+            printf("Error: bad number in %s\n", text);
+            return 0;
+        }
+        text = end;
+        n++;
+    }
+    return n;
+}
+
+int write_phrase_index(huffman_buffer *h_buffer, uint8_t *buf, uint8_t *file_end, char *out_name, uint8_t n, uint8_t flags)
+{
+    /* Write the file with a fresh phrase index section to out_name */
+    FILE *f;
+    uint8_t *p = data_end(h_buffer), *tag;
+    uint32_t length, *tune_index;
+    phrase_index *index;
+
+    tune_index = load_tune_index(h_buffer, file_end);
+    index = build_phrase_index(h_buffer, tune_index, n, flags);
+    free(tune_index);
+    if(index==NULL)
+        return 1;
+    f = fopen(out_name, "wb");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        free_phrase_index(index);
+        return 1;
+    }
+    write_bytes(f, buf, p-buf);
+    while(p+8 <= file_end) {
+        tag = p;
+        p += 4;
+        length = readbuf_u32(&p);
+        if(memcmp(tag, PHRASE_INDEX_TAG, 4))
+            write_section(f, (char*)tag, p, length);
+        p += length;
+    }
+    write_section(f, PHRASE_INDEX_TAG, index->data, index->length);
+    printf("%u keys, %u bytes\n", index->n_keys, index->length);
+    free_phrase_index(index);
+    fclose(f);
+    return 0;
+}
+
+int search(huffman_buffer *h_buffer, uint8_t *file_end, int *phrase, uint32_t n_phrase, int pitches, int *steps, uint32_t n_steps)
+{
+    /* Print the tune and bar of every match of the phrase */
+    int8_t intervals[MAX_PHRASE], durations[MAX_PHRASE];
+    uint32_t i, n_intervals = pitches ? n_phrase-1 : n_phrase, n_matches, *tune_index;
+    phrase_match *matches;
+    phrase_index *index;
+    clock_t t0;
+
+    if(n_steps && n_steps!=n_intervals) {
+        printf("Error: need one duration step per interval\n");
+        return 1;
+    }
+    for(i=0; i<n_intervals; i++) {
+        intervals[i] = pitches ? phrase[i+1]-phrase[i] : phrase[i];
+        durations[i] = n_steps ? steps[i] : 0;
+    }
+    tune_index = load_tune_index(h_buffer, file_end);
+    index = load_phrase_index(h_buffer, file_end);
+    matches = malloc(sizeof(phrase_match)*MAX_MATCHES);
+    t0 = clock();
+    n_matches = find_phrase(index, h_buffer, tune_index, intervals, n_steps ? durations : NULL,
+                            n_intervals, matches, MAX_MATCHES);
+    for(i=0; i<n_matches; i++)
+        printf("%u\t%u\n", matches[i].tune, matches[i].bar);
+    printf("# %u matches in %.2f ms%s\n", n_matches, 1000.0*(clock()-t0)/CLOCKS_PER_SEC,
+           index ? "" : " (no index)");
+    if(index)
+        free_phrase_index(index);
+    free(matches);
+    free(tune_index);
+    return n_matches==0;
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *out_name = NULL, *phrase_text = NULL, *steps_text = NULL;
+    int phrase[MAX_PHRASE], steps[MAX_PHRASE], pitches = 0, i, result;
+    uint8_t n = DEFAULT_GRAM, flags = 0;
+    uint32_t size, n_phrase = 0, n_steps = 0;
+    uint8_t *buf;
+    huffman_buffer *h_buffer;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--durations"))
+            flags |= PHRASE_DURATIONS;
+        else if(!strcmp(argv[i], "--n") && i+1<argc)
+            n = atoi(argv[++i]);
+        else if((!strcmp(argv[i], "--find") || !strcmp(argv[i], "--pitches")) && i+1<argc) {
+            pitches = !strcmp(argv[i], "--pitches");
+            phrase_text = argv[++i];
+        }
+        else if(!strcmp(argv[i], "--steps") && i+1<argc)
+            steps_text = argv[++i];
+        else if(in_name==NULL)
+            in_name = argv[i];
+        else if(out_name==NULL)
+            out_name = argv[i];
+    }
+    if(in_name==NULL || (phrase_text==NULL && out_name==NULL)) {
+        usage();
+        return 1;
+    }
+    if(phrase_text) {
+        n_phrase = parse_numbers(phrase_text, phrase, MAX_PHRASE);
+        if(n_phrase < (uint32_t)(1+pitches)) {
+            usage();
+            return 1;
+        }
+        if(steps_text)
+            n_steps = parse_numbers(steps_text, steps, MAX_PHRASE);
+    }
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+
+    if(phrase_text)
+        result = search(h_buffer, buf+size, phrase, n_phrase, pitches, steps, n_steps);
+    else
+        result = write_phrase_index(h_buffer, buf, buf+size, out_name, n, flags);
+
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return result;
+}
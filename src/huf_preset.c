@@ -0,0 +1,423 @@
+/* Train a preset table from a corpus of books, or convert a book to name
+a preset instead of carrying its own table (see huffman_preset.h).
+
+    huf_preset --train [--id <id>] [--name <name>] [--min-count <n>] out.h in.huf...
+    huf_preset [--preset <id>] in.huf out.huf
+    huf_preset --list
+
+--train counts the tokens of every tune of the books and writes a C
+header of static const tables, as huf_to_c does, for huffman_preset.c
+to include. Tokens used fewer than --min-count times (default 2) are
+left out, to be carried as delta tokens by the books that need them;
+the escape entry is weighted by how often the left out tokens were used.
+Add the header to the presets in huffman_preset.c under a new id: a
+preset that has shipped must never be retrained in place.
+
+Converting re-encodes every tune with the preset (by default the
+newest) plus delta tokens for any the preset lacks, and prints "name
+value" lines: preset, tunes, delta_tokens, in_bytes, out_bytes, then
+in_bits and out_bits of compressed data. Sections are not copied, as
+their bit offsets no longer hold; run huf_index on the result to add
+them again.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "huffman_encode.h"
+#include "huffman_preset.h"
+#include "tune_catalogue.h"
+#include "binary.h"
+
+#define VALUES_PER_LINE 12
+
+/* Distinct tokens and how often they were used, in order of first use */
+typedef struct token_counts
+{
+    char **tokens;
+    uint64_t *counts;
+    uint32_t n_tokens;
+    uint32_t max_tokens;
+} token_counts;
+
+void usage()
+{
+    printf("Usage: huf_preset --train [--id <id>] [--name <name>] [--min-count <n>] <out.h> <in.huf>...\n");
+    printf("       huf_preset [--preset <id>] <in.huf> <out.huf>\n");
+    printf("       huf_preset --list\n");
+}
+
+static uint32_t add_token(token_counts *set, char *token)
+{
+    /* The index of token in the set, adding it if it is new */
+    uint32_t i;
+    for(i=0; i<set->n_tokens; i++)
+        if(!strcmp(set->tokens[i], token))
+            return i;
+    if(set->n_tokens==set->max_tokens) {
+        set->max_tokens = set->max_tokens ? 2*set->max_tokens : 256;
+        set->tokens = realloc(set->tokens, sizeof(char*)*set->max_tokens);
+        set->counts = realloc(set->counts, sizeof(uint64_t)*set->max_tokens);
+    }
+    set->tokens[i] = token;
+    set->counts[i] = 0;
+    set->n_tokens++;
+    return i;
+}
+
+static uint32_t count_symbols(huffman_buffer *buffer, uint64_t *counts)
+{
+    /* Count the uses of every symbol of the book, including the tune
+    terminators and the two that end the data. Returns the number of
+    tunes. */
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, buffer->table);
+    uint32_t symbol, n_tunes = 0;
+    reset_buffer(buffer);
+    while((symbol = read_symbol(buffer))!=nl) {
+        while(symbol!=nl) {
+            counts[symbol]++;
+            symbol = read_symbol(buffer);
+        }
+        counts[nl]++;
+        n_tunes++;
+    }
+    counts[nl] += 2;
+    return n_tunes;
+}
+
+static void write_c_string(FILE *f, char *str, uint32_t len)
+{
+    /* Write str as a C string literal */
+    uint32_t i;
+    unsigned char c;
+    fputc('"', f);
+    for(i=0; i<len; i++) {
+        c = str[i];
+        if(c=='"' || c=='\\')
+            fprintf(f, "\\%c", c);
+        else if(c=='\n')
+            fprintf(f, "\\n");
+        else if(isprint(c) && c!='?') /* ? could start a trigraph */
+            fputc(c, f);
+        else
+            fprintf(f, "\\%03o", c);
+    }
+    fputc('"', f);
+}
+
+static void write_u32_array(FILE *f, const char *decl, uint32_t *values, uint32_t n)
+{
+    /* Write a static const uint32_t array */
+    uint32_t i;
+    fprintf(f, "%s[%d] = {", decl, n);
+    for(i=0; i<n; i++)
+        fprintf(f, "%s0x%x,", i%VALUES_PER_LINE ? " " : "\n    ", values[i]);
+    fprintf(f, "\n};\n\n");
+}
+
+static void write_preset_header(FILE *f, char *name, uint32_t id, huffman_table *table, uint32_t escape,
+    char **in_names, uint32_t n_books)
+{
+    /* Write the table, its lookup table and ops as static const arrays */
+    huffman_op *op;
+    uint32_t *values;
+    uint32_t i, n = table->n_entries;
+    char decl[128];
+    char guard[64];
+
+    for(i=0; name[i] && i<sizeof(guard)-1; i++)
+        guard[i] = toupper((unsigned char)name[i]);
+    guard[i] = '\0';
+    fprintf(f, "/* Generated by huf_preset --train from");
+    for(i=0; i<n_books; i++)
+        fprintf(f, " %s", in_names[i]);
+    fprintf(f, ". Do not edit.\n   Preset %u: %d entries, %s_ESCAPE is the escape entry.\n*/\n", id, n, guard);
+    fprintf(f, "#ifndef PRESET_%s_H\n#define PRESET_%s_H\n\n", guard, guard);
+    fprintf(f, "#include <stdint.h>\n#include \"huffman.h\"\n\n");
+    fprintf(f, "#define %s_ESCAPE %d\n\n", guard, escape);
+
+    values = malloc(sizeof(uint32_t)*(n+1));
+    for(i=0; i<n; i++)
+        values[i] = table->n_bits[i];
+    sprintf(decl, "static const uint8_t %s_n_bits", name);
+    write_u32_array(f, decl, values, n);
+    sprintf(decl, "static const uint32_t %s_codes", name);
+    write_u32_array(f, decl, table->codes, n);
+    for(i=0; i<=n; i++)
+        values[i] = table->token_offsets[i];
+    sprintf(decl, "static const huf_offset_t %s_token_offsets", name);
+    write_u32_array(f, decl, values, n+1);
+    free(values);
+    fprintf(f, "static const char %s_strings[%d] =", name, table->token_offsets[n]);
+    for(i=0; i<n; i++) {
+        fprintf(f, "\n    ");
+        write_c_string(f, TOKEN_STRING(table, i), TOKEN_LENGTH(table, i)+1);
+    }
+    fprintf(f, ";\n\n");
+
+    fprintf(f, "static const huffman_op %s_ops[%d] = {\n", name, n);
+    for(i=0; i<n; i++) {
+        op = &table->ops[i];
+        fprintf(f, "    {%d, %d, %d},\n", op->op, op->a, op->b);
+    }
+    fprintf(f, "};\n\n");
+
+    sprintf(decl, "static const uint32_t %s_lut_entries", name);
+    write_u32_array(f, decl, table->lut->entries, table->lut->n_entries);
+    fprintf(f, "static const huffman_lut %s_lut = {%d, %d, (uint32_t*)%s_lut_entries};\n\n",
+            name, table->lut->root_bits, table->lut->n_entries, name);
+
+    fprintf(f, "static const huffman_table %s_table = {%d, (uint8_t*)%s_n_bits, (uint32_t*)%s_codes,\n", name, n, name, name);
+    fprintf(f, "    (huf_offset_t*)%s_token_offsets, (char*)%s_strings, (huffman_lut*)&%s_lut, (huffman_op*)%s_ops, 1};\n\n",
+            name, name, name, name);
+    fprintf(f, "#endif\n");
+}
+
+int train_preset(char *out_name, char *name, uint32_t id, uint64_t min_count, char **in_names, uint32_t n_books)
+{
+    /* Build a preset from the tokens of n_books books, and write it as a C header */
+    uint8_t **bufs = calloc(n_books, sizeof(uint8_t*));
+    huffman_buffer **buffers = calloc(n_books, sizeof(huffman_buffer*));
+    token_counts all = {NULL, NULL, 0, 0}, kept = {NULL, NULL, 0, 0};
+    huffman_table *table = NULL;
+    uint64_t *counts, escape_count = 0;
+    uint32_t i, k, ix, size, n_tunes = 0, escape;
+    FILE *f;
+    int result = 1;
+
+    for(i=0; i<n_books; i++) {
+        bufs[i] = load_file(in_names[i], &size);
+        if(bufs[i]==NULL)
+            goto done;
+        buffers[i] = load_huffman(bufs[i], size);
+        if(buffers[i]==NULL) {
+            printf("Error: %s is not a valid file\n", in_names[i]);
+            goto done;
+        }
+        counts = calloc(buffers[i]->table->n_entries, sizeof(uint64_t));
+        n_tunes += count_symbols(buffers[i], counts);
+        for(k=0; k<buffers[i]->table->n_entries; k++) {
+            if(counts[k]) {
+                ix = add_token(&all, TOKEN_STRING(buffers[i]->table, k)); /* may grow counts */
+                all.counts[ix] += counts[k];
+            }
+        }
+        free(counts);
+    }
+    for(i=0; i<all.n_tokens; i++) {
+        if(all.counts[i] >= min_count) {
+            ix = add_token(&kept, all.tokens[i]);
+            kept.counts[ix] = all.counts[i];
+        }
+        else
+            escape_count += all.counts[i];
+    }
+    escape = add_token(&kept, PRESET_ESCAPE);
+    kept.counts[escape] = escape_count;
+
+    table = build_huffman_codes(kept.tokens, kept.counts, kept.n_tokens);
+    if(table==NULL)
+        goto done;
+    table->lut = build_lut(table);
+    if(table->lut==NULL)
+        goto done;
+    table->ops = build_ops(table);
+    f = fopen(out_name, "w");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        goto done;
+    }
+    write_preset_header(f, name, id, table, escape, in_names, n_books);
+    fclose(f);
+    printf("books %u\n", n_books);
+    printf("tunes %u\n", n_tunes);
+    printf("tokens %u\n", all.n_tokens);
+    printf("preset_entries %u\n", table->n_entries);
+    printf("escape_bits %u\n", table->n_bits[escape]);
+    result = 0;
+
+done:
+    for(i=0; i<n_books; i++) {
+        if(buffers[i]) {
+            free_huffman_table(buffers[i]->table);
+            free(buffers[i]);
+        }
+        free(bufs[i]);
+    }
+    if(table)
+        free_huffman_table(table);
+    free(all.tokens);
+    free(all.counts);
+    free(kept.tokens);
+    free(kept.counts);
+    free(buffers);
+    free(bufs);
+    return result;
+}
+
+int convert_book(char *in_name, char *out_name, const huffman_preset *preset)
+{
+    /* Write the book in_name re-encoded with the preset, as an 'HUFP' file */
+    huffman_buffer *buffer;
+    huffman_table *table = NULL, *book;
+    uint8_t *buf, *delta = NULL;
+    uint64_t *counts, n_bits = 0;
+    uint32_t size, i, n_tunes, n_delta = 0, delta_size = 0, nl, symbol, *map = NULL;
+    bit_writer bw;
+    FILE *f;
+    int result = 1;
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    buffer = load_huffman(buf, size);
+    if(buffer==NULL) {
+        free(buf);
+        return 1;
+    }
+    book = buffer->table;
+    counts = calloc(book->n_entries, sizeof(uint64_t));
+    n_tunes = count_symbols(buffer, counts);
+
+    /* Tokens the preset lacks become delta tokens, in symbol order */
+    for(i=0; i<book->n_entries; i++) {
+        if(counts[i] && lookup_symbol_index(TOKEN_STRING(book, i), (huffman_table*)preset->table)==INVALID_CODE) {
+            delta = realloc(delta, delta_size + 1 + TOKEN_LENGTH(book, i));
+            delta[delta_size] = TOKEN_LENGTH(book, i);
+            memcpy(delta+delta_size+1, TOKEN_STRING(book, i), TOKEN_LENGTH(book, i));
+            delta_size += 1 + TOKEN_LENGTH(book, i);
+            n_delta++;
+        }
+    }
+    if(n_delta==0)
+        table = (huffman_table*)preset->table;
+    else {
+        table = preset_delta_table(preset, delta, n_delta);
+        if(table==NULL)
+            goto done;
+    }
+    map = malloc(sizeof(uint32_t)*book->n_entries);
+    for(i=0; i<book->n_entries; i++) {
+        map[i] = counts[i] ? lookup_symbol_index(TOKEN_STRING(book, i), table) : INVALID_CODE;
+        if(map[i]!=INVALID_CODE)
+            n_bits += counts[i]*table->n_bits[map[i]];
+    }
+    if(n_bits > 0xFFFFFFFF) {
+        printf("Error: data too long\n");
+        goto done;
+    }
+
+    f = fopen(out_name, "wb");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        goto done;
+    }
+    write_bytes(f, PRESET_MAGIC, 4);
+    write_u32(f, preset->id);
+    write_u32(f, n_delta);
+    if(n_delta)
+        write_bytes(f, delta, delta_size);
+    write_u32(f, (uint32_t)n_bits);
+    init_bit_writer(&bw, f);
+    nl = lookup_symbol_index(TUNE_TERMINATOR, book);
+    reset_buffer(buffer);
+    while((symbol = read_symbol(buffer))!=nl) {
+        while(symbol!=nl) {
+            write_symbol(&bw, table, map[symbol]);
+            symbol = read_symbol(buffer);
+        }
+        write_symbol(&bw, table, map[nl]);
+    }
+    write_symbol(&bw, table, map[nl]);
+    write_symbol(&bw, table, map[nl]);
+    flush_bits(&bw);
+
+    printf("preset %u\n", preset->id);
+    printf("tunes %u\n", n_tunes);
+    printf("delta_tokens %u\n", n_delta);
+    printf("in_bytes %u\n", size);
+    printf("out_bytes %ld\n", ftell(f));
+    printf("in_bits %u\n", buffer->n_bits);
+    printf("out_bits %u\n", (uint32_t)bw.n_bits);
+    fclose(f);
+    result = 0;
+
+done:
+    if(table)
+        free_huffman_table(table);
+    free(map);
+    free(delta);
+    free(counts);
+    free_huffman_table(book);
+    free(buffer);
+    free(buf);
+    return result;
+}
+
+int list_presets()
+{
+    /* Print the id, name, entry count and escape length of every preset */
+    const huffman_preset *preset;
+    uint32_t i;
+    for(i=0; (preset = preset_at(i))!=NULL; i++)
+        printf("%u\t%s\t%u\t%u\n", preset->id, preset->name, preset->table->n_entries,
+               preset->table->n_bits[preset->escape]);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    char *names[2] = {NULL, NULL}, name[64] = "preset";
+    const huffman_preset *preset = NULL;
+    uint32_t id = 0, i, n_names = 0;
+    uint64_t min_count = 2;
+    int a, train = 0;
+
+    for(a=1; a<argc; a++) {
+        if(!strcmp(argv[a], "--list"))
+            return list_presets();
+        else if(!strcmp(argv[a], "--train"))
+            train = 1;
+        else if((!strcmp(argv[a], "--id") || !strcmp(argv[a], "--preset")) && a+1<argc)
+            id = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--name") && a+1<argc) {
+            strncpy(name, argv[++a], sizeof(name)-1);
+            for(i=0; name[i]; i++)
+                if(!isalnum((unsigned char)name[i]))
+                    name[i] = '_';
+        }
+        else if(!strcmp(argv[a], "--min-count") && a+1<argc)
+            min_count = strtoull(argv[++a], NULL, 10);
+        else
+            break;
+    }
+    if(train) {
+        if(argc-a < 2 || id==0) {
+            usage();
+            return 1;
+        }
+        return train_preset(argv[a], name, id, min_count, argv+a+1, argc-a-1);
+    }
+    for(; a<argc && n_names<2; a++)
+        names[n_names++] = argv[a];
+    if(n_names<2) {
+        usage();
+        return 1;
+    }
+    if(id==0) {
+        /* The newest */
+        for(i=0; preset_at(i)!=NULL; i++)
+            preset = preset_at(i);
+    }
+    else
+        preset = find_preset(id);
+    if(preset==NULL) {
+        printf("Error: unknown preset %u\n", id);
+        return 1;
+    }
+    return convert_book(names[0], names[1], preset);
+}
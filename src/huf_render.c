@@ -0,0 +1,189 @@
+/* Render tunes to raw samples through the decode/synth/output pipeline
+(see render_pipeline.h), or serially on one thread for comparison.
+
+    huf_render [--first <n>] [--count <n>] [--rate <hz>] [--bits 8|16]
+               [--block <samples>] [--event-ring <n>] [--block-ring <n>]
+               [--spin <n>] [--sleep <us>] [--serial] [--wav] in.huf out.raw
+
+Renders --count tunes (default: all) from tune --first (default 0) back
+to back into out.raw, as unsigned 8 bit or native-endian 16 bit mono
+samples at --rate (default 44100). The ring and wait options set the
+pipeline_config; --serial decodes, synthesises and writes in turn on
+one thread instead. --wav writes a WAV header first, sized from the
+tunes' summaries (see tune_summary.h), so out can be "-" for stdout,
+or any other pipe. Prints "name value" lines (to stderr if writing to
+stdout): tunes, events, samples, bytes, seconds (wall clock),
+msamples_per_s, and for the pipeline the number of times each stage
+stalled on its ring.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "render_pipeline.h"
+#include "tune_summary.h"
+#include "wav_writer.h"
+#include "binary.h"
+
+void usage()
+{
+    printf("Usage: huf_render [--first <n>] [--count <n>] [--rate <hz>] [--bits 8|16]\n");
+    printf("                  [--block <samples>] [--event-ring <n>] [--block-ring <n>]\n");
+    printf("                  [--spin <n>] [--sleep <us>] [--serial] [--wav] <in.huf> <out.raw>\n");
+}
+
+static int write_samples(void *output_context, const uint8_t *samples, uint32_t n_bytes)
+{
+    FILE *f = (FILE*)output_context;
+    if(fwrite(samples, 1, n_bytes, f)!=n_bytes) {
+        printf("Error: write failed\n");
+        return 0;
+    }
+    return 1;
+}
+
+static double now_s()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec/1e9;
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *out_name = NULL;
+    uint32_t size, first = 0, count = 0, *tune_index, *tunes, i;
+    uint64_t n_samples = 0;
+    uint8_t *buf, *summaries;
+    int serial = 0, wav = 0, ok, a;
+    huffman_buffer *h_buffer;
+    pipeline_config config;
+    pipeline_stats stats;
+    tune_summary summary;
+    wav_context header;
+    FILE *out, *report = stdout;
+    double t0, seconds;
+
+    default_pipeline_config(&config);
+    for(a=1; a<argc; a++) {
+        if(!strcmp(argv[a], "--first") && a+1<argc)
+            first = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--count") && a+1<argc)
+            count = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--rate") && a+1<argc)
+            config.sample_rate = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--bits") && a+1<argc)
+            config.bits = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--block") && a+1<argc)
+            config.block_samples = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--event-ring") && a+1<argc)
+            config.event_ring = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--block-ring") && a+1<argc)
+            config.block_ring = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--spin") && a+1<argc)
+            config.spin = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--sleep") && a+1<argc)
+            config.sleep_us = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--serial"))
+            serial = 1;
+        else if(!strcmp(argv[a], "--wav"))
+            wav = 1;
+        else if(in_name==NULL)
+            in_name = argv[a];
+        else if(out_name==NULL)
+            out_name = argv[a];
+        else {
+            usage();
+            return 1;
+        }
+    }
+    if(out_name==NULL) {
+        usage();
+        return 1;
+    }
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    tune_index = load_tune_index(h_buffer, buf+size);
+    if(first>=tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return 1;
+    }
+    if(count==0 || count>tune_index[0]-first)
+        count = tune_index[0]-first;
+    tunes = malloc(sizeof(uint32_t)*count);
+    for(i=0; i<count; i++)
+        tunes[i] = first+i;
+
+    if(!strcmp(out_name, "-")) {
+        out = stdout;
+        report = stderr;
+    }
+    else
+        out = fopen(out_name, "wb");
+    if(!out) {
+        printf("Error: could not open %s\n", out_name);
+        return 1;
+    }
+    t0 = now_s();
+    if(wav) {
+        /* The pipeline renders notes and rests only, so the summaries
+        give the exact sample count before anything is decoded */
+        summaries = load_summary_section(h_buffer, buf+size, tune_index[0]);
+        for(i=0; i<count; i++) {
+            get_tune_summary(h_buffer, summaries, tune_index, tunes[i], config.sample_rate, &summary);
+            n_samples += summary.n_samples;
+        }
+        if(n_samples > UINT32_MAX/(config.bits/8)) {
+            printf("Error: too many samples for a WAV file\n");
+            return 1;
+        }
+        header.f = out;
+        header.sample_rate = config.sample_rate;
+        header.n_channels = 1;
+        header.bits_per_sample = config.bits;
+        header.n_samples = (uint32_t)n_samples;
+        write_header(&header);
+    }
+    if(serial)
+        ok = render_serial(h_buffer, tune_index, tunes, count, &config, write_samples, out, &stats);
+    else
+        ok = render_pipeline(h_buffer, tune_index, tunes, count, &config, write_samples, out, &stats);
+    if(fclose(out)!=0)
+        ok = 0;
+    seconds = now_s() - t0;
+
+    if(wav && stats.samples!=n_samples) {
+        printf("Error: rendered %llu samples, but the header says %llu\n", (unsigned long long)stats.samples, (unsigned long long)n_samples);
+        ok = 0;
+    }
+
+    fprintf(report, "tunes %u\n", count);
+    fprintf(report, "events %llu\n", (unsigned long long)stats.events);
+    fprintf(report, "samples %llu\n", (unsigned long long)stats.samples);
+    fprintf(report, "bytes %llu\n", (unsigned long long)stats.samples*(config.bits/8));
+    fprintf(report, "seconds %.3f\n", seconds);
+    fprintf(report, "msamples_per_s %.2f\n", seconds>0 ? stats.samples/seconds/1e6 : 0.0);
+    if(!serial) {
+        fprintf(report, "decode_waits %llu\n", (unsigned long long)stats.decode_waits);
+        fprintf(report, "synth_waits %llu\n", (unsigned long long)stats.synth_waits);
+        fprintf(report, "output_waits %llu\n", (unsigned long long)stats.output_waits);
+    }
+
+    free(tunes);
+    free(tune_index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return !ok;
+}
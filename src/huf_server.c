@@ -0,0 +1,507 @@
+/* Serve tunes from one or more books to local clients over a Unix socket
+(Linux only: the event loop uses epoll).
+
+    huf_server [--socket <path>] book.huf [book.huf ...]
+
+Each book is loaded and indexed once, and its table is shared by every
+connection. A connection has its own decoding cursor (a copy of
+the book's huffman_buffer, a tune context and an oscillator), and tunes
+are decoded and synthesised only as fast as the client reads them: one
+chunk is produced whenever the connection's output has room. Books
+with a checksum section are refused if their header is corrupt. Only
+the header and table are checked at load; a tune is checked the first
+time it is asked for, and one crossing a corrupt chunk, or that does
+not decode, gets "ERR corrupt tune" while the rest still play. See
+tune_server.h for the protocol. Ctrl-C stops the server and prints
+request and byte counts.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "huffman_crc.h"
+#include "synth.h"
+#include "tune_server.h"
+#include "binary.h"
+
+#define MAX_EVENTS 64
+#define OUT_BUFFER (2*(SERVER_CHUNK+4))
+
+typedef struct book
+{
+    char *name;
+    uint8_t *buf;
+    huffman_buffer *buffer; /* shared, read only */
+    uint32_t *tune_index;
+    uint8_t *meta_section; /* NULL if the file has no metadata section */
+    crc_check *crc; /* NULL if the file has no checksum section */
+    uint8_t *tune_status; /* TUNE_ code per tune */
+} book;
+
+/* Tunes are checked the first time they are asked for */
+#define TUNE_UNCHECKED 0
+#define TUNE_OK 1
+#define TUNE_BAD 2
+
+enum { MODE_IDLE, MODE_BOOKS, MODE_LIST, MODE_EVENTS, MODE_PCM, MODE_END };
+
+typedef struct connection
+{
+    int fd;
+    char request[MAX_REQUEST];
+    uint32_t request_len;
+    int read_closed; /* 1 once the client has shut down its side */
+    uint8_t out[OUT_BUFFER];
+    uint32_t out_len, out_sent;
+    int mode;
+    book *book;
+    uint32_t cursor; /* next book or tune to list */
+    huffman_buffer buffer; /* decoding cursor over the book's data */
+    tune_context *ctx;
+    square_synth synth;
+    int in_tune;
+    uint8_t *chunk; /* payload being filled */
+    uint32_t chunk_len;
+} connection;
+
+typedef struct server
+{
+    book *books;
+    uint32_t n_books;
+    uint64_t n_requests, n_errors, bytes_sent;
+    uint32_t n_connections;
+} server;
+
+static volatile sig_atomic_t running = 1;
+
+void usage()
+{
+    printf("Usage: huf_server [--socket <path>] <book.huf> [<book.huf> ...]\n");
+}
+
+static void stop(int sig)
+{
+    (void)sig;
+    running = 0;
+}
+
+static void event_record(tune_context *ctx, uint32_t event_code)
+{
+    /* Append notes, rests and bars to the chunk being filled */
+    connection *c = (connection*)ctx->callback_context;
+    uint8_t *p = c->chunk + c->chunk_len;
+    if(event_code!=EVENT_NOTE && event_code!=EVENT_REST && event_code!=EVENT_BAR)
+        return;
+    writebuf_u8(&p, event_code);
+    writebuf_u8(&p, event_code==EVENT_BAR ? 0 : ctx->current_note);
+    writebuf_u32(&p, event_code==EVENT_BAR ? ctx->bar_start_time : ctx->note_start_time);
+    writebuf_u32(&p, event_code==EVENT_BAR ? 0 : ctx->current_duration);
+    c->chunk_len += EVENT_RECORD_BYTES;
+}
+
+static void event_synth(tune_context *ctx, uint32_t event_code)
+{
+    /* Pass notes and rests to the connection's oscillator */
+    connection *c = (connection*)ctx->callback_context;
+    if(event_code==EVENT_NOTE)
+        synth_note(&c->synth, ctx->current_note, ctx->current_duration, 0);
+    else if(event_code==EVENT_REST)
+        synth_note(&c->synth, 0, ctx->current_duration, 1);
+}
+
+static uint32_t out_room(connection *c)
+{
+    /* Payload bytes a new chunk could take */
+    uint32_t room = OUT_BUFFER - c->out_len;
+    return room < 4 ? 0 : (room-4 > SERVER_CHUNK ? SERVER_CHUNK : room-4);
+}
+
+static void begin_chunk(connection *c)
+{
+    c->chunk = c->out + c->out_len + 4;
+    c->chunk_len = 0;
+}
+
+static void end_chunk(connection *c)
+{
+    uint8_t *p = c->chunk - 4;
+    writebuf_u32(&p, c->chunk_len);
+    c->out_len += 4 + c->chunk_len;
+}
+
+static void send_text(connection *c, const char *text)
+{
+    /* A whole chunk of text; there must be room for it */
+    begin_chunk(c);
+    c->chunk_len = strlen(text);
+    memcpy(c->chunk, text, c->chunk_len);
+    end_chunk(c);
+}
+
+static int tune_ok(book *b, uint32_t t)
+{
+    /* 1 if tune t's chunks match their checksums and it decodes,
+    checking it the first time */
+    if(b->tune_status[t]==TUNE_UNCHECKED) {
+        if((b->crc && !check_tune(b->crc, b->tune_index, t, b->buffer->n_bits)) ||
+           !check_huffman_tune(b->buffer, b->tune_index, t))
+            b->tune_status[t] = TUNE_BAD;
+        else
+            b->tune_status[t] = TUNE_OK;
+    }
+    return b->tune_status[t]==TUNE_OK;
+}
+
+static void start_request(server *srv, connection *c, char *line)
+{
+    /* Parse a request line, and answer OK or ERR */
+    uint32_t b, t;
+    char kind[16];
+    int n = sscanf(line, "%15s %u %u", kind, &b, &t);
+
+    srv->n_requests++;
+    if(n>=1 && !strcmp(kind, "BOOKS")) {
+        c->mode = MODE_BOOKS;
+        c->cursor = 0;
+    }
+    else if(n>=2 && b<srv->n_books && !strcmp(kind, "LIST")) {
+        c->mode = MODE_LIST;
+        c->book = &srv->books[b];
+        c->buffer = *c->book->buffer;
+        c->cursor = 0;
+    }
+    else if(n==3 && b<srv->n_books && t<srv->books[b].tune_index[0] &&
+            (!strcmp(kind, "EVENTS") || !strcmp(kind, "PCM")) && !tune_ok(&srv->books[b], t)) {
+        srv->n_errors++;
+        send_text(c, "ERR corrupt tune");
+        c->mode = MODE_END;
+        return;
+    }
+    else if(n==3 && b<srv->n_books && t<srv->books[b].tune_index[0] &&
+            (!strcmp(kind, "EVENTS") || !strcmp(kind, "PCM"))) {
+        c->mode = strcmp(kind, "PCM") ? MODE_EVENTS : MODE_PCM;
+        c->book = &srv->books[b];
+        c->buffer = *c->book->buffer;
+        c->buffer.pos = c->book->tune_index[t+1];
+        c->ctx->event_callback = c->mode==MODE_PCM ? event_synth : event_record;
+        c->ctx->callback_context = c;
+        init_synth(&c->synth, SERVER_SAMPLE_RATE, SYNTH_AMPLITUDE);
+        begin_tune(c->ctx);
+        c->in_tune = 1;
+    }
+    else {
+        srv->n_errors++;
+        send_text(c, "ERR bad request");
+        c->mode = MODE_END;
+        return;
+    }
+    send_text(c, "OK");
+}
+
+static void produce(server *srv, connection *c)
+{
+    /* Add the next chunk of the response, if there is room */
+    uint32_t room = out_room(c), n;
+    uint16_t samples[SERVER_CHUNK/2];
+    tune_metadata meta;
+    char line[MAX_TITLE+32];
+    int len;
+
+    if(room < SERVER_CHUNK)
+        return;
+    begin_chunk(c);
+    switch(c->mode) {
+        case MODE_BOOKS:
+            while(c->cursor < srv->n_books) {
+                len = snprintf(line, sizeof(line), "%u\t%u\t%.200s\n", c->cursor,
+                               srv->books[c->cursor].tune_index[0], srv->books[c->cursor].name);
+                if(c->chunk_len + len > room)
+                    break;
+                memcpy(c->chunk + c->chunk_len, line, len);
+                c->chunk_len += len;
+                c->cursor++;
+            }
+            if(c->cursor==srv->n_books)
+                c->mode = MODE_END;
+            break;
+        case MODE_LIST:
+            while(c->cursor < c->book->tune_index[0]) {
+                if(c->book->meta_section)
+                    read_tune_metadata(c->book->meta_section, c->cursor, &meta);
+                else {
+                    c->buffer.pos = c->book->tune_index[c->cursor+1];
+                    c->ctx->event_callback = NULL;
+                    scan_tune_header(&c->buffer, c->ctx);
+                    meta = *c->ctx->meta;
+                }
+                len = snprintf(line, sizeof(line), "%u\t%s\n", c->cursor, meta.title);
+                if(c->chunk_len + len > room)
+                    break;
+                memcpy(c->chunk + c->chunk_len, line, len);
+                c->chunk_len += len;
+                c->cursor++;
+            }
+            if(c->cursor==c->book->tune_index[0])
+                c->mode = MODE_END;
+            break;
+        case MODE_EVENTS:
+            /* A symbol fires at most one recorded event */
+            while(c->in_tune && c->chunk_len + EVENT_RECORD_BYTES <= room)
+                c->in_tune = step_tune(&c->buffer, c->ctx);
+            if(!c->in_tune)
+                c->mode = MODE_END;
+            break;
+        case MODE_PCM:
+            while(c->chunk_len + 2 <= room) {
+                if(c->synth.samples_left==0) {
+                    if(!c->in_tune) {
+                        c->mode = MODE_END;
+                        break;
+                    }
+                    c->in_tune = step_tune(&c->buffer, c->ctx);
+                    continue;
+                }
+                /* samples is aligned for the oscillator; the chunk may not be */
+                n = synth_render(&c->synth, (uint8_t*)samples, (room - c->chunk_len)/2, 16);
+                memcpy(c->chunk + c->chunk_len, samples, 2*n);
+                c->chunk_len += 2*n;
+            }
+            break;
+        case MODE_END:
+            c->mode = MODE_IDLE;
+            break;
+    }
+    /* An empty chunk ends the response, so only send one at the end */
+    if(c->chunk_len > 0 || c->mode==MODE_IDLE)
+        end_chunk(c);
+}
+
+static int next_request(server *srv, connection *c)
+{
+    /* Start the next complete request line, if there is one */
+    char *nl = memchr(c->request, '\n', c->request_len);
+    uint32_t line_len;
+    if(nl==NULL)
+        return 0;
+    *nl = '\0';
+    line_len = nl - c->request + 1;
+    start_request(srv, c, c->request);
+    memmove(c->request, c->request+line_len, c->request_len-line_len);
+    c->request_len -= line_len;
+    return 1;
+}
+
+static int service(server *srv, connection *c)
+{
+    /* Send what is waiting, then produce and send more, for as long as
+    the socket will take it. Returns 1 if output is still waiting to be
+    sent, 0 if not, or -1 if the connection has gone. */
+    ssize_t n;
+    while(1) {
+        if(c->out_sent < c->out_len) {
+            n = send(c->fd, c->out + c->out_sent, c->out_len - c->out_sent, MSG_NOSIGNAL);
+            if(n < 0)
+                return (errno==EAGAIN || errno==EWOULDBLOCK) ? 1 : -1;
+            c->out_sent += n;
+            srv->bytes_sent += n;
+            if(c->out_sent < c->out_len)
+                return 1;
+        }
+        /* The output is empty, so there is room for a status and a chunk */
+        c->out_len = 0;
+        c->out_sent = 0;
+        if(c->mode==MODE_IDLE && !next_request(srv, c))
+            return 0;
+        produce(srv, c);
+    }
+}
+
+static int receive(connection *c)
+{
+    /* Read what the client has sent; returns 0 if it has sent a request
+    that is too long or the connection failed. When the client shuts
+    down its side, read_closed is set, and the requests already sent
+    are still answered. */
+    ssize_t n;
+    while(1) {
+        if(c->request_len==MAX_REQUEST)
+            return memchr(c->request, '\n', c->request_len)!=NULL;
+        n = recv(c->fd, c->request + c->request_len, MAX_REQUEST - c->request_len, 0);
+        if(n==0) {
+            c->read_closed = 1;
+            return 1;
+        }
+        if(n < 0)
+            return errno==EAGAIN || errno==EWOULDBLOCK;
+        c->request_len += n;
+    }
+}
+
+static void close_connection(server *srv, connection *c)
+{
+    close(c->fd);
+    free_context(c->ctx);
+    free(c);
+    srv->n_connections--;
+}
+
+static void free_book(book *b)
+{
+    if(b->crc)
+        free_crc_check(b->crc);
+    free(b->tune_index);
+    free(b->tune_status);
+    free_huffman_table(b->buffer->table);
+    free(b->buffer);
+    free(b->buf);
+}
+
+static int load_book(book *b, char *fname)
+{
+    /* Load and index a book; returns 1 on success. Only the header and
+    table are checked here (the header first, against its checksum if
+    there is one); each tune is checked when first asked for. */
+    uint32_t size;
+    b->name = fname;
+    b->buf = load_file(fname, &size);
+    if(b->buf==NULL)
+        return 0;
+    b->buffer = open_huffman(b->buf, size);
+    if(b->buffer==NULL) {
+        free(b->buf);
+        return 0;
+    }
+    b->crc = load_crc_check(b->buf, b->buffer, b->buf+size);
+    b->tune_index = NULL;
+    b->tune_status = NULL;
+    if(b->crc && !b->crc->header_ok) {
+        printf("Error: %s has a corrupt header\n", fname);
+        free_book(b);
+        return 0;
+    }
+    if(!check_huffman_table(b->buffer)) {
+        free_book(b);
+        return 0;
+    }
+    b->tune_index = load_tune_index(b->buffer, b->buf+size);
+    b->tune_status = calloc(b->tune_index[0]+1, 1);
+    b->meta_section = load_metadata_section(b->buffer, b->buf+size, b->tune_index[0]);
+    return 1;
+}
+
+static int open_socket(char *path)
+{
+    /* Listen on a non-blocking Unix socket at path */
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Error: could not create socket %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 128) < 0) {
+        printf("Error: could not listen on %s\n", path);
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    char *socket_path = DEFAULT_SOCKET;
+    server srv;
+    int listen_fd, epoll_fd, n, i, fd, pending;
+    struct epoll_event ev, events[MAX_EVENTS];
+    connection *c;
+    uint32_t b;
+
+    memset(&srv, 0, sizeof(srv));
+    srv.books = malloc(sizeof(book)*argc);
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--socket") && i+1<argc)
+            socket_path = argv[++i];
+        else if(!load_book(&srv.books[srv.n_books++], argv[i]))
+            return 1;
+    }
+    if(srv.n_books==0) {
+        usage();
+        return 1;
+    }
+    listen_fd = open_socket(socket_path);
+    if(listen_fd < 0)
+        return 1;
+    epoll_fd = epoll_create1(0);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL; /* the listening socket */
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("Serving %u books on %s\n", srv.n_books, socket_path);
+    fflush(stdout);
+
+    while(running) {
+        n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        for(i=0; i<n; i++) {
+            c = (connection*)events[i].data.ptr;
+            if(c==NULL) {
+                while((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+                    fcntl(fd, F_SETFL, O_NONBLOCK);
+                    c = calloc(1, sizeof(connection));
+                    c->fd = fd;
+                    c->ctx = new_context();
+                    c->mode = MODE_IDLE;
+                    ev.events = EPOLLIN;
+                    ev.data.ptr = c;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+                    srv.n_connections++;
+                }
+                continue;
+            }
+            if((events[i].events & (EPOLLIN|EPOLLHUP|EPOLLERR)) && !c->read_closed && !receive(c)) {
+                close_connection(&srv, c);
+                continue;
+            }
+            pending = service(&srv, c);
+            /* Once the client has stopped sending, close after the last
+            response has gone */
+            if(pending < 0 || (pending==0 && c->read_closed)) {
+                close_connection(&srv, c);
+                continue;
+            }
+            /* Only wait for the socket to drain while there is output,
+            and for requests while there is room for them */
+            ev.events = (c->request_len < MAX_REQUEST && !c->read_closed ? EPOLLIN : 0) | (pending ? EPOLLOUT : 0);
+            ev.data.ptr = c;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+        }
+    }
+
+    printf("%llu requests (%llu bad), %llu bytes sent, %u connections open\n",
+           (unsigned long long)srv.n_requests, (unsigned long long)srv.n_errors,
+           (unsigned long long)srv.bytes_sent, srv.n_connections);
+    close(listen_fd);
+    close(epoll_fd);
+    unlink(socket_path);
+    for(b=0; b<srv.n_books; b++)
+        free_book(&srv.books[b]);
+    free(srv.books);
+    return 0;
+}
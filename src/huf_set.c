@@ -0,0 +1,165 @@
+/* Play a set of tunes gaplessly into a WAV file (see set_player.h).
+
+    huf_set [--rate <hz>] [--bits 8|16] [--crossfade <ms>] [--gap <bars>]
+            [--prefetch <symbols>] [--block <samples>] in.huf out.wav <tune>...
+
+Renders the tunes one after another with set_render, --block samples
+(default 512) at a time, as a DAC would pull them. The WAV header is
+written first, from set_length, so out.wav can be "-" for stdout.
+Prints "name value" lines (to stderr if writing to stdout): tunes,
+samples, transitions, late_primes (next tunes not ready in time), and
+the mean and worst time of a set_render call, overall and for the calls
+in which one tune handed over to the next, in microseconds.
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "tune_summary.h"
+#include "set_player.h"
+#include "wav_writer.h"
+#include "binary.h"
+
+#define MAX_SET 1024
+
+void usage()
+{
+    printf("Usage: huf_set [--rate <hz>] [--bits 8|16] [--crossfade <ms>] [--gap <bars>]\n");
+    printf("               [--prefetch <symbols>] [--block <samples>] <in.huf> <out.wav> <tune>...\n");
+}
+
+static double now_us()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec*1e6 + t.tv_nsec/1e3;
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *out_name = NULL;
+    uint32_t size, *tune_index, tunes[MAX_SET], n_tunes = 0, block = 512, got, transitions;
+    uint64_t samples = 0, n_calls = 0, n_transition_calls = 0;
+    uint8_t *buf, *block_buf;
+    int a, ok = 1;
+    huffman_buffer *h_buffer;
+    set_config config;
+    set_player *player;
+    wav_context header;
+    FILE *out, *report = stdout;
+    double t0, us, total_us = 0, max_us = 0, transition_us = 0, max_transition_us = 0;
+
+    default_set_config(&config);
+    for(a=1; a<argc; a++) {
+        if(!strcmp(argv[a], "--rate") && a+1<argc)
+            config.sample_rate = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--bits") && a+1<argc)
+            config.bits = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--crossfade") && a+1<argc)
+            config.crossfade_ms = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--gap") && a+1<argc)
+            config.gap_bars = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--prefetch") && a+1<argc)
+            config.prefetch_symbols = strtoul(argv[++a], NULL, 10);
+        else if(!strcmp(argv[a], "--block") && a+1<argc)
+            block = strtoul(argv[++a], NULL, 10);
+        else if(in_name==NULL)
+            in_name = argv[a];
+        else if(out_name==NULL)
+            out_name = argv[a];
+        else if(n_tunes<MAX_SET)
+            tunes[n_tunes++] = strtoul(argv[a], NULL, 10);
+    }
+    if(n_tunes==0 || block==0) {
+        usage();
+        return 1;
+    }
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    tune_index = load_tune_index(h_buffer, buf+size);
+    player = new_set_player(h_buffer, load_summary_section(h_buffer, buf+size, tune_index[0]),
+                            tune_index, tunes, n_tunes, &config);
+    if(player==NULL)
+        return 1;
+    if(set_length(player) > UINT32_MAX/(config.bits/8)) {
+        printf("Error: too many samples for a WAV file\n");
+        return 1;
+    }
+
+    if(!strcmp(out_name, "-")) {
+        out = stdout;
+        report = stderr;
+    }
+    else
+        out = fopen(out_name, "wb");
+    if(!out) {
+        printf("Error: could not open %s\n", out_name);
+        return 1;
+    }
+    header.f = out;
+    header.sample_rate = config.sample_rate;
+    header.n_channels = 1;
+    header.bits_per_sample = config.bits;
+    header.n_samples = (uint32_t)set_length(player);
+    write_header(&header);
+
+    block_buf = malloc((size_t)block*(config.bits/8));
+    while(!set_finished(player)) {
+        transitions = player->transitions;
+        t0 = now_us();
+        got = set_render(player, block_buf, block);
+        us = now_us() - t0;
+        total_us += us;
+        n_calls++;
+        if(us > max_us)
+            max_us = us;
+        if(player->transitions!=transitions) {
+            transition_us += us;
+            n_transition_calls++;
+            if(us > max_transition_us)
+                max_transition_us = us;
+        }
+        samples += got;
+        if(fwrite(block_buf, config.bits/8, got, out)!=got) {
+            printf("Error: write failed\n");
+            ok = 0;
+            break;
+        }
+        if(got < block)
+            break;
+    }
+    if(out!=stdout && fclose(out)!=0)
+        ok = 0;
+    if(ok && samples!=set_length(player)) {
+        printf("Error: rendered %llu samples, but the header says %llu\n", (unsigned long long)samples, (unsigned long long)set_length(player));
+        ok = 0;
+    }
+
+    fprintf(report, "tunes %u\n", n_tunes);
+    fprintf(report, "samples %llu\n", (unsigned long long)samples);
+    fprintf(report, "transitions %u\n", player->transitions);
+    fprintf(report, "late_primes %u\n", player->late_primes);
+    fprintf(report, "render_us_mean %.2f\n", n_calls ? total_us/n_calls : 0.0);
+    fprintf(report, "render_us_max %.2f\n", max_us);
+    fprintf(report, "transition_us_mean %.2f\n", n_transition_calls ? transition_us/n_transition_calls : 0.0);
+    fprintf(report, "transition_us_max %.2f\n", max_transition_us);
+
+    free(block_buf);
+    free_set_player(player);
+    free(tune_index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return !ok;
+}
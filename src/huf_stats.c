@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huf_stats.h"
+
+static const char *event_names[STATS_N_EVENTS] = {
+    "", "note", "rest", "chord", "bar", "key", "tune_start", "tune_end", "bar_duration"
+};
+
+void reset_stats(huf_stats *stats)
+{
+    /* Zero all counters */
+    memset(stats, 0, sizeof(huf_stats));
+}
+
+void dump_stats(huf_stats *stats, FILE *f)
+{
+    /* Write the counters to f, one "name value" pair per line */
+    int i;
+#ifndef HUF_STATS
+    fprintf(f, "# built without HUF_STATS; all counters are zero\n");
+#endif
+    fprintf(f, "bits_consumed %llu\n", (unsigned long long)stats->bits_consumed);
+    fprintf(f, "symbols %llu\n", (unsigned long long)stats->symbols);
+    for(i=1; i<=STATS_MAX_CODE_BITS; i++)
+        if(stats->symbols_by_length[i])
+            fprintf(f, "symbols_len_%d %llu\n", i, (unsigned long long)stats->symbols_by_length[i]);
+    fprintf(f, "table_probes %llu\n", (unsigned long long)stats->table_probes);
+    for(i=1; i<STATS_N_EVENTS; i++)
+        fprintf(f, "event_%s %llu\n", event_names[i], (unsigned long long)stats->events[i]);
+    fprintf(f, "callback_cycles %llu\n", (unsigned long long)stats->callback_cycles);
+    fprintf(f, "samples_written %llu\n", (unsigned long long)stats->samples_written);
+}
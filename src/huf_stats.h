@@ -0,0 +1,49 @@
+#ifndef HUF_STATS_H
+#define HUF_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+    Hot path counters for the decoder and renderer.
+    Counting is compiled in only when HUF_STATS is defined (make STATS=1);
+    otherwise STAT_ADD expands to nothing and the stats pointers are unused.
+    A huf_stats attached to a huffman_buffer is inherited by the tune_context
+    parse_tune creates, and by the wav writer it drives.
+*/
+
+#define STATS_MAX_CODE_BITS 32
+#define STATS_N_EVENTS 9 /* event codes are 1..8 */
+
+/* Cycle counter used to time callbacks. Define STATS_CLOCK to use a
+device's own counter, e.g. -DSTATS_CLOCK=read_cycle_counter */
+#ifndef STATS_CLOCK
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STATS_CLOCK() __builtin_ia32_rdtsc()
+#else
+#define STATS_CLOCK() ((uint64_t)clock())
+#endif
+#endif
+
+typedef struct huf_stats
+{
+    uint64_t bits_consumed;
+    uint64_t symbols;
+    uint64_t symbols_by_length[STATS_MAX_CODE_BITS+1]; /* indexed by code length */
+    uint64_t table_probes; /* table entries compared (or lookup table reads) in read_symbol */
+    uint64_t events[STATS_N_EVENTS]; /* indexed by EVENT_* code */
+    uint64_t callback_cycles; /* STATS_CLOCK ticks spent inside event_callback */
+    uint64_t samples_written; /* by write_note */
+} huf_stats;
+
+#ifdef HUF_STATS
+#define STAT_ADD(stats, field, n) do { if(stats) (stats)->field += (n); } while(0)
+#else
+#define STAT_ADD(stats, field, n) do { } while(0)
+#endif
+
+void reset_stats(huf_stats *stats);
+void dump_stats(huf_stats *stats, FILE *f);
+
+#endif
@@ -0,0 +1,196 @@
+/* Write a .huf file as a C header of static const tables, so that an
+embedded build can play it straight from flash with no startup work
+and no heap.
+
+    huf_to_c [--name <name>] in.huf out.h
+
+The header defines <name>_buffer and <name>_tune_index, for play_tune():
+    #include "out.h"
+    play_tune(&<name>_buffer, <name>_tune_index, ix, callback, NULL);
+Include it in exactly one source file.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_validate.h"
+#include "tune_catalogue.h"
+#include "binary.h"
+
+#define VALUES_PER_LINE 12
+
+void usage()
+{
+    printf("Usage: huf_to_c [--name <name>] <in.huf> <out.h>\n");
+}
+
+void default_name(char *fname, char *name, int max_len)
+{
+    /* Make a C identifier from the base name of fname */
+    char *base = strrchr(fname, '/');
+    int i = 0;
+    base = base ? base+1 : fname;
+    if(isdigit((unsigned char)*base))
+        name[i++] = '_';
+    while(*base && *base!='.' && i<max_len-1) {
+        name[i++] = isalnum((unsigned char)*base) ? tolower((unsigned char)*base) : '_';
+        base++;
+    }
+    name[i] = '\0';
+}
+
+void write_c_string(FILE *f, char *str, uint32_t len)
+{
+    /* Write str as a C string literal */
+    uint32_t i;
+    unsigned char c;
+    fputc('"', f);
+    for(i=0; i<len; i++) {
+        c = str[i];
+        if(c=='"' || c=='\\')
+            fprintf(f, "\\%c", c);
+        else if(c=='\n')
+            fprintf(f, "\\n");
+        else if(isprint(c) && c!='?') /* ? could start a trigraph */
+            fputc(c, f);
+        else
+            fprintf(f, "\\%03o", c);
+    }
+    fputc('"', f);
+}
+
+void write_u32_array(FILE *f, const char *decl, uint32_t *values, uint32_t n)
+{
+    /* Write a static const uint32_t array */
+    uint32_t i;
+    fprintf(f, "%s[%d] = {", decl, n);
+    for(i=0; i<n; i++)
+        fprintf(f, "%s0x%x,", i%VALUES_PER_LINE ? " " : "\n    ", values[i]);
+    fprintf(f, "\n};\n\n");
+}
+
+void write_c_header(FILE *f, char *in_name, char *name, huffman_buffer *h_buffer, uint32_t *index)
+{
+    huffman_table *table = h_buffer->table;
+    huffman_op *op;
+    uint32_t *values;
+    uint32_t i, n = table->n_entries;
+    uint32_t n_bytes = (h_buffer->n_bits+7)>>3;
+    char decl[128];
+    char guard[64];
+
+    fprintf(f, "/* Generated by huf_to_c from %s. Do not edit.\n", in_name);
+    fprintf(f, "   Include in exactly one source file, then play tunes with\n");
+    fprintf(f, "       play_tune(&%s_buffer, %s_tune_index, ix, callback, NULL);\n*/\n", name, name);
+    for(i=0; name[i]; i++)
+        guard[i] = toupper((unsigned char)name[i]);
+    guard[i] = '\0';
+    fprintf(f, "#ifndef %s_HUF_H\n#define %s_HUF_H\n\n", guard, guard);
+    fprintf(f, "#include <stdint.h>\n#include \"huffman.h\"\n#include \"player.h\"\n\n");
+
+    /* Table arrays: code lengths, codes, string offsets and the string pool */
+    values = malloc(sizeof(uint32_t)*(n+1));
+    for(i=0; i<n; i++)
+        values[i] = table->n_bits[i];
+    sprintf(decl, "static const uint8_t %s_n_bits", name);
+    write_u32_array(f, decl, values, n);
+    sprintf(decl, "static const uint32_t %s_codes", name);
+    write_u32_array(f, decl, table->codes, n);
+    for(i=0; i<=n; i++)
+        values[i] = table->token_offsets[i];
+    sprintf(decl, "static const huf_offset_t %s_token_offsets", name);
+    write_u32_array(f, decl, values, n+1);
+    free(values);
+    fprintf(f, "static const char %s_strings[%d] =", name, table->token_offsets[n]);
+    for(i=0; i<n; i++) {
+        fprintf(f, "\n    ");
+        write_c_string(f, TOKEN_STRING(table, i), TOKEN_LENGTH(table, i)+1);
+    }
+    fprintf(f, ";\n\n");
+
+    /* Pre-parsed tokens: op, a, b */
+    fprintf(f, "static const huffman_op %s_ops[%d] = {\n", name, n);
+    for(i=0; i<n; i++) {
+        op = &table->ops[i];
+        fprintf(f, "    {%d, %d, %d},\n", op->op, op->a, op->b);
+    }
+    fprintf(f, "};\n\n");
+
+    /* Decoding lookup table */
+    sprintf(decl, "static const uint32_t %s_lut_entries", name);
+    write_u32_array(f, decl, table->lut->entries, table->lut->n_entries);
+    fprintf(f, "static const huffman_lut %s_lut = {%d, %d, (uint32_t*)%s_lut_entries};\n\n",
+            name, table->lut->root_bits, table->lut->n_entries, name);
+
+    fprintf(f, "static const huffman_table %s_table = {%d, (uint8_t*)%s_n_bits, (uint32_t*)%s_codes,\n", name, n, name, name);
+    fprintf(f, "    (huf_offset_t*)%s_token_offsets, (char*)%s_strings, (huffman_lut*)&%s_lut, (huffman_op*)%s_ops, 1};\n\n",
+            name, name, name, name);
+
+    /* Tune index: count, then bit offsets */
+    sprintf(decl, "static const uint32_t %s_tune_index", name);
+    write_u32_array(f, decl, index, index[0]+1);
+
+    /* Compressed data */
+    fprintf(f, "static const uint8_t %s_data[%d] = {", name, n_bytes);
+    for(i=0; i<n_bytes; i++)
+        fprintf(f, "%s0x%02x,", i%VALUES_PER_LINE ? " " : "\n    ", (uint8_t)h_buffer->buf[i]);
+    fprintf(f, "\n};\n\n");
+
+    /* The only mutable part: the read position */
+    fprintf(f, "static huffman_buffer %s_buffer = {(huffman_table*)&%s_table, 0, (char*)%s_data, %d, NULL};\n\n",
+            name, name, name, h_buffer->n_bits);
+    fprintf(f, "#endif\n");
+}
+
+int main(int argc, char **argv)
+{
+    char *in_name = NULL, *out_name = NULL;
+    char name[64] = "";
+    int i;
+    uint8_t *buf;
+    uint32_t size, *index;
+    huffman_buffer *h_buffer;
+    FILE *f;
+
+    for(i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--name") && i+1<argc)
+            default_name(argv[++i], name, sizeof(name));
+        else if(in_name==NULL)
+            in_name = argv[i];
+        else if(out_name==NULL)
+            out_name = argv[i];
+    }
+    if(in_name==NULL || out_name==NULL) {
+        usage();
+        return 1;
+    }
+    if(name[0]=='\0')
+        default_name(in_name, name, sizeof(name));
+
+    buf = load_file(in_name, &size);
+    if(buf==NULL)
+        return 1;
+    h_buffer = load_huffman(buf, size);
+    if(h_buffer==NULL)
+        return 1;
+    index = load_tune_index(h_buffer, buf+size);
+
+    f = fopen(out_name, "w");
+    if(!f) {
+        printf("Error: could not open file %s\n", out_name);
+        return 1;
+    }
+    write_c_header(f, in_name, name, h_buffer, index);
+    fclose(f);
+    fprintf(stderr, "Wrote %s (%d tunes, %d table entries, %d lookup entries)\n", out_name,
+            index[0], h_buffer->table->n_entries, h_buffer->table->lut->n_entries);
+
+    free(index);
+    free_huffman_table(h_buffer->table);
+    free(h_buffer);
+    free(buf);
+    return 0;
+}
@@ -9,59 +9,93 @@
 #define BIT_AT(x, pos) ((x[pos>>3]>>(pos&7))&1)
 
 
-uint8_t *read_one_entry(uint8_t *buf, huffman_entry *entry)
+void init_huffman_table(huffman_table *table, uint32_t n_entries, uint32_t pool_size)
 {
-    /* Read one huffman entry from buf, returning the advanced buf pointer.
-    entry should already be allocated. 
-    */
+    /* Allocate the arrays of a table of n_entries, with room for
+    pool_size bytes of token strings (including their terminators) */
+    table->n_entries = n_entries;
+    table->n_bits = malloc(n_entries ? n_entries : 1);
+    table->codes = malloc(sizeof(uint32_t)*(n_entries ? n_entries : 1));
+    table->token_offsets = malloc(sizeof(huf_offset_t)*(n_entries+1));
+    table->token_offsets[0] = 0;
+    table->strings = malloc(pool_size ? pool_size : 1);
+    table->lut = NULL;
+    table->ops = NULL;
+    table->is_static = 0;
+}
+
+huffman_table *new_huffman_table(uint32_t n_entries, uint32_t pool_size)
+{
+    /* Allocate a table, as init_huffman_table */
+    huffman_table *table = malloc(sizeof(huffman_table));
+    init_huffman_table(table, n_entries, pool_size);
+    return table;
+}
+
+uint8_t *read_one_entry(uint8_t *buf, huffman_table *table, uint32_t i)
+{
+    /* Read entry i from buf, returning the advanced buf pointer.
+    Entries must be read in order, and the string pool must have room
+    for this token after those before it. */
     uint8_t *p = buf;
-    int i;
+    uint8_t len, n_bits, k;
+    uint32_t code = 0;
+    char *token = table->strings + table->token_offsets[i];
     
-    entry->token_string_len = readbuf_u8(&p);
-    entry->n_bits = readbuf_u8(&p);    
-    entry->token_string = malloc(entry->token_string_len+1);
-    readbuf_bytes(&p, entry->token_string, entry->token_string_len);    
-    entry->token_string[entry->token_string_len] = '\0';
+    len = readbuf_u8(&p);
+    n_bits = readbuf_u8(&p);
+    readbuf_bytes(&p, (uint8_t*)token, len);
+    token[len] = '\0';
+    table->token_offsets[i+1] = table->token_offsets[i] + len + 1;
 
     /* Read n bits into code */
-    entry->code = 0;
-    for (i=0; i<entry->n_bits; i++) {
-        entry->code = (entry->code<<1) | BIT_AT(p, i);
+    for (k=0; k<n_bits; k++) {
+        code = (code<<1) | BIT_AT(p, k);
     }    
-    p += (entry->n_bits+7)>>3;    
+    table->n_bits[i] = n_bits;
+    table->codes[i] = code;
+    p += (n_bits+7)>>3;    
     return p;    
 }
 
+uint32_t table_pool_size(uint8_t *buf, uint32_t n_entries)
+{
+    /* Bytes of token strings (with terminators) in the n_entries table
+    entries at buf */
+    uint32_t i, size = 0;
+    for(i=0; i<n_entries; i++) {
+        size += buf[0] + 1;
+        buf += 2 + buf[0] + ((buf[1]+7)>>3);
+    }
+    return size;
+}
+
 uint8_t *read_huffman_table(uint8_t *buf, huffman_table *table)
 {
     /* Read a huffman table from buf, returning the advanced buf pointer. */
     /* Table should already be allocated. */
-    
-    uint32_t i;
-    
-    huffman_entry *entry;        
-    /* read a uint32_t from buf */
-    table->n_entries = readbuf_u32(&buf);    
-    /* allocate space for the entries */
-    table->entries = malloc(sizeof(huffman_entry*)*(table->n_entries));    
-    /* read each entry */
-    for (i=0; i<table->n_entries; i++) {
-        entry = malloc(sizeof(huffman_entry));        
-        buf = read_one_entry(buf, entry);
-        table->entries[i] = entry;
-    }
+    uint32_t i, n_entries;
+    n_entries = readbuf_u32(&buf);    
+    init_huffman_table(table, n_entries, table_pool_size(buf, n_entries));
+    for (i=0; i<n_entries; i++)
+        buf = read_one_entry(buf, table, i);
     return buf;
 }
 
 void free_huffman_table(huffman_table *table)
 {
     /* Free the memory associated with a huffman table */
-    uint32_t i;
-    for(i=0; i<table->n_entries; i++) {
-        free(table->entries[i]->token_string);
-        free(table->entries[i]);
+    if(table->is_static)
+        return;
+    free(table->n_bits);
+    free(table->codes);
+    free(table->token_offsets);
+    free(table->strings);
+    if(table->lut) {
+        free(table->lut->entries);
+        free(table->lut);
     }
-    free(table->entries);
+    free(table->ops);
     free(table);
 }
 
@@ -86,6 +120,7 @@ huffman_buffer *read_huffman(uint8_t *buf)
     buffer->table = table;
     buffer->buf = buf;
     buffer->pos = 0;
+    buffer->stats = NULL;
     return buffer;
 }
 
@@ -95,7 +130,32 @@ void reset_buffer(huffman_buffer *buffer)
     buffer->pos = 0;
 }
 
+uint32_t match_code(huffman_table *table, uint32_t code, uint8_t n_bits)
+{
+    /* Return the index of the entry with exactly this code and length,
+    or INVALID_CODE if there is none. */
+    uint32_t i;
+    for(i=0; i<table->n_entries; i++) {
+        if (table->n_bits[i] == n_bits) {
+            /* Length matches */
+            if (table->codes[i] == code) {
+                /* Code matches */
+                return i;
+            }
+        }
+    }
+    return INVALID_CODE;
+}
+
 uint32_t read_symbol(huffman_buffer *buffer)
+{
+    /* Validated tables can take the fast path */
+    if(buffer->table->lut)
+        return read_symbol_unchecked(buffer);
+    return read_symbol_checked(buffer);
+}
+
+uint32_t read_symbol_checked(huffman_buffer *buffer)
 {
     /* Read up a huffman symbol from the buffer at bit index pos. 
     Update pos to the end of the symbol, and return the index of the symbol. */
@@ -113,16 +173,10 @@ uint32_t read_symbol(huffman_buffer *buffer)
         }
         b = BIT_AT(buffer->buf, buffer->pos);
         code = (code<<1) | b;
-        for(i=0; i<buffer->table->n_entries; i++) {
-            if (buffer->table->entries[i]->n_bits == buffer->pos-init_pos+1) {
-                /* Length matches */
-                if (buffer->table->entries[i]->code == code) {
-                    /* Code matches */
-                    found_code = 1;
-                    break;
-                }
-            }
-        }       
+        i = match_code(buffer->table, code, buffer->pos-init_pos+1);
+        STAT_ADD(buffer->stats, table_probes, i!=INVALID_CODE ? i+1 : buffer->table->n_entries);
+        if(i!=INVALID_CODE)
+            found_code = 1;
         /* Codes are at most 32 bits long */
         if(buffer->pos-init_pos+1 > 32) {
             printf("Error: no matching code found\n");
@@ -130,6 +184,9 @@ uint32_t read_symbol(huffman_buffer *buffer)
         }         
         (buffer->pos)++;
     }    
+    STAT_ADD(buffer->stats, symbols, 1);
+    STAT_ADD(buffer->stats, bits_consumed, buffer->pos-init_pos);
+    STAT_ADD(buffer->stats, symbols_by_length[buffer->pos-init_pos], 1);
     return i;
 }
 
@@ -145,10 +202,10 @@ uint32_t peek_symbol(huffman_buffer *buffer)
 void seek_symbol(uint32_t symbol, huffman_buffer *buffer)
 {
     /* Advance pos to the position immediately following symbol.*/
-    uint32_t found_symbol=INVALID_CODE;
-    while(found_symbol!=symbol) {
+    uint32_t found_symbol;
+    do {
         found_symbol = read_symbol(buffer);
-    }    
+    } while(found_symbol!=symbol && found_symbol!=INVALID_CODE);
 }
 
 uint32_t lookup_symbol_index(char *text, huffman_table *table)
@@ -157,9 +214,165 @@ uint32_t lookup_symbol_index(char *text, huffman_table *table)
     return INVALID_CODE if no match is found. */
     uint32_t i;
     for(i=0; i<table->n_entries; i++) {
-        if(strcmp(text, table->entries[i]->token_string)==0) {
+        if(strcmp(text, TOKEN_STRING(table, i))==0) {
             return i;
         }
     }
     return INVALID_CODE;
-}
\ No newline at end of file
+}
+
+static uint32_t reverse_bits(uint32_t code, uint8_t n_bits)
+{
+    /* Reverse the lowest n_bits of code */
+    uint32_t rev = 0;
+    uint8_t i;
+    for(i=0; i<n_bits; i++) {
+        rev = (rev<<1) | (code&1);
+        code >>= 1;
+    }
+    return rev;
+}
+
+static uint8_t lut_root_bits(huffman_table *table)
+{
+    /* Bits indexing the root table: the longest code, up to LUT_ROOT_BITS */
+    uint32_t i;
+    uint8_t max_bits = 0;
+    for(i=0; i<table->n_entries; i++)
+        if(table->n_bits[i] > max_bits)
+            max_bits = table->n_bits[i];
+    return max_bits < LUT_ROOT_BITS ? max_bits : LUT_ROOT_BITS;
+}
+
+static uint8_t *subtable_bits(huffman_table *table, uint8_t root_bits)
+{
+    /* Find how many more bits each root entry's subtable needs (0 for
+    none), or NULL if out of memory */
+    uint32_t n_root = 1u<<root_bits, i, root;
+    uint8_t n_bits, *group_bits = calloc(n_root, 1);
+    if(group_bits==NULL)
+        return NULL;
+    for(i=0; i<table->n_entries; i++) {
+        n_bits = table->n_bits[i];
+        if(n_bits > root_bits) {
+            root = reverse_bits(table->codes[i], n_bits) & (n_root-1);
+            if(n_bits - root_bits > group_bits[root])
+                group_bits[root] = n_bits - root_bits;
+        }
+    }
+    return group_bits;
+}
+
+uint64_t lut_size(huffman_table *table)
+{
+    /* The number of entries build_lut would need for a table with codes
+    of 1 to 32 bits, or UINT64_MAX if out of memory */
+    uint8_t root_bits = lut_root_bits(table);
+    uint8_t *group_bits = subtable_bits(table, root_bits);
+    uint64_t n = 1u<<root_bits;
+    uint32_t i;
+    if(group_bits==NULL)
+        return UINT64_MAX;
+    for(i=0; i<(1u<<root_bits); i++)
+        if(group_bits[i])
+            n += (uint64_t)1<<group_bits[i];
+    free(group_bits);
+    return n;
+}
+
+huffman_lut *build_lut(huffman_table *table)
+{
+    /* Build the decoding lookup table for a prefix-free, complete
+    table with codes of 1 to 32 bits, needing at most MAX_LUT_ENTRIES.
+    Check with validate_huffman first: this does not check the codes.
+    Returns NULL if out of memory. */
+    huffman_lut *lut = malloc(sizeof(huffman_lut));
+    uint32_t n_root, i, j, root, rev, offset, step;
+    uint8_t n_bits, sub_bits;
+    uint8_t *group_bits;
+
+    if(lut==NULL) {
+        printf("Error: out of memory for the lookup table\n");
+        return NULL;
+    }
+    lut->root_bits = lut_root_bits(table);
+    n_root = 1u<<lut->root_bits;
+    group_bits = subtable_bits(table, lut->root_bits);
+
+    /* Lay the subtables out after the root table */
+    lut->n_entries = n_root;
+    for(i=0; group_bits && i<n_root; i++)
+        if(group_bits[i])
+            lut->n_entries += 1u<<group_bits[i];
+    lut->entries = group_bits ? calloc(lut->n_entries, sizeof(uint32_t)) : NULL;
+    if(lut->entries==NULL) {
+        printf("Error: out of memory for the lookup table\n");
+        free(group_bits);
+        free(lut);
+        return NULL;
+    }
+    offset = n_root;
+    for(i=0; i<n_root; i++) {
+        if(group_bits[i]) {
+            lut->entries[i] = LUT_LINK | (offset<<8) | group_bits[i];
+            offset += 1u<<group_bits[i];
+        }
+    }
+    /* Fill in every slot whose leading bits match each code */
+    for(i=0; i<table->n_entries; i++) {
+        n_bits = table->n_bits[i];
+        rev = reverse_bits(table->codes[i], n_bits);
+        if(n_bits <= lut->root_bits) {
+            step = 1u<<n_bits;
+            for(j=rev; j<n_root; j+=step)
+                lut->entries[j] = (i<<8) | n_bits;
+        }
+        else {
+            root = rev & (n_root-1);
+            sub_bits = lut->entries[root] & 0xFF;
+            offset = (lut->entries[root] & ~LUT_LINK) >> 8;
+            step = 1u<<(n_bits-lut->root_bits);
+            for(j=rev>>lut->root_bits; j < (1u<<sub_bits); j+=step)
+                lut->entries[offset+j] = (i<<8) | n_bits;
+        }
+    }
+    free(group_bits);
+    return lut;
+}
+
+uint32_t read_symbol_unchecked(huffman_buffer *buffer)
+{
+    /* Read a symbol with the lookup table. The table must be validated.
+    At the end of the data this returns INVALID_CODE, so a walk from a
+    bad offset stops there; a code running off the end sees zero bits.
+    Either way it never touches memory outside the buffer. */
+    huffman_lut *lut = buffer->table->lut;
+    uint8_t *p = (uint8_t*)buffer->buf + (buffer->pos>>3);
+    uint32_t n_bytes = (buffer->n_bits+7)>>3;
+    uint32_t avail = (buffer->pos>>3) < n_bytes ? n_bytes - (buffer->pos>>3) : 0;
+    uint64_t window = 0;
+    uint32_t entry, i;
+
+    /* Load 8 bytes (at least 57 bits after the shift), first bit lowest */
+    if(avail >= 8)
+        window = readbuf_u64(&p);
+    else if(buffer->pos >= buffer->n_bits)
+        return INVALID_CODE;
+    else
+        for(i=0; i<avail; i++)
+            window |= (uint64_t)p[i] << (8*i);
+    window >>= buffer->pos&7;
+
+    entry = lut->entries[window & ((1u<<lut->root_bits)-1)];
+    STAT_ADD(buffer->stats, table_probes, 1);
+    if(entry & LUT_LINK) {
+        entry = lut->entries[((entry & ~LUT_LINK)>>8) +
+                             ((window>>lut->root_bits) & ((1u<<(entry&0xFF))-1))];
+        STAT_ADD(buffer->stats, table_probes, 1);
+    }
+    buffer->pos += entry & 0xFF;
+    STAT_ADD(buffer->stats, symbols, 1);
+    STAT_ADD(buffer->stats, bits_consumed, entry & 0xFF);
+    STAT_ADD(buffer->stats, symbols_by_length[entry & 0xFF], 1);
+    return entry>>8;
+}
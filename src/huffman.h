@@ -2,22 +2,63 @@
 #define HUFFMAN_H
 
 #include <stdint.h>
+#include "huf_stats.h"
 
-/* Holds one entry in the huffman table */
-typedef struct huffman_entry {
-    uint8_t n_bits;
-    uint32_t code;
-    char *token_string;
-    uint8_t token_string_len;
-} huffman_entry;
+/* Offsets into a table's string pool. HUF_COMPACT builds use 16 bits,
+limiting the pool to 64 KB (a few hundred tokens need about 1 KB) */
+#ifdef HUF_COMPACT
+typedef uint16_t huf_offset_t;
+#define MAX_STRING_POOL 0xFFFF
+#else
+typedef uint32_t huf_offset_t;
+#define MAX_STRING_POOL 0xFFFFFFFF
+#endif
 
-/* An entire table of huffman entries */
+/* Lookup table for decoding a whole code at once.
+   Indexed by the next root_bits bits of the stream (first bit lowest).
+   Each entry is either a leaf: [symbol:24] [code length:8]
+   or, for codes longer than root_bits, a link to a subtable:
+       LUT_LINK | [subtable offset:23] [subtable index bits:8]
+   which is indexed by the bits following the root bits. */
+typedef struct huffman_lut
+{
+    uint8_t root_bits;
+    uint32_t n_entries;
+    uint32_t *entries;
+} huffman_lut;
+
+#define LUT_ROOT_BITS 9
+#define LUT_LINK 0x80000000
+#define MAX_SYMBOLS (1u<<24) /* symbols must fit a leaf's 24 bits */
+#define MAX_LUT_ENTRIES (1u<<22) /* 16 MB; subtable offsets must fit 23 bits */
+
+/* A token pre-parsed into its leading character and numeric operands,
+   so decoding need not parse the token string every time */
+typedef struct huffman_op
+{
+    char op;
+    int32_t a;
+    int32_t b;
+} huffman_op;
+
+/* An entire table of huffman entries, one array per field.
+   Token i is the NUL terminated string at strings+token_offsets[i];
+   token_offsets has a final entry for the end of the pool. */
 typedef struct huffman_table
 {
-    huffman_entry **entries;
-    uint32_t n_entries;    
+    uint32_t n_entries;
+    uint8_t *n_bits; /* code length of each entry */
+    uint32_t *codes; /* each code, first bit most significant */
+    huf_offset_t *token_offsets; /* n_entries+1 offsets into strings */
+    char *strings; /* every token string, end to end */
+    huffman_lut *lut; /* NULL unless the table has been validated */
+    huffman_op *ops; /* NULL, or one op per entry */
+    uint8_t is_static; /* 1 if compiled in (huf_to_c, presets): never freed */
 } huffman_table;
 
+#define TOKEN_STRING(table, i) ((table)->strings + (table)->token_offsets[i])
+#define TOKEN_LENGTH(table, i) ((uint32_t)((table)->token_offsets[(i)+1] - (table)->token_offsets[i] - 1))
+
 
 /* A pointer to a buffer, and the current bit index */
 typedef struct huffman_buffer
@@ -26,6 +67,7 @@ typedef struct huffman_buffer
     uint32_t pos;
     char *buf;
     uint32_t n_bits;
+    huf_stats *stats; /* NULL, or counters to update when built with HUF_STATS */
 } huffman_buffer;
 
 /*
@@ -33,13 +75,22 @@ typedef struct huffman_buffer
     -- 'ABCM' [n_huffman_codes:u32] [huffman table] [n_bits_compressed_data:u32] [compressed data]    
     Huffman table:
         [N byte len of string:u8] [K bit width of code:u8] [string:u8*N] [code padded to byte width:u8*|`K/8`|]
+    Files naming a built-in table instead begin 'HUFP' (see huffman_preset.h).
 */
 
-uint8_t *read_one_entry(uint8_t *buf, huffman_entry *entry);
+void init_huffman_table(huffman_table *table, uint32_t n_entries, uint32_t pool_size);
+huffman_table *new_huffman_table(uint32_t n_entries, uint32_t pool_size);
+uint32_t table_pool_size(uint8_t *buf, uint32_t n_entries);
+uint8_t *read_one_entry(uint8_t *buf, huffman_table *table, uint32_t i);
 uint8_t *read_huffman_table(uint8_t *buf, huffman_table *table);
 huffman_buffer *read_huffman(uint8_t *buf);
 void reset_buffer(huffman_buffer *buffer);
+uint32_t match_code(huffman_table *table, uint32_t code, uint8_t n_bits);
 uint32_t read_symbol(huffman_buffer *buffer);
+uint32_t read_symbol_checked(huffman_buffer *buffer);
+uint32_t read_symbol_unchecked(huffman_buffer *buffer);
+uint64_t lut_size(huffman_table *table);
+huffman_lut *build_lut(huffman_table *table);
 uint32_t peek_symbol(huffman_buffer *buffer);
 void seek_symbol(uint32_t symbol, huffman_buffer *buffer);
 uint32_t lookup_symbol_index(char *text, huffman_table *table);
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_sections.h"
+#include "huffman_crc.h"
+#include "binary.h"
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#else
+#define CRC32C_POLY 0x82F63B78 /* reflected */
+
+/* crc_tables[k][b] is the CRC of byte b followed by k zero bytes */
+static uint32_t crc_tables[8][256];
+static int crc_tables_ready = 0;
+
+static void init_crc_tables()
+{
+    /* Not thread-safe; the first crc32c call builds the tables */
+    uint32_t i, j, k, crc;
+    for(i=0; i<256; i++) {
+        crc = i;
+        for(j=0; j<8; j++)
+            crc = (crc>>1) ^ (crc&1 ? CRC32C_POLY : 0);
+        crc_tables[0][i] = crc;
+    }
+    for(i=0; i<256; i++)
+        for(k=1; k<8; k++)
+            crc_tables[k][i] = (crc_tables[k-1][i]>>8) ^ crc_tables[0][crc_tables[k-1][i]&0xff];
+    crc_tables_ready = 1;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const uint8_t *data, uint32_t n_bytes)
+{
+    /* Continue a CRC32C (start from 0) over n_bytes of data */
+#if defined(__SSE4_2__)
+    uint64_t word;
+    crc = ~crc;
+    while(n_bytes >= 8) {
+        memcpy(&word, data, 8);
+        crc = (uint32_t)_mm_crc32_u64(crc, word);
+        data += 8;
+        n_bytes -= 8;
+    }
+    while(n_bytes--)
+        crc = _mm_crc32_u8(crc, *data++);
+    return ~crc;
+#elif defined(__ARM_FEATURE_CRC32)
+    uint64_t word;
+    crc = ~crc;
+    while(n_bytes >= 8) {
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        n_bytes -= 8;
+    }
+    while(n_bytes--)
+        crc = __crc32cb(crc, *data++);
+    return ~crc;
+#else
+    uint32_t lo, hi;
+    if(!crc_tables_ready)
+        init_crc_tables();
+    crc = ~crc;
+    while(n_bytes >= 8) {
+        /* Bytes are combined explicitly, so this works on any endianness */
+        lo = crc ^ (data[0] | data[1]<<8 | data[2]<<16 | (uint32_t)data[3]<<24);
+        hi = data[4] | data[5]<<8 | data[6]<<16 | (uint32_t)data[7]<<24;
+        crc = crc_tables[7][lo&0xff] ^ crc_tables[6][(lo>>8)&0xff] ^
+              crc_tables[5][(lo>>16)&0xff] ^ crc_tables[4][lo>>24] ^
+              crc_tables[3][hi&0xff] ^ crc_tables[2][(hi>>8)&0xff] ^
+              crc_tables[1][(hi>>16)&0xff] ^ crc_tables[0][hi>>24];
+        data += 8;
+        n_bytes -= 8;
+    }
+    while(n_bytes--)
+        crc = crc_tables[0][(crc ^ *data++)&0xff] ^ (crc>>8);
+    return ~crc;
+#endif
+}
+
+uint8_t *build_crc_section(uint8_t *file, huffman_buffer *buffer, uint32_t chunk_bytes, uint32_t *length)
+{
+    /* Checksum the header and every chunk_bytes of the data of the file
+    starting at file, and return a malloc'd section payload, setting
+    *length */
+    uint8_t *data = (uint8_t*)buffer->buf, *section, *p;
+    uint32_t data_bytes = data_end(buffer) - data;
+    uint32_t i, n_chunks, size;
+    if(chunk_bytes==0)
+        chunk_bytes = DEFAULT_CRC_CHUNK;
+    n_chunks = (data_bytes + chunk_bytes - 1)/chunk_bytes;
+    section = malloc(12 + 4*n_chunks);
+    p = section;
+    writebuf_u32(&p, chunk_bytes);
+    writebuf_u32(&p, crc32c(0, file, data-file));
+    writebuf_u32(&p, n_chunks);
+    for(i=0; i<n_chunks; i++) {
+        size = data_bytes - i*chunk_bytes < chunk_bytes ? data_bytes - i*chunk_bytes : chunk_bytes;
+        writebuf_u32(&p, crc32c(0, data + i*chunk_bytes, size));
+    }
+    *length = p - section;
+    return section;
+}
+
+crc_check *load_crc_check(uint8_t *file, huffman_buffer *buffer, uint8_t *file_end)
+{
+    /* Read the checksum section and check the header against it.
+    Returns NULL if the file has no checksums, or they do not fit it. */
+    uint32_t length;
+    uint8_t *p = find_section(buffer, file_end, CRC_TAG, &length);
+    crc_check *check;
+    uint32_t header_crc = 0;
+    if(p==NULL)
+        return NULL;
+    check = malloc(sizeof(crc_check));
+    check->data = (uint8_t*)buffer->buf;
+    check->data_bytes = data_end(buffer) - check->data;
+    if(length >= 12) {
+        check->chunk_bytes = readbuf_u32(&p);
+        header_crc = readbuf_u32(&p);
+        check->n_chunks = readbuf_u32(&p);
+    }
+    if(length < 12 || check->chunk_bytes==0 || length != 12 + 4*(uint64_t)check->n_chunks ||
+       check->n_chunks != (check->data_bytes + (uint64_t)check->chunk_bytes - 1)/check->chunk_bytes) {
+        printf("Error: checksum section does not match the data\n");
+        free(check);
+        return NULL;
+    }
+    check->crcs = p;
+    check->status = calloc(check->n_chunks+1, 1);
+    check->header_ok = crc32c(0, file, check->data-file)==header_crc;
+    check->n_checked = 0;
+    check->n_bad = 0;
+    if(!check->header_ok)
+        printf("Error: header checksum mismatch\n");
+    return check;
+}
+
+void free_crc_check(crc_check *check)
+{
+    free(check->status);
+    free(check);
+}
+
+int check_chunk(crc_check *check, uint32_t chunk)
+{
+    /* 1 if the chunk matches its checksum, checking it the first time */
+    uint8_t *p;
+    uint32_t size, start;
+    if(chunk >= check->n_chunks)
+        return 0;
+    if(check->status[chunk]==CHUNK_UNCHECKED) {
+        p = check->crcs + 4*chunk;
+        start = chunk*check->chunk_bytes;
+        size = check->data_bytes - start < check->chunk_bytes ? check->data_bytes - start : check->chunk_bytes;
+        check->status[chunk] = crc32c(0, check->data + start, size)==readbuf_u32(&p) ? CHUNK_OK : CHUNK_BAD;
+        check->n_checked++;
+        if(check->status[chunk]==CHUNK_BAD)
+            check->n_bad++;
+    }
+    return check->status[chunk]==CHUNK_OK;
+}
+
+int check_bits(crc_check *check, uint32_t first_bit, uint32_t end_bit)
+{
+    /* 1 if every chunk holding bits [first_bit, end_bit) is intact */
+    uint32_t chunk, last;
+    if(end_bit <= first_bit)
+        return 1;
+    last = ((end_bit-1)>>3)/check->chunk_bytes;
+    for(chunk=(first_bit>>3)/check->chunk_bytes; chunk<=last; chunk++)
+        if(!check_chunk(check, chunk))
+            return 0;
+    return 1;
+}
+
+int check_tune(crc_check *check, const uint32_t *tune_index, uint32_t ix, uint32_t n_bits)
+{
+    /* 1 if the header and every chunk of tune ix's bits are intact */
+    uint32_t end = ix+1 < tune_index[0] ? tune_index[ix+2] : n_bits;
+    return check->header_ok && check_bits(check, tune_index[ix+1], end);
+}
+
+uint32_t check_all(crc_check *check)
+{
+    /* Check every chunk; returns the number that are corrupt */
+    uint32_t i;
+    for(i=0; i<check->n_chunks; i++)
+        check_chunk(check, i);
+    return check->n_bad;
+}
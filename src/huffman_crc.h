@@ -0,0 +1,53 @@
+#ifndef HUFFMAN_CRC_H
+#define HUFFMAN_CRC_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+#define CRC_TAG "TCRC"
+#define DEFAULT_CRC_CHUNK 1024 /* bytes of compressed data per checksum */
+
+/*
+    Checksum section payload:
+        [chunk_bytes:u32] [header_crc:u32] [n_chunks:u32] [chunk_crc:u32*n_chunks]
+    All are CRC32C. The header is every byte from the start of the file
+    to the start of the compressed data (magic, table and bit count);
+    chunk i is data bytes [i*chunk_bytes, (i+1)*chunk_bytes), the last
+    one short. The sections themselves are not covered.
+
+    A corrupt header makes the whole file unusable, so it is checked as
+    soon as the section is loaded; chunks are checked when first asked
+    about (check_tune checks only the chunks a tune's bits lie in) and
+    the result remembered, so a flipped bit costs only the tunes that
+    cross its chunk.
+
+    crc32c uses the SSE4.2 or ARMv8 CRC instructions if the compiler
+    targets them (make HWCRC=1 on x86), otherwise slicing-by-8 tables.
+*/
+
+#define CHUNK_UNCHECKED 0
+#define CHUNK_OK 1
+#define CHUNK_BAD 2
+
+typedef struct crc_check
+{
+    uint8_t *data; /* the compressed data */
+    uint32_t data_bytes;
+    uint32_t chunk_bytes;
+    uint32_t n_chunks;
+    uint8_t *crcs; /* the chunk CRCs, in the section */
+    uint8_t *status; /* CHUNK_ code per chunk */
+    uint8_t header_ok;
+    uint32_t n_checked, n_bad;
+} crc_check;
+
+uint32_t crc32c(uint32_t crc, const uint8_t *data, uint32_t n_bytes);
+uint8_t *build_crc_section(uint8_t *file, huffman_buffer *buffer, uint32_t chunk_bytes, uint32_t *length);
+crc_check *load_crc_check(uint8_t *file, huffman_buffer *buffer, uint8_t *file_end);
+void free_crc_check(crc_check *check);
+int check_chunk(crc_check *check, uint32_t chunk);
+int check_bits(crc_check *check, uint32_t first_bit, uint32_t end_bit);
+int check_tune(crc_check *check, const uint32_t *tune_index, uint32_t ix, uint32_t n_bits);
+uint32_t check_all(crc_check *check);
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_encode.h"
+#include "binary.h"
+
+#define MAX_CODE_BITS 32
+
+typedef struct code_node
+{
+    uint64_t count;
+    int32_t parent;
+} code_node;
+
+static int compare_counts(const void *a, const void *b)
+{
+    uint64_t x = (*(code_node**)a)->count, y = (*(code_node**)b)->count;
+    return x<y ? -1 : x>y;
+}
+
+static uint8_t build_lengths(uint64_t *counts, uint32_t n, uint8_t *lengths)
+{
+    /* Huffman code lengths for n >= 2 counts, by the two-queue method:
+    leaves sorted by count in one queue, merged nodes (which come out in
+    increasing order) in the other. Returns the longest length. */
+    code_node *nodes = malloc(sizeof(code_node)*(2*n-1));
+    code_node **leaves = malloc(sizeof(code_node*)*n);
+    uint32_t i, next_leaf = 0, next_merged = n, n_nodes = n, pick, k;
+    uint8_t max_len = 0, len;
+    int32_t p;
+
+    for(i=0; i<n; i++) {
+        nodes[i].count = counts[i];
+        nodes[i].parent = -1;
+        leaves[i] = &nodes[i];
+    }
+    qsort(leaves, n, sizeof(code_node*), compare_counts);
+    while(n_nodes < 2*n-1) {
+        /* Merge the two smallest of the leaf and merged queues */
+        uint32_t two[2];
+        for(k=0; k<2; k++) {
+            if(next_leaf<n && (next_merged==n_nodes || leaves[next_leaf]->count <= nodes[next_merged].count))
+                pick = leaves[next_leaf++] - nodes;
+            else
+                pick = next_merged++;
+            two[k] = pick;
+        }
+        nodes[n_nodes].count = nodes[two[0]].count + nodes[two[1]].count;
+        nodes[n_nodes].parent = -1;
+        nodes[two[0]].parent = n_nodes;
+        nodes[two[1]].parent = n_nodes;
+        n_nodes++;
+    }
+    for(i=0; i<n; i++) {
+        len = 0;
+        for(p=nodes[i].parent; p>=0 && len<255; p=nodes[p].parent)
+            len++;
+        lengths[i] = len;
+        if(len>max_len)
+            max_len = len;
+    }
+    free(leaves);
+    free(nodes);
+    return max_len;
+}
+
+static huffman_table *canonical_table(char **tokens, uint8_t *lengths, uint32_t n_tokens)
+{
+    /* Make the table with canonical codes of the given lengths: shorter
+    codes first, then in token order */
+    huffman_table *table;
+    uint64_t pool_size;
+    uint32_t i, code = 0;
+    uint8_t len;
+
+    for(i=0, pool_size=0; i<n_tokens; i++)
+        pool_size += strlen(tokens[i]) + 1;
+    table = new_huffman_table(n_tokens, pool_size);
+    for(i=0; i<n_tokens; i++) {
+        strcpy(TOKEN_STRING(table, i), tokens[i]);
+        table->token_offsets[i+1] = table->token_offsets[i] + strlen(tokens[i]) + 1;
+        table->n_bits[i] = lengths[i];
+    }
+    /* Assign canonical codes, length by length */
+    for(len=1; len<=MAX_CODE_BITS; len++) {
+        for(i=0; i<n_tokens; i++) {
+            if(lengths[i]==len)
+                table->codes[i] = code++;
+        }
+        code <<= 1;
+    }
+    return table;
+}
+
+huffman_table *build_huffman_codes(char **tokens, uint64_t *counts, uint32_t n_tokens)
+{
+    /* Make a huffman table for n_tokens (at least 2) tokens of up to
+    255 characters, with codes of at most 32 bits that fit the lookup
+    table of a loaded file (see MAX_LUT_ENTRIES). Entry i is for
+    tokens[i]; counts of 0 are treated as 1, so every token gets a code.
+    Codes are canonical: shorter codes first, then in token order. */
+    huffman_table *table = NULL;
+    uint64_t *scaled;
+    uint8_t *lengths;
+    uint32_t i;
+    int flat;
+
+    if(n_tokens < 2 || n_tokens >= MAX_SYMBOLS) {
+        printf("Error: need 2 to %u tokens to build codes\n", MAX_SYMBOLS-1);
+        return NULL;
+    }
+    scaled = malloc(sizeof(uint64_t)*n_tokens);
+    lengths = malloc(n_tokens);
+    for(i=0; i<n_tokens; i++)
+        scaled[i] = counts[i] ? counts[i] : 1;
+    /* Flatten the counts until the longest code fits, and the codes
+    fit the lookup table */
+    for(;;) {
+        if(build_lengths(scaled, n_tokens, lengths) <= MAX_CODE_BITS) {
+            table = canonical_table(tokens, lengths, n_tokens);
+            if(lut_size(table) <= MAX_LUT_ENTRIES)
+                break;
+            free_huffman_table(table);
+            table = NULL;
+        }
+        flat = 1;
+        for(i=0; i<n_tokens; i++) {
+            flat &= scaled[i]==1;
+            scaled[i] = (scaled[i]>>1) | 1;
+        }
+        if(flat) {
+            printf("Error: too many tokens for the lookup table\n");
+            break;
+        }
+    }
+    free(scaled);
+    free(lengths);
+    return table;
+}
+
+uint64_t encoded_bits(huffman_table *table, uint64_t *counts)
+{
+    /* The number of bits counts[i] copies of each symbol i will take */
+    uint64_t n_bits = 0;
+    uint32_t i;
+    for(i=0; i<table->n_entries; i++)
+        n_bits += counts[i] * table->n_bits[i];
+    return n_bits;
+}
+
+void write_huffman_header(FILE *f, huffman_table *table, uint32_t n_bits)
+{
+    /* Write the 'HUFM' header and table, and the length of the data that
+    will follow, in the format read_huffman reads */
+    uint32_t i;
+    uint8_t k, code_bytes[4], n;
+    write_bytes(f, "HUFM", 4);
+    write_u32(f, table->n_entries);
+    for(i=0; i<table->n_entries; i++) {
+        n = table->n_bits[i];
+        write_u8(f, TOKEN_LENGTH(table, i));
+        write_u8(f, n);
+        write_bytes(f, TOKEN_STRING(table, i), TOKEN_LENGTH(table, i));
+        /* The first bit of the code is its most significant */
+        memset(code_bytes, 0, sizeof(code_bytes));
+        for(k=0; k<n; k++)
+            if((table->codes[i] >> (n-1-k)) & 1)
+                code_bytes[k>>3] |= 1<<(k&7);
+        write_bytes(f, code_bytes, (n+7)>>3);
+    }
+    write_u32(f, n_bits);
+}
+
+void init_bit_writer(bit_writer *bw, FILE *f)
+{
+    bw->f = f;
+    bw->byte = 0;
+    bw->n = 0;
+    bw->n_bits = 0;
+}
+
+void write_code(bit_writer *bw, uint32_t code, uint8_t n_bits)
+{
+    /* Append an n_bits code, most significant bit first */
+    while(n_bits--) {
+        bw->byte |= ((code>>n_bits)&1) << bw->n;
+        if(++bw->n==8) {
+            fputc(bw->byte, bw->f);
+            bw->byte = 0;
+            bw->n = 0;
+        }
+        bw->n_bits++;
+    }
+}
+
+void write_symbol(bit_writer *bw, huffman_table *table, uint32_t symbol)
+{
+    write_code(bw, table->codes[symbol], table->n_bits[symbol]);
+}
+
+void flush_bits(bit_writer *bw)
+{
+    /* Write out any partial byte, zero padded */
+    if(bw->n) {
+        fputc(bw->byte, bw->f);
+        bw->byte = 0;
+        bw->n = 0;
+    }
+}
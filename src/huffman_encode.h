@@ -0,0 +1,30 @@
+#ifndef HUFFMAN_ENCODE_H
+#define HUFFMAN_ENCODE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huffman.h"
+
+/* Writing HUFM files from C, as huf_compress_tune.lua does:
+    table = build_huffman_codes(tokens, counts, n);
+    write_huffman_header(f, table, total bits);
+    then write_code() for every symbol, and flush_bits() */
+
+/* Writes codes into a file, first bit in the lowest bit of each byte */
+typedef struct bit_writer
+{
+    FILE *f;
+    uint8_t byte; /* bits not yet written */
+    uint8_t n; /* number of bits in byte */
+    uint64_t n_bits; /* total written */
+} bit_writer;
+
+huffman_table *build_huffman_codes(char **tokens, uint64_t *counts, uint32_t n_tokens);
+uint64_t encoded_bits(huffman_table *table, uint64_t *counts);
+void write_huffman_header(FILE *f, huffman_table *table, uint32_t n_bits);
+void init_bit_writer(bit_writer *bw, FILE *f);
+void write_code(bit_writer *bw, uint32_t code, uint8_t n_bits);
+void write_symbol(bit_writer *bw, huffman_table *table, uint32_t symbol);
+void flush_bits(bit_writer *bw);
+
+#endif
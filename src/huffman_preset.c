@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_preset.h"
+#include "binary.h"
+#include "preset_abc1.h"
+
+/* Every preset this decoder knows, oldest first */
+static const huffman_preset presets[] = {
+    {1, "abc1", &abc1_table, ABC1_ESCAPE},
+};
+
+#define N_PRESETS (sizeof(presets)/sizeof(presets[0]))
+
+const huffman_preset *find_preset(uint32_t id)
+{
+    /* The preset with this id, or NULL if this build does not have it */
+    uint32_t i;
+    for(i=0; i<N_PRESETS; i++)
+        if(presets[i].id==id)
+            return &presets[i];
+    return NULL;
+}
+
+const huffman_preset *preset_at(uint32_t i)
+{
+    /* The i'th preset, newest last; NULL past the end */
+    return i<N_PRESETS ? &presets[i] : NULL;
+}
+
+uint32_t delta_suffix(uint32_t j, uint32_t n_delta, uint8_t *n_bits)
+{
+    /* The truncated binary code for delta token j of n_delta, which
+    follows the escape code; sets *n_bits to its length (0 if there is
+    only one delta token) */
+    uint8_t k = 0;
+    uint64_t u;
+    while(((uint64_t)2<<k) <= n_delta)
+        k++;
+    u = ((uint64_t)2<<k) - n_delta;
+    if(j < u) {
+        *n_bits = k;
+        return j;
+    }
+    *n_bits = k+1;
+    return (uint32_t)(j+u);
+}
+
+uint32_t delta_pool_size(uint8_t *entries, uint32_t n_delta)
+{
+    /* Bytes of the n_delta delta tokens at entries. As each length byte
+    becomes a terminator, this is also the string pool they need. */
+    uint32_t i, size = 0;
+    for(i=0; i<n_delta; i++) {
+        size += entries[0] + 1;
+        entries += entries[0] + 1;
+    }
+    return size;
+}
+
+int check_delta_tokens(uint8_t *entries, uint8_t *end, uint32_t n_delta)
+{
+    /* Check the n_delta delta tokens at entries lie before end, none is
+    empty, and their strings fit this build's pool. Shared by the file
+    and stream loaders, so they accept the same files. Returns 1 if good. */
+    uint8_t *p = entries;
+    uint64_t pool_size = 0;
+    uint32_t i;
+    for(i=0; i<n_delta; i++) {
+        if(end-p < 1 || (uint32_t)(end-p) < 1 + (uint32_t)p[0]) {
+            printf("Error: truncated delta tokens\n");
+            return 0;
+        }
+        if(p[0]==0) {
+            printf("Error: empty token\n");
+            return 0;
+        }
+        pool_size += p[0] + 1;
+        p += 1 + p[0];
+    }
+    if(pool_size > MAX_STRING_POOL) {
+        printf("Error: token strings too long for this build\n");
+        return 0;
+    }
+    return 1;
+}
+
+huffman_table *preset_delta_table(const huffman_preset *preset, uint8_t *entries, uint32_t n_delta)
+{
+    /* Make a table of the preset's tokens and the n_delta (at least 1)
+    delta tokens at entries, with the escape entry replaced by the first
+    of them. Returns NULL if a delta code would be longer than 32 bits. */
+    const huffman_table *base = preset->table;
+    huffman_table *table;
+    uint32_t n = base->n_entries - 1 + n_delta, i, j = 0, suffix;
+    uint32_t escape_code = base->codes[preset->escape];
+    uint8_t escape_bits = base->n_bits[preset->escape], suffix_bits, len;
+    uint8_t *p = entries;
+
+    delta_suffix(n_delta-1, n_delta, &suffix_bits); /* the longest */
+    if(escape_bits + suffix_bits > 32) {
+        printf("Error: too many delta tokens for preset %u\n", preset->id);
+        return NULL;
+    }
+    table = new_huffman_table(n, base->token_offsets[base->n_entries] - (TOKEN_LENGTH(base, preset->escape)+1) +
+                                 delta_pool_size(entries, n_delta));
+    for(i=0; i<n; i++) {
+        if(i < base->n_entries && i != preset->escape) {
+            len = TOKEN_LENGTH(base, i);
+            memcpy(TOKEN_STRING(table, i), TOKEN_STRING(base, i), len+1);
+            table->n_bits[i] = base->n_bits[i];
+            table->codes[i] = base->codes[i];
+        }
+        else {
+            /* The next delta token: the escape slot comes before the appended ones */
+            len = readbuf_u8(&p);
+            readbuf_bytes(&p, (uint8_t*)TOKEN_STRING(table, i), len);
+            TOKEN_STRING(table, i)[len] = '\0';
+            suffix = delta_suffix(j++, n_delta, &suffix_bits);
+            table->n_bits[i] = escape_bits + suffix_bits;
+            table->codes[i] = suffix_bits ? (escape_code << suffix_bits) | suffix : escape_code;
+        }
+        table->token_offsets[i+1] = table->token_offsets[i] + len + 1;
+    }
+    return table;
+}
+
+huffman_buffer *read_preset_huffman(uint8_t *buf)
+{
+    /* Read an 'HUFP' file, as read_huffman. With no delta the buffer
+    shares the preset's table; otherwise it has a table of its own.
+    Returns NULL if the preset is unknown. */
+    uint8_t *p = buf+4;
+    uint32_t id, n_delta;
+    const huffman_preset *preset;
+    huffman_table *table;
+    huffman_buffer *buffer;
+
+    if(memcmp(buf, PRESET_MAGIC, 4)) {
+        printf("Error: not an HUFP file\n");
+        return NULL;
+    }
+    id = readbuf_u32(&p);
+    n_delta = readbuf_u32(&p);
+    preset = find_preset(id);
+    if(preset==NULL) {
+        printf("Error: unknown preset %u\n", id);
+        return NULL;
+    }
+    if(n_delta==0)
+        table = (huffman_table*)preset->table;
+    else {
+        table = preset_delta_table(preset, p, n_delta);
+        if(table==NULL)
+            return NULL;
+        p += delta_pool_size(p, n_delta);
+    }
+    buffer = malloc(sizeof(huffman_buffer));
+    buffer->n_bits = readbuf_u32(&p);
+    buffer->table = table;
+    buffer->buf = (char*)p;
+    buffer->pos = 0;
+    buffer->stats = NULL;
+    return buffer;
+}
@@ -0,0 +1,53 @@
+#ifndef HUFFMAN_PRESET_H
+#define HUFFMAN_PRESET_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+/*
+    Preset tables: huffman tables compiled into the decoder, so that a
+    small book can name one instead of carrying its own.
+
+    Preset file format:
+    -- 'HUFP' [preset_id:u32] [n_delta:u32] [delta tokens] [n_bits_compressed_data:u32] [compressed data]
+    Delta tokens:
+        [N byte len of string:u8] [string:u8*N]
+    Sections follow the data as in an HUFM file.
+
+    Every preset has an escape entry, PRESET_ESCAPE, which files with no
+    delta never use. Delta token j of n is coded as the escape code
+    followed by j in truncated binary: with k = floor(log2 n) and
+    u = 2^(k+1) - n, the first u tokens take k more bits (the value j),
+    the rest k+1 (the value j+u). This splits the escape's code exactly,
+    so the codes stay complete. The escape's entry is reused for delta
+    token 0 and the others are appended, so a preset token has the same
+    symbol number with or without a delta.
+
+    With no delta, loading is a pointer to the compiled-in table, its
+    lookup table and its pre-parsed ops: nothing is read or built.
+
+    Preset ids are versions: once a preset has shipped its table must
+    never change, as files name it only by id. A table trained afresh
+    (huf_preset --train) is added under a new id.
+*/
+
+#define PRESET_MAGIC "HUFP"
+#define PRESET_ESCAPE "*preset"
+
+typedef struct huffman_preset
+{
+    uint32_t id;
+    const char *name;
+    const huffman_table *table; /* validated, with lut and ops */
+    uint32_t escape; /* the symbol of PRESET_ESCAPE */
+} huffman_preset;
+
+const huffman_preset *find_preset(uint32_t id);
+const huffman_preset *preset_at(uint32_t i);
+uint32_t delta_suffix(uint32_t j, uint32_t n_delta, uint8_t *n_bits);
+uint32_t delta_pool_size(uint8_t *entries, uint32_t n_delta);
+int check_delta_tokens(uint8_t *entries, uint8_t *end, uint32_t n_delta);
+huffman_table *preset_delta_table(const huffman_preset *preset, uint8_t *entries, uint32_t n_delta);
+huffman_buffer *read_preset_huffman(uint8_t *buf);
+
+#endif
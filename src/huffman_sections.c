@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_sections.h"
+#include "binary.h"
+
+uint8_t *data_end(huffman_buffer *buffer)
+{
+    /* Return a pointer to the first byte after the compressed data,
+    which is zero-padded to a whole byte */
+    return (uint8_t*)buffer->buf + ((buffer->n_bits+7)>>3);
+}
+
+uint8_t *find_section(huffman_buffer *buffer, uint8_t *file_end, char *tag, uint32_t *length)
+{
+    /* Find the section with the given tag in the bytes between the end of
+    the compressed data and file_end. Returns a pointer to its payload and
+    sets *length, or returns NULL if there is no such section. */
+    uint8_t *p = data_end(buffer);
+    uint8_t *section_tag;
+    uint32_t section_length;
+    while(p+8 <= file_end) {
+        section_tag = p;
+        p += 4;
+        section_length = readbuf_u32(&p);
+        if(section_length > (uint32_t)(file_end-p)) {
+            printf("Error: truncated section\n");
+            return NULL;
+        }
+        if(!memcmp(section_tag, tag, 4)) {
+            *length = section_length;
+            return p;
+        }
+        p += section_length;
+    }
+    return NULL;
+}
+
+void write_section(FILE *f, char *tag, uint8_t *payload, uint32_t length)
+{
+    /* Append one section to f */
+    write_bytes(f, tag, 4);
+    write_u32(f, length);
+    write_bytes(f, payload, length);
+}
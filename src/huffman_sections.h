@@ -0,0 +1,19 @@
+#ifndef HUFFMAN_SECTIONS_H
+#define HUFFMAN_SECTIONS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huffman.h"
+
+/*
+    Optional sections may follow the compressed data, each as:
+        [tag:u8*4] [length:u32] [payload:u8*length]
+    Readers that don't know about sections simply never look past the data;
+    readers that do skip any tag they don't recognise.
+*/
+
+uint8_t *data_end(huffman_buffer *buffer);
+uint8_t *find_section(huffman_buffer *buffer, uint8_t *file_end, char *tag, uint32_t *length);
+void write_section(FILE *f, char *tag, uint8_t *payload, uint32_t length);
+
+#endif
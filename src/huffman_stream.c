@@ -0,0 +1,444 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __unix__
+#include <unistd.h>
+#endif
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_stream.h"
+#include "huffman_preset.h"
+#include "tune_catalogue.h"
+#include "binary.h"
+
+/* Streaming decoder: the compressed data is never held in memory
+as a whole, only a ring_size window of it. Sequential reads and forward
+seeks are supported; backward seeks only within the current window. */
+
+static int read_exact(huffman_stream *stream, uint8_t *dest, uint32_t n_bytes)
+{
+    /* Read exactly n_bytes from the source, returning 0 on a short read */
+    uint32_t got;
+    while(n_bytes>0) {
+        got = stream->read(stream->source, dest, n_bytes);
+        if(got==0)
+            return 0;
+        dest += got;
+        n_bytes -= got;
+    }
+    return 1;
+}
+
+static uint8_t *read_stream_preset(huffman_stream *stream, uint8_t *header)
+{
+    /* Read the rest of an 'HUFP' header (see huffman_preset.h), whose
+    first 8 bytes are in header, as read_stream_header */
+    uint8_t *p = header+4, *delta = NULL;
+    uint32_t i, n_delta, size = 0;
+    const huffman_preset *preset = find_preset(readbuf_u32(&p));
+
+    if(preset==NULL) {
+        printf("Error: unknown preset\n");
+        return NULL;
+    }
+    if(!read_exact(stream, header, 4)) {
+        printf("Error: could not read header\n");
+        return NULL;
+    }
+    p = header;
+    n_delta = readbuf_u32(&p);
+    free_huffman_table(stream->table);
+    stream->table = (huffman_table*)preset->table;
+    if(n_delta > 0) {
+        /* Gather the delta tokens, then merge them as a loaded file does */
+        for(i=0; i<n_delta; i++) {
+            delta = realloc(delta, size+256);
+            if(!read_exact(stream, delta+size, 1) || (delta[size]>0 && !read_exact(stream, delta+size+1, delta[size]))) {
+                printf("Error: truncated delta tokens\n");
+                free(delta);
+                return NULL;
+            }
+            size += 1 + delta[size];
+        }
+        if(!check_delta_tokens(delta, delta+size, n_delta)) {
+            free(delta);
+            return NULL;
+        }
+        stream->table = preset_delta_table(preset, delta, n_delta);
+        free(delta);
+        if(stream->table==NULL) {
+            stream->table = new_huffman_table(0, 0);
+            return NULL;
+        }
+    }
+    if(!read_exact(stream, header, 4)) {
+        printf("Error: could not read data length\n");
+        return NULL;
+    }
+    p = header;
+    stream->n_bits = readbuf_u32(&p);
+    return p;
+}
+
+static uint8_t *read_stream_header(huffman_stream *stream)
+{
+    /* Read the magic number and huffman table from the source,
+    leaving the source positioned at the start of the compressed data.
+    Returns NULL on failure. */
+    uint8_t header[8];
+    uint8_t entry_buf[2+255+32]; /* len, n_bits, string, code */
+    uint8_t *p;
+    uint32_t i;
+    huffman_table *table = stream->table;
+
+    if(!read_exact(stream, header, 8)) {
+        printf("Error: could not read header\n");
+        return NULL;
+    }
+    if(!memcmp(header, PRESET_MAGIC, 4))
+        return read_stream_preset(stream, header);
+    if (header[0] != 'H' || header[1] != 'U' || header[2] != 'F' || header[3] != 'M') {
+        printf("Error: not an HUFM file\n");
+        return NULL;
+    }
+    p = header+4;
+    /* The pool grows as the entries arrive */
+    free_huffman_table(table);
+    table = stream->table = new_huffman_table(readbuf_u32(&p), 0);
+    for(i=0; i<table->n_entries; i++) {
+        /* Read the fixed part, then the string and code, and decode the
+        whole entry with read_one_entry */
+        if(!read_exact(stream, entry_buf, 2) ||
+           !read_exact(stream, entry_buf+2, entry_buf[0]+((entry_buf[1]+7)>>3))) {
+            printf("Error: truncated huffman table\n");
+            table->n_entries = i;
+            return NULL;
+        }
+        if((uint64_t)table->token_offsets[i] + entry_buf[0] + 1 > MAX_STRING_POOL) {
+            printf("Error: token strings too long for this build\n");
+            table->n_entries = i;
+            return NULL;
+        }
+        table->strings = realloc(table->strings, table->token_offsets[i] + entry_buf[0] + 1);
+        read_one_entry(entry_buf, table, i);
+    }
+    if(!read_exact(stream, header, 4)) {
+        printf("Error: could not read data length\n");
+        return NULL;
+    }
+    p = header;
+    stream->n_bits = readbuf_u32(&p);
+    return p;
+}
+
+huffman_stream *open_huffman_stream(stream_read_type read, stream_skip_type skip, void *source, uint8_t *ring, uint32_t ring_size)
+{
+    /* Open a huffman stream reading from source.
+    If ring is NULL, a ring of ring_size bytes is allocated.
+    The ring must be at least 8 bytes (one maximum length code, unaligned).
+    */
+    huffman_stream *stream;
+    if(ring_size < 8) {
+        printf("Error: stream buffer must be at least 8 bytes\n");
+        return NULL;
+    }
+    stream = malloc(sizeof(huffman_stream));
+    stream->table = new_huffman_table(0, 0);
+    stream->read = read;
+    stream->skip = skip;
+    stream->source = source;
+    stream->owns_ring = (ring==NULL);
+    stream->ring = ring ? ring : malloc(ring_size);
+    stream->ring_size = ring_size;
+    stream->ring_start = 0;
+    stream->ring_fill = 0;
+    stream->pos = 0;
+    stream->n_bits = 0;
+    stream->stats = NULL;
+    if(read_stream_header(stream)==NULL) {
+        close_huffman_stream(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+huffman_stream *open_huffman_file_stream(FILE *f, uint32_t ring_size)
+{
+    /* Open a huffman stream on an open FILE, with an allocated ring */
+    return open_huffman_stream(file_stream_read, file_stream_skip, f, NULL, ring_size);
+}
+
+void close_huffman_stream(huffman_stream *stream)
+{
+    /* Free the stream, its table, and the ring if we allocated it.
+    The source is not closed. */
+    free_huffman_table(stream->table);
+    if(stream->owns_ring)
+        free(stream->ring);
+    free(stream);
+}
+
+static int fill_ring(huffman_stream *stream, uint32_t need_byte, uint32_t keep_byte)
+{
+    /* Make sure byte need_byte is in the ring, discarding any
+    bytes before keep_byte to make space. Returns 1 on success, -1 at
+    the end of the input, and 0 on any other failure (reported here). */
+    uint32_t drop, w, space, got;
+    while(need_byte >= stream->ring_start + stream->ring_fill) {
+        /* Drop bytes we no longer need */
+        if(keep_byte > stream->ring_start) {
+            drop = keep_byte - stream->ring_start;
+            if(drop > stream->ring_fill)
+                drop = stream->ring_fill;
+            stream->ring_start += drop;
+            stream->ring_fill -= drop;
+            /* Skip straight over data that was never read; if the
+            source can't skip, it is read and discarded below instead */
+            if(stream->ring_fill==0 && keep_byte > stream->ring_start && stream->skip) {
+                if(stream->skip(stream->source, keep_byte - stream->ring_start))
+                    stream->ring_start = keep_byte;
+            }
+        }
+        if(stream->ring_fill == stream->ring_size) {
+            printf("Error: stream buffer too small\n");
+            return 0;
+        }
+        /* Read as much as will fit contiguously */
+        w = (stream->ring_start + stream->ring_fill) % stream->ring_size;
+        space = stream->ring_size - stream->ring_fill;
+        if(space > stream->ring_size - w)
+            space = stream->ring_size - w;
+        got = stream->read(stream->source, stream->ring + w, space);
+        if(got==0)
+            return -1;
+        stream->ring_fill += got;
+    }
+    return 1;
+}
+
+uint32_t stream_read_symbol(huffman_stream *stream)
+{
+    /* Read one huffman symbol from the stream, as read_symbol */
+    uint32_t init_pos = stream->pos;
+    uint32_t keep_byte = init_pos>>3;
+    uint32_t code = 0;
+    uint32_t byte, i;
+    int filled;
+    uint8_t b;
+    while(1)
+    {
+        if(stream->pos >= stream->n_bits) {
+            stream->pos = init_pos;
+            printf("Error: buffer overrun\n");
+            return INVALID_CODE;
+        }
+        byte = stream->pos>>3;
+        filled = byte < stream->ring_start ? 0 : fill_ring(stream, byte, keep_byte);
+        if(filled <= 0) {
+            if(filled < 0)
+                printf("Error: unexpected end of stream\n");
+            stream->pos = init_pos;
+            return INVALID_CODE;
+        }
+        b = (stream->ring[byte % stream->ring_size] >> (stream->pos&7)) & 1;
+        code = (code<<1) | b;
+        (stream->pos)++;
+        i = match_code(stream->table, code, stream->pos-init_pos);
+        STAT_ADD(stream->stats, table_probes, i!=INVALID_CODE ? i+1 : stream->table->n_entries);
+        if(i!=INVALID_CODE) {
+            STAT_ADD(stream->stats, symbols, 1);
+            STAT_ADD(stream->stats, bits_consumed, stream->pos-init_pos);
+            STAT_ADD(stream->stats, symbols_by_length[stream->pos-init_pos], 1);
+            return i;
+        }
+        /* Codes are at most 32 bits long */
+        if(stream->pos-init_pos >= 32) {
+            printf("Error: no matching code found\n");
+            return INVALID_CODE;
+        }
+    }
+}
+
+uint32_t stream_peek_symbol(huffman_stream *stream)
+{
+    /* Peek at the next symbol, without advancing pos.
+    The symbol's bytes stay in the ring, so this is always safe. */
+    uint32_t init_pos = stream->pos;
+    uint32_t symbol = stream_read_symbol(stream);
+    stream->pos = init_pos;
+    return symbol;
+}
+
+int stream_seek(huffman_stream *stream, uint32_t pos)
+{
+    /* Seek to bit pos. Data before the current window cannot be
+    recovered, so backward seeks outside it fail and return 0. */
+    if((pos>>3) < stream->ring_start) {
+        printf("Error: cannot seek backwards in stream\n");
+        return 0;
+    }
+    if(pos > stream->n_bits) {
+        printf("Error: seek beyond end of stream\n");
+        return 0;
+    }
+    stream->pos = pos;
+    return 1;
+}
+
+void stream_seek_forward_one_tune(huffman_stream *stream)
+{
+    /* Seek forward one tune in the stream */
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, stream->table);
+    uint32_t symbol;
+    do {
+        symbol = stream_read_symbol(stream);
+    } while(symbol!=nl && symbol!=INVALID_CODE);
+}
+
+int stream_seek_to_tune(uint32_t ix, uint32_t *tune_index, huffman_stream *stream)
+{
+    /* Seek to the start of the tune at index ix, which must not be
+    before the current window. Returns 0 on failure. */
+    if(ix>=tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return 0;
+    }
+    return stream_seek(stream, tune_index[ix+1]);
+}
+
+void stream_parse_tune_context(huffman_stream *stream, tune_context *ctx)
+{
+    /* Parse the tune at the current position with a caller-supplied
+    context (which is reset first), as parse_tune_context */
+    uint32_t symbol;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, stream->table);
+    reset_context(ctx);
+
+    EVENT(ctx, EVENT_TUNE_START);
+    while((symbol = stream_read_symbol(stream))!=nl) {
+        if(symbol==INVALID_CODE) {
+            printf("Error: invalid code\n");
+            break;
+        }
+        decode_symbol(ctx, stream->table, symbol);
+    }
+    EVENT(ctx, EVENT_TUNE_END);
+}
+
+void stream_parse_tune(huffman_stream *stream, event_callback_type callback)
+{
+    /* Parse the tune at the current position, as parse_tune */
+    tune_context *ctx = new_context();
+    if(callback!=NULL)
+        ctx->event_callback = callback;
+    ctx->stats = stream->stats;
+    stream_parse_tune_context(stream, ctx);
+    free_context(ctx);
+}
+
+uint32_t *stream_create_tune_index(huffman_stream *stream)
+{
+    /* Index the tunes from the current position (the start of the data)
+    in one pass, as create_tune_index, leaving the stream after the last
+    tune. Forward seeks to the offsets need a fresh stream. */
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, stream->table);
+    uint32_t n_tunes = 0, size = 64;
+    uint32_t *index = malloc(sizeof(uint32_t)*size);
+    uint32_t symbol;
+
+    while(stream->pos < stream->n_bits) {
+        symbol = stream_peek_symbol(stream);
+        if(symbol==nl || symbol==INVALID_CODE)
+            break;
+        if(n_tunes+2 > size) {
+            size *= 2;
+            index = realloc(index, sizeof(uint32_t)*size);
+        }
+        index[++n_tunes] = stream->pos;
+        stream_seek_forward_one_tune(stream);
+    }
+    index[0] = n_tunes;
+    return index;
+}
+
+static int stream_read_bytes(huffman_stream *stream, uint32_t byte, uint8_t *dest, uint32_t n_bytes)
+{
+    /* Copy n_bytes from byte onwards (counted from the start of the
+    data, and not before the window) to dest, as fill_ring */
+    int filled;
+    uint32_t i;
+    if(byte < stream->ring_start)
+        return 0;
+    for(i=0; i<n_bytes; i++) {
+        filled = fill_ring(stream, byte+i, byte+i);
+        if(filled <= 0)
+            return filled;
+        dest[i] = stream->ring[(byte+i) % stream->ring_size];
+    }
+    return 1;
+}
+
+uint32_t *stream_load_tune_index(huffman_stream *stream)
+{
+    /* Read on past the data to the tune index section and return a copy
+    of it, checked as load_tune_index does. Returns NULL if there is no
+    index section or it does not fit the data. Sections come after the
+    data, so the stream must be reopened to decode tunes afterwards. */
+    uint8_t header[8], *p;
+    uint32_t byte = (stream->n_bits+7)>>3, length, n, i;
+    uint32_t *index;
+
+    while(stream_read_bytes(stream, byte, header, 8) > 0) {
+        p = header+4;
+        length = readbuf_u32(&p);
+        if((uint64_t)byte + 8 + length > 0xFFFFFFFF)
+            break;
+        byte += 8;
+        if(!memcmp(header, TUNE_INDEX_TAG, 4)) {
+            n = length/4;
+            index = malloc(sizeof(uint32_t)*(n ? n : 1));
+            for(i=0; i<n; i++) {
+                if(stream_read_bytes(stream, byte+4*i, header, 4) <= 0)
+                    break;
+                p = header;
+                index[i] = readbuf_u32(&p);
+            }
+            if(i<n || length%4 || !check_tune_index(index, n, stream->n_bits)) {
+                printf("Error: tune index section does not match the data\n");
+                free(index);
+                return NULL;
+            }
+            return index;
+        }
+        byte += length;
+    }
+    return NULL;
+}
+
+uint32_t file_stream_read(void *source, uint8_t *dest, uint32_t n_bytes)
+{
+    /* Read callback for a FILE* source */
+    return fread(dest, 1, n_bytes, (FILE*)source);
+}
+
+int file_stream_skip(void *source, uint32_t n_bytes)
+{
+    /* Skip callback for a FILE* source; fails on pipes */
+    return fseek((FILE*)source, n_bytes, SEEK_CUR)==0;
+}
+
+#ifdef __unix__
+uint32_t fd_stream_read(void *source, uint8_t *dest, uint32_t n_bytes)
+{
+    /* Read callback for a file descriptor source; source points to the int fd */
+    ssize_t got = read(*(int*)source, dest, n_bytes);
+    return got>0 ? (uint32_t)got : 0;
+}
+
+int fd_stream_skip(void *source, uint32_t n_bytes)
+{
+    /* Skip callback for a file descriptor source; fails on pipes */
+    return lseek(*(int*)source, n_bytes, SEEK_CUR) >= 0;
+}
+#endif
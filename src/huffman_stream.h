@@ -0,0 +1,56 @@
+#ifndef HUFFMAN_STREAM_H
+#define HUFFMAN_STREAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+/* Default size of the ring buffer, in bytes */
+#define DEFAULT_STREAM_BUFFER 512
+
+/* Read up to n_bytes into dest; return the number of bytes read (0 at end of input) */
+typedef uint32_t(*stream_read_type)(void *source, uint8_t *dest, uint32_t n_bytes);
+/* Optionally skip n_bytes of input without reading them; return 1 on success */
+typedef int(*stream_skip_type)(void *source, uint32_t n_bytes);
+
+/* A huffman bitstream read through a small fixed-size ring buffer.
+   Only the table is held in memory; the compressed data is pulled
+   in from the read callback as it is decoded. */
+typedef struct huffman_stream
+{
+    huffman_table *table;
+    uint32_t pos; /* current bit index into the compressed data */
+    uint32_t n_bits;
+    stream_read_type read;
+    stream_skip_type skip; /* may be NULL, in which case skipped data is read and discarded */
+    void *source; /* passed to read and skip */
+    uint8_t *ring;
+    uint32_t ring_size; /* size of ring in bytes */
+    uint32_t ring_start; /* byte index in the compressed data of the oldest byte held */
+    uint32_t ring_fill; /* number of valid bytes held */
+    uint8_t owns_ring; /* 1 if ring was allocated by open_huffman_stream */
+    huf_stats *stats; /* NULL, or counters to update when built with HUF_STATS */
+} huffman_stream;
+
+huffman_stream *open_huffman_stream(stream_read_type read, stream_skip_type skip, void *source, uint8_t *ring, uint32_t ring_size);
+huffman_stream *open_huffman_file_stream(FILE *f, uint32_t ring_size);
+void close_huffman_stream(huffman_stream *stream);
+uint32_t stream_read_symbol(huffman_stream *stream);
+uint32_t stream_peek_symbol(huffman_stream *stream);
+int stream_seek(huffman_stream *stream, uint32_t pos);
+void stream_seek_forward_one_tune(huffman_stream *stream);
+int stream_seek_to_tune(uint32_t ix, uint32_t *tune_index, huffman_stream *stream);
+void stream_parse_tune_context(huffman_stream *stream, tune_context *ctx);
+void stream_parse_tune(huffman_stream *stream, event_callback_type callback);
+uint32_t *stream_create_tune_index(huffman_stream *stream);
+uint32_t *stream_load_tune_index(huffman_stream *stream);
+
+uint32_t file_stream_read(void *source, uint8_t *dest, uint32_t n_bytes);
+int file_stream_skip(void *source, uint32_t n_bytes);
+#ifdef __unix__
+uint32_t fd_stream_read(void *source, uint8_t *dest, uint32_t n_bytes);
+int fd_stream_skip(void *source, uint32_t n_bytes);
+#endif
+
+#endif
@@ -28,7 +28,7 @@ uint32_t *create_tune_index(huffman_buffer *buffer)
     
 
     /* Count the number of tunes in the buffer */
-    while(peek_symbol(buffer)!=nl) {
+    while(peek_symbol(buffer)!=nl && buffer->pos < buffer->n_bits) {
         /* Read the next tune */        
         seek_forward_one_tune(buffer);        
         n_tunes++;
@@ -42,7 +42,7 @@ uint32_t *create_tune_index(huffman_buffer *buffer)
     /* Reset the buffer */
     reset_buffer(buffer);
     
-    while(peek_symbol(buffer)!=nl) {
+    while(peek_symbol(buffer)!=nl && buffer->pos < buffer->n_bits) {
         /* Read the next tune */
         *p++ = buffer->pos;
         seek_forward_one_tune(buffer);
@@ -52,12 +52,12 @@ uint32_t *create_tune_index(huffman_buffer *buffer)
 
 void seek_forward_one_tune(huffman_buffer *buffer)
 {
-    /* Seek forward one tune in the buffer */
+    /* Seek forward one tune in the buffer, stopping at the end of the data */
     uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, buffer->table); 
-    while(peek_symbol(buffer)!=nl) {
-        read_symbol(buffer);
-    }
-    read_symbol(buffer);
+    uint32_t symbol;
+    do {
+        symbol = read_symbol(buffer);
+    } while(symbol!=nl && symbol!=INVALID_CODE);
 }
 
 void seek_to_tune(uint32_t ix, uint32_t *tune_index, huffman_buffer *buffer)
@@ -101,33 +101,57 @@ void debug_callback(tune_context *ctx, uint32_t event_code)
     }
 }
 
-tune_context *new_context()
+void init_context(tune_context *context, tune_metadata *meta, parser_context *parser)
 {
-    /* Create a new tune context */
-    tune_context *context = malloc(sizeof(tune_context));
-    context->meta = malloc(sizeof(tune_metadata));
-    context->parser = malloc(sizeof(parser_context));
-    context->event_callback = debug_callback;
+    /* Set up a context in caller-supplied (e.g. static) storage, without
+    allocating. There is no chord_type, which nothing uses yet. */
+    context->meta = meta;
+    context->parser = parser;
+    context->event_callback = NULL;
     context->callback_context = NULL;
-    /* Allocate space for the chord type and full chord name */
-    context->meta->chord_type = malloc(sizeof(chord_type));    
+    context->stats = NULL;
+    context->meta->chord_type = NULL;
     reset_context(context);
-    return context;
+}
+
+/* A context and the parts it points to, in one allocation */
+typedef struct context_block
+{
+    tune_context context; /* first, so the block can be freed through it */
+    tune_metadata meta;
+    parser_context parser;
+} context_block;
+
+tune_context *new_context()
+{
+    /* Create a new tune context */
+    context_block *block = malloc(sizeof(context_block));
+    init_context(&block->context, &block->meta, &block->parser);
+    block->context.event_callback = debug_callback;
+    return &block->context;
 }
 
 void free_context(tune_context *context)
 {
-    /* Free the memory associated with a tune context */    
-    free(context->meta->chord_type);
-    free(context->meta);
-    free(context->parser);
+    /* Free a context made by new_context */    
     free(context);
 }
 
+static void set_field(char *field, const char *text, uint32_t size)
+{
+    /* Copy text into a field of size bytes, truncating it if need be */
+    uint32_t len = strlen(text);
+    if(len >= size)
+        len = size-1;
+    memcpy(field, text, len);
+    field[len] = '\0';
+}
+
 /* Reset the context to a new, blank tune, at the start */
 void reset_context(tune_context *context)
 {    
-    strcpy(context->meta->title, "Untitled");
+    set_field(context->meta->title, "Untitled", MAX_TITLE);
+    set_field(context->meta->rhythm, "", MAX_RHYTHM);
     strcpy(context->meta->key, "cmaj");
     strcpy(context->meta->chord, "");
     context->meta->meter_denominator = 4;
@@ -135,6 +159,8 @@ void reset_context(tune_context *context)
     context->meta->bar_duration = 0;
     context->parser->token_mode = NORMAL_TOKENS;
     context->parser->token_string = "";
+    context->parser->token_string_len = 0;
+    context->parser->token_string_max = 0;
     
     context->current_duration = 1000000;
     context->current_note = BASE_NOTE;
@@ -145,6 +171,7 @@ void reset_context(tune_context *context)
     context->note_start_time = 0;
     context->note_end_time = 0;
     context->note_on = 0;
+    context->has_title = 0;
 }
 
 /* Update the context to trigger notes */
@@ -165,48 +192,161 @@ void trigger_note(tune_context *context, int rest)
     {        
         EVENT(context, EVENT_REST);
     }
+    /* The next note starts when this one ends */
+    context->time = context->note_end_time;
 }
 
 /* Take a huffman token and append it to the current target, building
 up a string. */
-void string_token(tune_context *context, char *target)
+void string_token(tune_context *context, char *target, uint32_t max_len)
 {
     context->parser->token_mode = STRING_TOKENS;
     *target = '\0';
     context->parser->token_string = target;     
+    context->parser->token_string_len = 0;
+    context->parser->token_string_max = max_len;
 }
 
 
-void parse_tune(huffman_buffer *h_buffer, event_callback_type callback)
+void scan_tune_header(huffman_buffer *h_buffer, tune_context *ctx)
 {
+    /* Read only the metadata at the start of the tune at the current
+    position (title, rhythm, key, meter, bar duration) into ctx->meta,
+    stopping at the first note or rest. No events are fired. */
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, h_buffer->table);
+    event_callback_type callback = ctx->event_callback;
+    uint32_t symbol;
     char *token;
+    reset_context(ctx);
+    ctx->event_callback = NULL;
+    while((symbol = read_symbol(h_buffer))!=nl && symbol!=INVALID_CODE) {
+        token = TOKEN_STRING(h_buffer->table, symbol);
+        if(ctx->parser->token_mode==NORMAL_TOKENS && strchr("+-~", token[0]))
+            break;
+        decode_symbol(ctx, h_buffer->table, symbol);
+    }
+    ctx->event_callback = callback;
+}
+
+void parse_tune_context(huffman_buffer *h_buffer, tune_context *ctx)
+{
+    /* Parse the tune at the current position with a caller-supplied
+    context (which is reset first); nothing is allocated */
     uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, h_buffer->table);
-    tune_context *ctx = new_context();
-    if(callback!=NULL)
-        ctx->event_callback = callback;    
-    else 
-        ctx->event_callback = debug_callback;
+    uint32_t symbol;
+    reset_context(ctx);
 
     EVENT(ctx, EVENT_TUNE_START);
-    while(peek_symbol(h_buffer)!=nl) {
-        uint32_t symbol = read_symbol(h_buffer);
+    while((symbol = read_symbol(h_buffer))!=nl) {
         if(symbol==INVALID_CODE) {
             printf("Error: invalid code\n");
             break;
         }
-        token = h_buffer->table->entries[symbol]->token_string;
-        decode_token(ctx, token);
+        decode_symbol(ctx, h_buffer->table, symbol);
     }
     EVENT(ctx, EVENT_TUNE_END);    
 }
 
-void decode_token(tune_context *context, char *token)
+void begin_tune(tune_context *ctx)
+{
+    /* Start stepping through a tune with step_tune:
+    reset the context and fire TUNE_START */
+    reset_context(ctx);
+    EVENT(ctx, EVENT_TUNE_START);
+}
+
+int step_tune(huffman_buffer *h_buffer, tune_context *ctx)
+{
+    /* Decode one symbol of a tune started with begin_tune, firing any
+    event it causes. Fires TUNE_END and returns 0 at the end of the tune,
+    otherwise returns 1. This lets a player decode only as far as
+    the next note, instead of the whole tune at once. */
+    uint32_t symbol = read_symbol(h_buffer);
+    if(symbol==INVALID_CODE || !strcmp(TOKEN_STRING(h_buffer->table, symbol), TUNE_TERMINATOR)) {
+        if(symbol==INVALID_CODE)
+            printf("Error: invalid code\n");
+        EVENT(ctx, EVENT_TUNE_END);
+        return 0;
+    }
+    decode_symbol(ctx, h_buffer->table, symbol);
+    return 1;
+}
+
+void parse_tune(huffman_buffer *h_buffer, event_callback_type callback)
+{
+    tune_context *ctx = new_context();
+    if(callback!=NULL)
+        ctx->event_callback = callback;    
+    else 
+        ctx->event_callback = debug_callback;
+    ctx->stats = h_buffer->stats;
+    parse_tune_context(h_buffer, ctx);
+    free_context(ctx);
+}
+
+static int32_t next_operand(char *s, const char *seps)
 {
+    /* atoi of the next strtok field, or 0 if there is none */
+    char *field = strtok(s, seps);
+    return field ? atoi(field) : 0;
+}
 
-    char leading = token[0];
+void parse_op(char *token, huffman_op *op)
+{
+    /* Pre-parse a token's leading character and numeric operands */
     char *p = token+1;
-    char dup[MAX_TOKEN]; /* tokens are never more than MAX_TOKEN long */
-    int num, den;
+    char dup[MAX_TOKEN]; /* validated tokens are shorter; others are truncated */
+    op->op = token[0];
+    op->a = 0;
+    op->b = 0;
+    switch(op->op) {
+        case '^':
+        case '+':
+        case '-':
+            op->a = atoi(p);
+            break;
+        case '%':
+            /* Meter; the encoder writes n\d, but accept n/d too */
+            snprintf(dup, sizeof(dup), "%s", p);
+            op->a = next_operand(dup, METER_SEPARATORS);
+            op->b = next_operand(NULL, METER_SEPARATORS);
+            break;
+        case '/':
+            snprintf(dup, sizeof(dup), "%s", p);
+            op->a = next_operand(dup, DURATION_SEPARATORS);
+            op->b = next_operand(NULL, DURATION_SEPARATORS);
+            /* Only the tokens a stream uses are validated; leave the
+            duration alone rather than divide by zero */
+            if(op->b==0)
+                op->a = op->b = 1;
+            break;
+    }
+}
+
+huffman_op *build_ops(huffman_table *table)
+{
+    /* Pre-parse every token in the table. parse_op bounds what it reads,
+    so the tokens need not have been checked. */
+    huffman_op *ops = malloc(sizeof(huffman_op)*table->n_entries);
+    uint32_t i;
+    for(i=0; i<table->n_entries; i++)
+        parse_op(TOKEN_STRING(table, i), &ops[i]);
+    return ops;
+}
+
+void decode_symbol(tune_context *context, huffman_table *table, uint32_t symbol)
+{
+    /* Decode one symbol, using the pre-parsed op if the table has them */
+    char *token = TOKEN_STRING(table, symbol);
+    if(table->ops && context->parser->token_mode == NORMAL_TOKENS)
+        execute_op(context, &table->ops[symbol], token);
+    else
+        decode_token(context, token);
+}
+
+void decode_token(tune_context *context, char *token)
+{
+    huffman_op op;
 #ifdef DEBUG
     printf("Token `%s`, token mode %d\n", token, context->parser->token_mode);
 #endif 
@@ -216,13 +356,30 @@ void decode_token(tune_context *context, char *token)
         /* end of tokens? */
         if(!strcmp(token,STRING_TERMINATOR))
             context->parser->token_mode = NORMAL_TOKENS;
-        else        
-            strcat(context->parser->token_string, token);                                    
+        else {
+            /* Append at the end we already know, rather than strcat,
+            truncating if the target is full */
+            parser_context *parser = context->parser;
+            size_t len = strlen(token);
+            if(parser->token_string_len + len >= parser->token_string_max)
+                len = parser->token_string_max - parser->token_string_len - 1;
+            memcpy(parser->token_string + parser->token_string_len, token, len);
+            parser->token_string_len += len;
+            parser->token_string[parser->token_string_len] = '\0';
+        }
         return;
     }
 
     /* otherwise we are in NORMAL_TOKENS mode */
-    switch(leading) {
+    parse_op(token, &op);
+    execute_op(context, &op, token);
+}
+
+void execute_op(tune_context *context, huffman_op *op, char *token)
+{
+    /* Interpret one token in NORMAL_TOKENS mode, given its pre-parsed op */
+    char *p = token+1;
+    switch(op->op) {
         /* Metadata fields.
         These tokens update context->meta.
         */
@@ -232,34 +389,33 @@ void decode_token(tune_context *context, char *token)
             until we find an end of string token marker.
             */        
             if(!strcmp(p, "title")) {
-                   string_token(context, context->meta->title);        
+                string_token(context, context->meta->title, MAX_TITLE);
+                context->has_title = 1;
             }
             else if(!strcmp(p, "rhythm")) {
-                string_token(context, context->meta->rhythm);                        
+                string_token(context, context->meta->rhythm, MAX_RHYTHM);                        
             }            
             break;
         case '&':
             /* Key */
-            strcpy(context->meta->key, p);
+            set_field(context->meta->key, p, MAX_KEY);
             EVENT(context, EVENT_KEY);
             break;
         case '#':
             /* Chord */
-            strcpy(context->meta->chord, p);            
+            set_field(context->meta->chord, p, MAX_CHORD);
             EVENT(context, EVENT_CHORD);
             break;
         case '^':
             /* Bar duration */
-            context->meta->bar_duration = atoi(p);
+            context->meta->bar_duration = op->a;
             context->current_duration = context->meta->bar_duration * BASE_DURATION;      
             EVENT(context, EVENT_BAR_DURATION);                
             break;
         case '%':
-            /* Meter */            
-            strcpy(dup, p);
-            context->meta->meter_numerator = atoi(strtok(dup, "/"));
-            context->meta->meter_denominator = atoi(strtok(NULL, "/"));
-            
+            /* Meter */
+            context->meta->meter_numerator = op->a;
+            context->meta->meter_denominator = op->b;
             break;
         case '|':
             /* Bar */
@@ -271,12 +427,12 @@ void decode_token(tune_context *context, char *token)
         /* These indicate that a note should be played */        
         case '+':
             /* Note, increasing pitch */
-            context->current_note += atoi(p);
+            context->current_note += op->a;
             trigger_note(context, 0);
             break;
         case '-':
             /* Note, decreasing pitch */
-            context->current_note -= atoi(p);
+            context->current_note -= op->a;
             trigger_note(context, 0);
             break;
         case '~':
@@ -285,17 +441,14 @@ void decode_token(tune_context *context, char *token)
             break;
         /* Relative change in duration */
         case '/':            
-            strcpy(dup, p);
-            num = atoi(strtok(dup, "/"));
-            den = atoi(strtok(NULL, "/"));                       
-            context->current_duration *= num;
-            context->current_duration /= den;                        
+            context->current_duration *= op->a;
+            context->current_duration /= op->b;                        
             break;
         case '\n':
             EVENT(context, EVENT_TUNE_END);
             break;
         default:
-            printf("Error: unknown token type %c\n", leading);
+            printf("Error: unknown token type %c\n", op->op);
             break;
     }
 }
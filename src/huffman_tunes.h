@@ -3,8 +3,21 @@
 #include <stdint.h>
 #include <stdlib.h> 
 #include "huffman.h"
+#include "huf_stats.h"
 
+#ifdef HUF_STATS
+/* Count every event, and time the callback */
+#define EVENT(context, event_code) do { \
+        STAT_ADD(context->stats, events[event_code], 1); \
+        if(context->event_callback) { \
+            uint64_t event_t0 = STATS_CLOCK(); \
+            context->event_callback(context, event_code); \
+            STAT_ADD(context->stats, callback_cycles, STATS_CLOCK()-event_t0); \
+        } \
+    } while(0)
+#else
 #define EVENT(context, event_code) if(context->event_callback) context->event_callback(context, event_code)
+#endif
 
 #define BASE_NOTE 69 /* A440 */
 
@@ -12,9 +25,31 @@
 #define STRING_TERMINATOR "*"
 #define STRING_TOKENS 1
 #define NORMAL_TOKENS 0
+/* Sizes of the text fields, including the terminator. Define them to
+save RAM; a size of 1 keeps no text (its tokens are decoded and dropped).
+HUF_COMPACT builds keep no title or rhythm by default. */
+#ifndef MAX_TITLE
+#ifdef HUF_COMPACT
+#define MAX_TITLE 1
+#else
 #define MAX_TITLE 256
+#endif
+#endif
+#ifndef MAX_RHYTHM
+#ifdef HUF_COMPACT
+#define MAX_RHYTHM 1
+#else
+#define MAX_RHYTHM 32
+#endif
+#endif
+#define MAX_KEY 5
+#define MAX_CHORD 7
 #define BASE_DURATION 0.25 /* 1/4 bar */
 #define MAX_TOKEN 32
+/* Operand separators: meters are written n\d but n/d is accepted too;
+durations are only ever n/d */
+#define METER_SEPARATORS "/\\"
+#define DURATION_SEPARATORS "/"
 
 #define EVENT_NOTE 1
 #define EVENT_REST 2
@@ -33,11 +68,11 @@ struct chord_type;
 typedef struct tune_metadata
 {
     char title[MAX_TITLE];
-    char rhythm[32];
+    char rhythm[MAX_RHYTHM];
     uint8_t meter_denominator;
     uint8_t meter_numerator;
-    char key[5]; 
-    char chord[7];
+    char key[MAX_KEY]; 
+    char chord[MAX_CHORD];
     struct chord_type *chord_type;   
     uint32_t bar_duration; /* Duration of a bar in microseconds */
 } tune_metadata;
@@ -46,6 +81,8 @@ typedef struct parser_context
 {
     int token_mode; /* Can be STRING_TOKENS or NORMAL_TOKENS */
     char *token_string; /* pointer to a string to write the next string tokens to */        
+    uint32_t token_string_len; /* length of the string written so far */
+    uint32_t token_string_max; /* size of the target, including the terminator */
 } parser_context;
 
 struct tune_context;
@@ -59,9 +96,11 @@ typedef struct tune_context
     parser_context *parser;    
     event_callback_type event_callback;
     void *callback_context; /* Pointer for the callback to store data */
+    huf_stats *stats; /* NULL, or counters to update when built with HUF_STATS */
     uint32_t current_duration; /* Note duration in microseconds */
     uint8_t current_note; /* MIDI note number */    
     uint8_t note_on; /* 1 if a note is currently on, 0 if not */
+    uint8_t has_title; /* 1 once the tune's title token has been read */
     uint32_t bar_count;
     uint32_t bar_start_time; /* the time at the start of the current bar */
     uint32_t bar_end_time; /* the time at the end of the current bar */
@@ -73,12 +112,21 @@ typedef struct tune_context
 void seek_forward_one_tune(huffman_buffer *buffer);
 void reset_context(tune_context *context);
 void trigger_note(tune_context *context, int rest);
-void string_token(tune_context *context, char *target);
+void string_token(tune_context *context, char *target, uint32_t max_len);
+void parse_op(char *token, huffman_op *op);
+huffman_op *build_ops(huffman_table *table);
+void decode_symbol(tune_context *context, huffman_table *table, uint32_t symbol);
 void decode_token(tune_context *context, char *token);
+void execute_op(tune_context *context, huffman_op *op, char *token);
 uint32_t *create_tune_index(huffman_buffer *buffer);
 void seek_to_tune(uint32_t ix, uint32_t *tune_index, huffman_buffer *buffer);
+void init_context(tune_context *context, tune_metadata *meta, parser_context *parser);
 tune_context *new_context();
 void free_context(tune_context *context);
+void scan_tune_header(huffman_buffer *h_buffer, tune_context *ctx);
+void parse_tune_context(huffman_buffer *h_buffer, tune_context *ctx);
+void begin_tune(tune_context *ctx);
+int step_tune(huffman_buffer *h_buffer, tune_context *ctx);
 void parse_tune(huffman_buffer *h_buffer, event_callback_type callback);
 uint32_t midi_to_hz(uint8_t note);
 
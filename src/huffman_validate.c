@@ -0,0 +1,384 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "huffman_validate.h"
+#include "huffman_preset.h"
+#include "binary.h"
+
+/* Validate-once loading: a file that passes validate_huffman can be
+decoded with read_symbol_unchecked and decode_token without any bounds
+checks, as every way they could go wrong has been ruled out here. */
+
+static int check_table(huffman_table *table)
+{
+    /* Check the codes are 1..32 bits long, prefix-free and complete,
+    and that there are few enough of them, short enough, for the lookup
+    table built by build_lut (see MAX_SYMBOLS and MAX_LUT_ENTRIES).
+    Codes are inserted into a binary trie: a code which passes through
+    an existing leaf, or ends on a node already used, overlaps another.
+    Returns 1 if the table is good. */
+    uint32_t *trie; /* two children per node; 0 = empty, LUT_LINK|i = leaf for symbol i */
+    uint32_t n_nodes = 1, node, i;
+    uint64_t kraft = 0;
+    int bit, ok = 1;
+    uint8_t k;
+    uint8_t n_bits;
+    uint32_t code;
+
+    if(table->n_entries >= MAX_SYMBOLS) {
+        printf("Error: %u codes, more than a table can hold\n", table->n_entries);
+        return 0;
+    }
+    trie = calloc(2*((size_t)table->n_entries*32+1), sizeof(uint32_t));
+    if(trie==NULL) {
+        printf("Error: out of memory checking the table\n");
+        return 0;
+    }
+    for(i=0; i<table->n_entries && ok; i++) {
+        n_bits = table->n_bits[i];
+        code = table->codes[i];
+        if(n_bits < 1 || n_bits > 32) {
+            printf("Error: code length %d out of range\n", n_bits);
+            ok = 0;
+            break;
+        }
+        if(TOKEN_LENGTH(table, i) == 0) {
+            printf("Error: empty token\n");
+            ok = 0;
+            break;
+        }
+        kraft += (uint64_t)1 << (32-n_bits);
+        node = 0;
+        for(k=0; k<n_bits; k++) {
+            bit = (code >> (n_bits-1-k)) & 1;
+            if(trie[2*node+bit] & LUT_LINK) {
+                ok = 0; /* runs through another code */
+                break;
+            }
+            if(k==n_bits-1) {
+                if(trie[2*node+bit]!=0)
+                    ok = 0; /* another code runs through this one */
+                trie[2*node+bit] = LUT_LINK | i;
+            }
+            else {
+                if(trie[2*node+bit]==0)
+                    trie[2*node+bit] = n_nodes++;
+                node = trie[2*node+bit];
+            }
+        }
+        if(!ok)
+            printf("Error: codes are not prefix-free\n");
+    }
+    free(trie);
+    if(ok && kraft != (uint64_t)1<<32) {
+        printf("Error: codes are not complete\n");
+        ok = 0;
+    }
+    if(ok && lut_size(table) > MAX_LUT_ENTRIES) {
+        printf("Error: codes too long for the lookup table\n");
+        ok = 0;
+    }
+    return ok;
+}
+
+static int has_two_parts(char *p, const char *seps)
+{
+    /* Does p have something either side of one of the separators seps,
+    as parse_op splits meters and durations? */
+    char *sep = strpbrk(p, seps);
+    return sep!=NULL && sep!=p && sep[1]!='\0' && strpbrk(sep+1, seps)!=sep+1;
+}
+
+static int check_token(char *token)
+{
+    /* Check a token interpreted by decode_token in NORMAL_TOKENS mode */
+    char *p = token+1;
+    char *sep;
+    if(strlen(token) >= MAX_TOKEN) {
+        printf("Error: token %s too long\n", token);
+        return 0;
+    }
+    switch(token[0]) {
+        case '&':
+            if(strlen(p) >= MAX_KEY) {
+                printf("Error: key %s too long\n", p);
+                return 0;
+            }
+            break;
+        case '#':
+            if(strlen(p) >= MAX_CHORD) {
+                printf("Error: chord %s too long\n", p);
+                return 0;
+            }
+            break;
+        case '%':
+            if(!has_two_parts(p, METER_SEPARATORS)) {
+                printf("Error: malformed meter %s\n", token);
+                return 0;
+            }
+            break;
+        case '/':
+            /* Durations are split on / alone */
+            sep = strpbrk(p, DURATION_SEPARATORS);
+            if(!has_two_parts(p, DURATION_SEPARATORS) || atoi(sep+1)==0) {
+                printf("Error: malformed duration %s\n", token);
+                return 0;
+            }
+            break;
+    }
+    return 1;
+}
+
+static int check_one_tune(huffman_buffer *buffer, uint32_t nl, uint32_t symbol, uint32_t end_bit)
+{
+    /* Check the tune whose first symbol has just been read is terminated
+    by end_bit, and that every token is well formed in the mode it will
+    be decoded in */
+    int string_mode = 0;
+    char *token;
+    while(symbol!=nl) {
+        token = TOKEN_STRING(buffer->table, symbol);
+        if(string_mode) {
+            if(!strcmp(token, STRING_TERMINATOR))
+                string_mode = 0;
+        }
+        else {
+            if(!check_token(token))
+                return 0;
+            if(token[0]=='*' && (!strcmp(token+1, "title") || !strcmp(token+1, "rhythm")))
+                string_mode = 1;
+        }
+        if(buffer->pos >= end_bit) {
+            printf("Error: unterminated tune\n");
+            return 0;
+        }
+        symbol = read_symbol_unchecked(buffer);
+        if(buffer->pos > end_bit) {
+            printf("Error: unterminated tune\n");
+            return 0;
+        }
+    }
+    if(string_mode) {
+        printf("Error: unterminated text field\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int check_stream(huffman_buffer *buffer)
+{
+    /* Walk every tune, checking each as check_one_tune. The table has
+    already been checked, so the lookup table is safe to use as long as
+    we check pos ourselves. */
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, buffer->table);
+    uint32_t symbol;
+
+    reset_buffer(buffer);
+    while(1) {
+        if(buffer->pos >= buffer->n_bits) {
+            printf("Error: missing end of tunes\n");
+            return 0;
+        }
+        symbol = read_symbol_unchecked(buffer);
+        if(buffer->pos > buffer->n_bits) {
+            printf("Error: truncated code at end of data\n");
+            return 0;
+        }
+        if(symbol==nl) /* an empty tune marks the end */
+            break;
+        if(!check_one_tune(buffer, nl, symbol, buffer->n_bits))
+            return 0;
+    }
+    reset_buffer(buffer);
+    return 1;
+}
+
+static int check_sections(huffman_buffer *buffer, uint8_t *file_end)
+{
+    /* Check every section lies within the file */
+    uint8_t *p = data_end(buffer);
+    uint32_t length;
+    while(p < file_end) {
+        if(file_end-p < 8) {
+            printf("Error: truncated section header\n");
+            return 0;
+        }
+        p += 4;
+        length = readbuf_u32(&p);
+        if(length > (uint32_t)(file_end-p)) {
+            printf("Error: truncated section\n");
+            return 0;
+        }
+        p += length;
+    }
+    return 1;
+}
+
+static int check_layout(uint8_t *buf, uint32_t size)
+{
+    /* Check the header, table and compressed data fit in size bytes,
+    before anything is read out of them */
+    uint8_t *p = buf, *end = buf+size;
+    uint32_t n_entries, i, len, n_bits;
+    uint64_t pool_size = 0;
+    if(size < 12 || buf[0] != 'H' || buf[1] != 'U' || buf[2] != 'F' || buf[3] != 'M') {
+        printf("Error: not an HUFM file\n");
+        return 0;
+    }
+    p += 4;
+    n_entries = readbuf_u32(&p);
+    for(i=0; i<n_entries; i++) {
+        if(end-p < 2) {
+            printf("Error: truncated huffman table\n");
+            return 0;
+        }
+        len = p[0];
+        n_bits = p[1];
+        if((uint32_t)(end-p) < 2 + len + ((n_bits+7)>>3)) {
+            printf("Error: truncated huffman table\n");
+            return 0;
+        }
+        p += 2 + len + ((n_bits+7)>>3);
+        pool_size += len + 1;
+    }
+    if(pool_size > MAX_STRING_POOL) {
+        printf("Error: token strings too long for this build\n");
+        return 0;
+    }
+    if(end-p < 4) {
+        printf("Error: truncated data length\n");
+        return 0;
+    }
+    n_bits = readbuf_u32(&p);
+    if(((uint64_t)n_bits+7)>>3 > (uint64_t)(end-p)) {
+        printf("Error: truncated data\n");
+        return 0;
+    }
+    return 1;
+}
+
+static int check_preset_layout(uint8_t *buf, uint32_t size)
+{
+    /* Check an 'HUFP' file names a preset this build has, and that its
+    delta tokens and compressed data fit in size bytes */
+    uint8_t *p = buf+4, *end = buf+size;
+    uint32_t id, n_delta, n_bits;
+    id = readbuf_u32(&p);
+    n_delta = readbuf_u32(&p);
+    if(find_preset(id)==NULL) {
+        printf("Error: unknown preset %u\n", id);
+        return 0;
+    }
+    if(!check_delta_tokens(p, end, n_delta))
+        return 0;
+    p += delta_pool_size(p, n_delta);
+    if(end-p < 4) {
+        printf("Error: truncated data length\n");
+        return 0;
+    }
+    n_bits = readbuf_u32(&p);
+    if(((uint64_t)n_bits+7)>>3 > (uint64_t)(end-p)) {
+        printf("Error: truncated data\n");
+        return 0;
+    }
+    return 1;
+}
+
+huffman_buffer *open_huffman(uint8_t *buf, uint32_t size)
+{
+    /* Check the header, table and data lie within the file, and the
+    framing of its sections, and read it. The table and tunes are not
+    checked: nothing may be decoded until check_huffman_table passes.
+    Returns NULL if the file does not fit in size bytes. */
+    huffman_buffer *buffer;
+    int preset = size >= 12 && !memcmp(buf, PRESET_MAGIC, 4);
+    if(preset ? !check_preset_layout(buf, size) : !check_layout(buf, size))
+        return NULL;
+    buffer = preset ? read_preset_huffman(buf) : read_huffman(buf);
+    if(buffer==NULL)
+        return NULL;
+    if(!check_sections(buffer, buf+size)) {
+        free_huffman_table(buffer->table);
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+int check_huffman_table(huffman_buffer *buffer)
+{
+    /* Check the table of a buffer from open_huffman, and build its
+    lookup table and pre-parsed tokens. Returns 1 if it is valid. */
+    huffman_table *table = buffer->table;
+    /* A compiled-in preset was checked, and its lookup table and ops
+    built, when it was trained */
+    if(!table->is_static && table->lut==NULL) {
+        if(!check_table(table))
+            return 0;
+        table->lut = build_lut(table);
+        if(table->lut==NULL)
+            return 0;
+    }
+    if(lookup_symbol_index(TUNE_TERMINATOR, table)==INVALID_CODE) {
+        printf("Error: no tune terminator in table\n");
+        return 0;
+    }
+    if(table->ops==NULL)
+        table->ops = build_ops(table);
+    return 1;
+}
+
+int check_huffman_tune(huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix)
+{
+    /* Check tune ix of a buffer whose table has been checked, as
+    load_huffman checks every tune: it must end by the start of the next
+    (or the end of the data), and its tokens be well formed. The
+    buffer's position is left alone. Returns 1 if it is valid. */
+    huffman_buffer cursor = *buffer;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, buffer->table);
+    uint32_t end = ix+1 < tune_index[0] ? tune_index[ix+2] : buffer->n_bits;
+    uint32_t symbol;
+    cursor.pos = tune_index[ix+1];
+    if(cursor.pos >= end)
+        return 0;
+    symbol = read_symbol_unchecked(&cursor);
+    return cursor.pos <= end && check_one_tune(&cursor, nl, symbol, end);
+}
+
+static huffman_buffer *validate(uint8_t *buf, uint32_t size)
+{
+    /* Validate the file, returning a buffer with a lookup table, or NULL */
+    huffman_buffer *buffer = open_huffman(buf, size);
+    if(buffer==NULL)
+        return NULL;
+    if(!check_huffman_table(buffer) || !check_stream(buffer)) {
+        free_huffman_table(buffer->table);
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+int validate_huffman(uint8_t *buf, uint32_t size)
+{
+    /* Return 1 if the size bytes at buf are a valid HUFM or HUFP file */
+    huffman_buffer *buffer = validate(buf, size);
+    if(buffer==NULL)
+        return 0;
+    free_huffman_table(buffer->table);
+    free(buffer);
+    return 1;
+}
+
+huffman_buffer *load_huffman(uint8_t *buf, uint32_t size)
+{
+    /* Validate and read a file, as read_huffman, but with the lookup table
+    built so that read_symbol takes the unchecked fast path, and the
+    tokens pre-parsed.
+    Returns NULL if the file is not valid. */
+    return validate(buf, size);
+}
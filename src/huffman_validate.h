@@ -0,0 +1,38 @@
+#ifndef HUFFMAN_VALIDATE_H
+#define HUFFMAN_VALIDATE_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+/*
+    Checks done once at load, so that decoding can skip them:
+    - the header, table, compressed data and the framing of any sections
+      (tag and length) lie within the file; section contents are left to
+      the loader of each section
+    - every code is 1 to 32 bits long, and the codes are prefix-free and complete,
+      so every bit pattern decodes to exactly one symbol
+    - a preset file names a preset this build has (see huffman_preset.h);
+      a preset's table is compiled in and trusted, but one merged with
+      delta tokens is checked like any other
+    - the table has a tune terminator
+    - every tune in the data is terminated before the end of the data
+    - every token fits the field decode_token copies it to, and
+      durations (n/d) and meters (n/d or n\d) have both parts, split as parse_op
+      splits them, and durations have a non-zero denominator
+
+    load_huffman does all of these at once. A file with checksums (see
+    huffman_crc.h) can be loaded in steps instead, so that one flipped
+    bit costs only the tunes around it: open_huffman checks only the
+    layout and section framing, which is enough to check the header
+    checksum; check_huffman_table then checks the table, and
+    check_huffman_tune each tune as it is first wanted (after its chunks'
+    checksums).
+*/
+
+int validate_huffman(uint8_t *buf, uint32_t size);
+huffman_buffer *load_huffman(uint8_t *buf, uint32_t size);
+huffman_buffer *open_huffman(uint8_t *buf, uint32_t size);
+int check_huffman_table(huffman_buffer *buffer);
+int check_huffman_tune(huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix);
+
+#endif
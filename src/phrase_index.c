@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "phrase_index.h"
+#include "binary.h"
+
+/* Melodic phrase search: an inverted index from interval n-grams to the
+tunes and bars they occur in. The index narrows the search to a few
+candidate tunes, which are then decoded to confirm each match. */
+
+#define MAX_STEP 7 /* duration steps are clamped to +/-MAX_STEP */
+
+/* The notes of one tune, as recorded by note_callback */
+typedef struct note_run
+{
+    uint8_t *pitches;
+    uint32_t *durations;
+    uint32_t *bars;
+    uint32_t n_notes;
+    uint32_t max_notes;
+} note_run;
+
+/* A tune containing an n-gram, while building */
+typedef struct posting
+{
+    uint32_t key;
+    uint32_t tune;
+} posting;
+
+static void note_callback(tune_context *ctx, uint32_t event_code)
+{
+    /* Append each note to the run in callback_context; rests are skipped */
+    note_run *run = (note_run*)ctx->callback_context;
+    if(event_code!=EVENT_NOTE)
+        return;
+    if(run->n_notes==run->max_notes) {
+        run->max_notes = run->max_notes ? 2*run->max_notes : 256;
+        run->pitches = realloc(run->pitches, run->max_notes);
+        run->durations = realloc(run->durations, sizeof(uint32_t)*run->max_notes);
+        run->bars = realloc(run->bars, sizeof(uint32_t)*run->max_notes);
+    }
+    run->pitches[run->n_notes] = ctx->current_note;
+    run->durations[run->n_notes] = ctx->current_duration;
+    run->bars[run->n_notes] = ctx->bar_count;
+    run->n_notes++;
+}
+
+static void decode_notes(huffman_buffer *buffer, uint32_t *tune_index, uint32_t ix, tune_context *ctx, note_run *run)
+{
+    /* Decode the notes of tune ix into run */
+    run->n_notes = 0;
+    buffer->pos = tune_index[ix+1];
+    ctx->event_callback = note_callback;
+    ctx->callback_context = run;
+    parse_tune_context(buffer, ctx);
+}
+
+static int8_t note_interval(note_run *run, uint32_t i)
+{
+    /* Semitones from note i to note i+1 */
+    int d = (int)run->pitches[i+1] - (int)run->pitches[i];
+    return d < -127 ? -127 : (d > 127 ? 127 : d);
+}
+
+static int8_t duration_step(note_run *run, uint32_t i)
+{
+    /* round(log2) of the ratio of the durations of notes i+1 and i */
+    long step;
+    if(run->durations[i]==0 || run->durations[i+1]==0)
+        return 0;
+    step = lround(log2((double)run->durations[i+1]/run->durations[i]));
+    return step < -MAX_STEP ? -MAX_STEP : (step > MAX_STEP ? MAX_STEP : step);
+}
+
+static uint32_t gram_key(int8_t *intervals, int8_t *durations, uint8_t n)
+{
+    /* FNV-1a hash of n intervals, and n duration steps if durations is not NULL */
+    uint32_t h = 2166136261u;
+    uint8_t k;
+    for(k=0; k<n; k++) {
+        h = (h ^ (uint8_t)intervals[k]) * 16777619u;
+        if(durations)
+            h = (h ^ (uint8_t)durations[k]) * 16777619u;
+    }
+    return h;
+}
+
+static int compare_postings(const void *a, const void *b)
+{
+    const posting *x = a, *y = b;
+    if(x->key!=y->key)
+        return x->key < y->key ? -1 : 1;
+    return x->tune < y->tune ? -1 : x->tune > y->tune;
+}
+
+static void write_varint(uint8_t **p, uint32_t value)
+{
+    while(value >= 0x80) {
+        *(*p)++ = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    *(*p)++ = value;
+}
+
+static uint32_t varint_size(uint32_t value)
+{
+    /* Bytes write_varint takes for value */
+    uint32_t n = 1;
+    while(value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static uint32_t bucket_base(uint32_t bucket, uint8_t bucket_bits)
+{
+    /* The lowest key in a bucket */
+    return bucket_bits ? bucket << (32-bucket_bits) : 0;
+}
+
+static uint32_t key_bucket(uint32_t key, uint8_t bucket_bits)
+{
+    return bucket_bits ? key >> (32-bucket_bits) : 0;
+}
+
+static uint32_t read_varint(uint8_t **p, uint8_t *end)
+{
+    /* Read a varint, stopping at end */
+    uint32_t value = 0;
+    int shift = 0;
+    while(*p < end && shift < 32) {
+        value |= (uint32_t)(**p & 0x7F) << shift;
+        shift += 7;
+        if(!(*(*p)++ & 0x80))
+            break;
+    }
+    return value;
+}
+
+static void free_run(note_run *run)
+{
+    free(run->pitches);
+    free(run->durations);
+    free(run->bars);
+}
+
+phrase_index *build_phrase_index(huffman_buffer *buffer, uint32_t *tune_index, uint8_t n, uint8_t flags)
+{
+    /* Index every n-gram of intervals (with duration steps if flags has
+    PHRASE_DURATIONS) of every tune. The payload can be written as a
+    section with write_section(f, PHRASE_INDEX_TAG, index->data, index->length). */
+    note_run run = {NULL, NULL, NULL, 0, 0};
+    tune_context *ctx = new_context();
+    posting *postings = NULL;
+    uint32_t n_postings = 0, max_postings = 0, ix, i, j, k, n_keys, start;
+    uint32_t n_buckets, bucket, key = 0, size;
+    int8_t intervals[255], durations[255];
+    phrase_index *index;
+    uint8_t *p, *buckets, *list;
+
+    if(n==0) {
+        printf("Error: n-grams must have at least one interval\n");
+        return NULL;
+    }
+    for(ix=0; ix<tune_index[0]; ix++) {
+        decode_notes(buffer, tune_index, ix, ctx, &run);
+        for(i=0; i+n<run.n_notes; i++) {
+            for(k=0; k<n; k++) {
+                intervals[k] = note_interval(&run, i+k);
+                durations[k] = duration_step(&run, i+k);
+            }
+            if(n_postings==max_postings) {
+                max_postings = max_postings ? 2*max_postings : 4096;
+                postings = realloc(postings, sizeof(posting)*max_postings);
+            }
+            postings[n_postings].key = gram_key(intervals, (flags & PHRASE_DURATIONS) ? durations : NULL, n);
+            postings[n_postings].tune = ix;
+            n_postings++;
+        }
+    }
+    free_run(&run);
+    free_context(ctx);
+
+    /* Sort, and drop repeats of the same n-gram within a tune */
+    qsort(postings, n_postings, sizeof(posting), compare_postings);
+    for(i=0, k=0; i<n_postings; i++)
+        if(k==0 || compare_postings(&postings[i], &postings[k-1]))
+            postings[k++] = postings[i];
+    n_postings = k;
+    for(i=0, n_keys=0; i<n_postings; i++)
+        n_keys += i==0 || postings[i].key!=postings[i-1].key;
+
+    index = malloc(sizeof(phrase_index));
+    index->n = n;
+    index->flags = flags;
+    index->n_keys = n_keys;
+    index->owns_data = 1;
+    index->bucket_bits = 0;
+    while(index->bucket_bits < MAX_BUCKET_BITS &&
+          ((uint64_t)PHRASE_BUCKET_KEYS << index->bucket_bits) < n_keys)
+        index->bucket_bits++;
+    n_buckets = 1u << index->bucket_bits;
+    /* Each entry needs at most 5 bytes for its key delta and 5 for its
+    length, and each posting 5 */
+    index->data = malloc(8 + 4*((size_t)n_buckets+1) + (size_t)n_keys*10 + (size_t)n_postings*5);
+    p = index->data;
+    *p++ = n;
+    *p++ = flags;
+    *p++ = index->bucket_bits;
+    *p++ = 0;
+    writebuf_u32(&p, n_keys);
+    buckets = p;
+    list = p + 4*((size_t)n_buckets+1);
+    bucket = 0;
+    for(i=0; i<n_postings; i=k) {
+        for(k=i; k<n_postings && postings[k].key==postings[i].key; k++)
+            ;
+        /* Start any buckets up to this key's; those before are empty */
+        if(key_bucket(postings[i].key, index->bucket_bits) >= bucket) {
+            while(bucket <= key_bucket(postings[i].key, index->bucket_bits)) {
+                writebuf_u32(&buckets, list - index->data);
+                bucket++;
+            }
+            key = bucket_base(bucket-1, index->bucket_bits);
+        }
+        write_varint(&list, postings[i].key - key);
+        key = postings[i].key;
+        for(j=i, start=0, size=0; j<k; j++) {
+            size += varint_size(postings[j].tune - start);
+            start = postings[j].tune;
+        }
+        write_varint(&list, size);
+        for(start=0; i<k; i++) {
+            write_varint(&list, postings[i].tune - start);
+            start = postings[i].tune;
+        }
+    }
+    while(bucket <= n_buckets) {
+        writebuf_u32(&buckets, list - index->data);
+        bucket++;
+    }
+    index->length = list - index->data;
+    index->data = realloc(index->data, index->length);
+    free(postings);
+    return index;
+}
+
+phrase_index *load_phrase_index(huffman_buffer *buffer, uint8_t *file_end)
+{
+    /* Use the phrase index section in the file, if there is one and its
+    bucket offsets are in order within it. The index points into the
+    file data, which must outlive it. */
+    uint32_t length, i, n_buckets, offset, last;
+    uint8_t *p = find_section(buffer, file_end, PHRASE_INDEX_TAG, &length);
+    phrase_index *index;
+    if(p==NULL)
+        return NULL;
+    if(length < 8 || p[0]==0 || p[2] > MAX_BUCKET_BITS ||
+       (uint64_t)length < 8 + 4*(((uint64_t)1<<p[2])+1)) {
+        printf("Error: truncated phrase index\n");
+        return NULL;
+    }
+    index = malloc(sizeof(phrase_index));
+    index->data = p;
+    index->length = length;
+    index->n = p[0];
+    index->flags = p[1];
+    index->bucket_bits = p[2];
+    p += 4;
+    index->n_keys = readbuf_u32(&p);
+    index->owns_data = 0;
+    n_buckets = 1u << index->bucket_bits;
+    last = 8 + 4*(n_buckets+1);
+    for(i=0; i<=n_buckets; i++) {
+        offset = readbuf_u32(&p);
+        if(offset < last || offset > length) {
+            printf("Error: phrase index offset out of range\n");
+            free(index);
+            return NULL;
+        }
+        last = offset;
+    }
+    return index;
+}
+
+static uint8_t *find_postings(phrase_index *index, uint32_t key, uint8_t **list_end)
+{
+    /* Scan the key's bucket; returns its posting list, setting
+    *list_end, or NULL if the key is not there */
+    uint32_t bucket = key_bucket(key, index->bucket_bits);
+    uint32_t k = bucket_base(bucket, index->bucket_bits), size;
+    uint8_t *p = index->data + 8 + 4*bucket, *end;
+    uint32_t first = readbuf_u32(&p);
+    end = index->data + readbuf_u32(&p);
+    p = index->data + first;
+    while(p < end) {
+        k += read_varint(&p, end);
+        size = read_varint(&p, end);
+        if(size > (uint32_t)(end-p))
+            return NULL;
+        if(k==key) {
+            *list_end = p + size;
+            return p;
+        }
+        if(k > key)
+            return NULL;
+        p += size;
+    }
+    return NULL;
+}
+
+static uint32_t read_tunes(uint8_t *p, uint8_t *end, uint32_t *tunes, uint32_t n_tunes)
+{
+    /* Read the tunes of a posting list into tunes, which has room for
+    n_tunes, the number in the book. Returns how many there are, or
+    INVALID_CODE if they are not increasing tunes of the book. */
+    uint32_t n = 0, tune = 0, delta;
+    while(p<end) {
+        delta = read_varint(&p, end);
+        if((n>0 && delta==0) || delta >= n_tunes-tune)
+            return INVALID_CODE;
+        tune += delta;
+        tunes[n++] = tune;
+    }
+    return n;
+}
+
+static uint32_t every_tune(uint32_t *tunes, uint32_t n_tunes)
+{
+    uint32_t i;
+    for(i=0; i<n_tunes; i++)
+        tunes[i] = i;
+    return n_tunes;
+}
+
+static uint32_t candidate_tunes(phrase_index *index, int8_t *intervals, int8_t *durations,
+                                uint32_t n_intervals, uint32_t *tunes, uint32_t n_tunes)
+{
+    /* Tunes containing every n-gram of the phrase, by intersecting their
+    posting lists. Without a usable index, every tune is a candidate. */
+    uint32_t n = 0, m, i, j, k, g;
+    uint32_t *other;
+    uint8_t *list, *list_end;
+    int use_durations;
+
+    use_durations = index && (index->flags & PHRASE_DURATIONS);
+    if(index==NULL || n_intervals < index->n || (use_durations && durations==NULL))
+        return every_tune(tunes, n_tunes);
+    other = malloc(sizeof(uint32_t)*n_tunes);
+    for(g=0; g+index->n<=n_intervals; g++) {
+        list = find_postings(index, gram_key(intervals+g, use_durations ? durations+g : NULL, index->n), &list_end);
+        if(list==NULL) {
+            n = 0;
+            break;
+        }
+        m = read_tunes(list, list_end, g==0 ? tunes : other, n_tunes);
+        if(m==INVALID_CODE) {
+            /* A damaged list: the intersection needs sorted tunes of the book */
+            printf("Error: damaged phrase index; searching every tune\n");
+            free(other);
+            return every_tune(tunes, n_tunes);
+        }
+        if(g==0) {
+            n = m;
+            continue;
+        }
+        for(i=0, j=0, k=0; i<n && j<m; ) {
+            if(tunes[i]==other[j]) {
+                tunes[k++] = tunes[i];
+                i++;
+                j++;
+            }
+            else if(tunes[i] < other[j])
+                i++;
+            else
+                j++;
+        }
+        n = k;
+        if(n==0)
+            break;
+    }
+    free(other);
+    return n;
+}
+
+uint32_t find_phrase(phrase_index *index, huffman_buffer *buffer, uint32_t *tune_index,
+                     int8_t *intervals, int8_t *durations, uint32_t n_intervals,
+                     phrase_match *matches, uint32_t max_matches)
+{
+    /* Find up to max_matches places where the phrase of n_intervals
+    intervals (and duration steps, unless durations is NULL) occurs.
+    index may be NULL, in which case every tune is decoded. Returns the
+    number of matches written. */
+    uint32_t *tunes = malloc(sizeof(uint32_t)*(tune_index[0]+1));
+    uint32_t n_tunes, t, i, k, n_matches = 0;
+    note_run run = {NULL, NULL, NULL, 0, 0};
+    tune_context *ctx;
+
+    if(n_intervals==0 || n_intervals>=MAX_PHRASE) {
+        printf("Error: phrases must have 1 to %d intervals\n", MAX_PHRASE-1);
+        free(tunes);
+        return 0;
+    }
+    n_tunes = candidate_tunes(index, intervals, durations, n_intervals, tunes, tune_index[0]);
+    ctx = new_context();
+    for(t=0; t<n_tunes && n_matches<max_matches; t++) {
+        decode_notes(buffer, tune_index, tunes[t], ctx, &run);
+        for(i=0; i+n_intervals<run.n_notes && n_matches<max_matches; i++) {
+            for(k=0; k<n_intervals; k++) {
+                if(note_interval(&run, i+k)!=intervals[k])
+                    break;
+                if(durations && duration_step(&run, i+k)!=durations[k])
+                    break;
+            }
+            if(k==n_intervals) {
+                matches[n_matches].tune = tunes[t];
+                matches[n_matches].bar = run.bars[i];
+                n_matches++;
+            }
+        }
+    }
+    free_context(ctx);
+    free_run(&run);
+    free(tunes);
+    return n_matches;
+}
+
+void free_phrase_index(phrase_index *index)
+{
+    if(index->owns_data)
+        free(index->data);
+    free(index);
+}
@@ -0,0 +1,70 @@
+#ifndef PHRASE_INDEX_H
+#define PHRASE_INDEX_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+#define PHRASE_INDEX_TAG "NGRM"
+#define DEFAULT_GRAM 4 /* intervals per n-gram */
+#define MAX_PHRASE 64 /* notes in a query */
+#define PHRASE_BUCKET_KEYS 16 /* keys per bucket, on average */
+#define MAX_BUCKET_BITS 24
+
+/*
+    A phrase is a run of notes, given by the interval in semitones from
+    each note to the next and, optionally, the change in duration from each
+    note to the next as a whole number of octaves of time: round(log2(new/old)),
+    so 1 is twice as long and -1 half. Rests are skipped, so phrases match
+    across them.
+
+    Phrase index section payload:
+        [n:u8] [flags:u8] [bucket_bits:u8] [reserved:u8] [n_keys:u32]
+        [bucket offset:u32*(2^bucket_bits + 1)] [entries]
+    Keys are hashes of the n intervals (and duration steps, with flags & PHRASE_DURATIONS)
+    of every n-gram in the book. They are grouped into buckets by their top
+    bucket_bits bits, about PHRASE_BUCKET_KEYS keys to a bucket, and
+    each bucket offset is from the start of the payload to its first
+    entry (the last marks the end of the entries). Within a bucket the
+    entries are sorted by key, each with its posting list, the tunes
+    containing the n-gram:
+        [key delta:varint] [N bytes of tunes:varint] [tune delta:varint...]
+    The key delta is from the key before it, or from the bucket's lowest
+    key for the first; the tunes are in increasing order, each as the
+    difference from the one before (from 0 for the first). Varints are 7
+    bits a byte, low bits first, with the high bit set on all but the
+    last byte.
+    A lookup reads one bucket offset and scans its few entries. Keys cost
+    about 3 bytes each this way, against 8 for a table of keys and list
+    offsets; the posting lists, a few bytes per n-gram per tune, are the
+    rest and most of the section.
+    Hashes can collide, so candidate tunes from the index are decoded to
+    confirm each match and find its bar.
+*/
+
+#define PHRASE_DURATIONS 1
+
+typedef struct phrase_index
+{
+    uint8_t *data; /* the section payload */
+    uint32_t length;
+    uint8_t n;
+    uint8_t flags;
+    uint8_t bucket_bits;
+    uint32_t n_keys;
+    uint8_t owns_data; /* 1 if data was built in memory rather than found in the file */
+} phrase_index;
+
+typedef struct phrase_match
+{
+    uint32_t tune;
+    uint32_t bar; /* bars before the first note of the phrase */
+} phrase_match;
+
+phrase_index *build_phrase_index(huffman_buffer *buffer, uint32_t *tune_index, uint8_t n, uint8_t flags);
+phrase_index *load_phrase_index(huffman_buffer *buffer, uint8_t *file_end);
+uint32_t find_phrase(phrase_index *index, huffman_buffer *buffer, uint32_t *tune_index,
+                     int8_t *intervals, int8_t *durations, uint32_t n_intervals,
+                     phrase_match *matches, uint32_t max_matches);
+void free_phrase_index(phrase_index *index);
+
+#endif
@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "player.h"
+
+/* Playback with no heap at all, for microcontroller builds: the context
+lives in static storage, and the buffer can be the static tables written
+by huf_to_c. Only one tune can play at a time. */
+
+static tune_context player_context;
+static tune_metadata player_meta;
+static parser_context player_parser;
+
+void play_tune(huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix, event_callback_type callback, void *callback_context)
+{
+    /* Play tune ix, sending events to callback */
+    init_context(&player_context, &player_meta, &player_parser);
+    player_context.event_callback = callback;
+    player_context.callback_context = callback_context;
+    player_context.stats = buffer->stats;
+    if(ix>=tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return;
+    }
+    buffer->pos = tune_index[ix+1];
+    parse_tune_context(buffer, &player_context);
+}
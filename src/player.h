@@ -0,0 +1,10 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+void play_tune(huffman_buffer *buffer, const uint32_t *tune_index, uint32_t ix, event_callback_type callback, void *callback_context);
+
+#endif
@@ -0,0 +1,586 @@
+/* Generated by huf_preset --train from ../examples/p_hardy.huf. Do not edit.
+   Preset 1: 218 entries, ABC1_ESCAPE is the escape entry.
+*/
+#ifndef PRESET_ABC1_H
+#define PRESET_ABC1_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+#define ABC1_ESCAPE 217
+
+static const uint8_t abc1_n_bits[218] = {
+    0xc, 0xc, 0xf, 0xf, 0xd, 0xb, 0x5, 0x5, 0xc, 0xf, 0x8, 0xd,
+    0x8, 0xf, 0xd, 0x3, 0x7, 0xb, 0xf, 0xf, 0x8, 0xf, 0xa, 0xf,
+    0xf, 0xc, 0xb, 0xd, 0xd, 0xb, 0xc, 0xc, 0xb, 0xc, 0xb, 0xc,
+    0xc, 0xc, 0xf, 0xb, 0xa, 0xb, 0xa, 0xb, 0xe, 0xe, 0x8, 0xa,
+    0xc, 0x8, 0xf, 0xa, 0xb, 0x9, 0x9, 0xb, 0xd, 0x9, 0x8, 0x8,
+    0xe, 0xa, 0xd, 0x7, 0xf, 0x5, 0xb, 0xc, 0xa, 0xe, 0xf, 0xd,
+    0x7, 0x7, 0xd, 0xc, 0xd, 0xb, 0x7, 0x7, 0xe, 0xf, 0xd, 0x6,
+    0xc, 0xc, 0xf, 0xe, 0xd, 0x7, 0x5, 0x8, 0xf, 0xf, 0x4, 0xe,
+    0xb, 0x4, 0x9, 0xe, 0xf, 0xa, 0xf, 0xe, 0xb, 0x8, 0xf, 0x6,
+    0xc, 0xa, 0xe, 0xf, 0xc, 0xb, 0x7, 0xe, 0xf, 0xc, 0xd, 0xf,
+    0xf, 0xf, 0xa, 0xf, 0xb, 0xb, 0xc, 0xe, 0x6, 0xe, 0x8, 0xd,
+    0xb, 0xb, 0x8, 0xf, 0xc, 0xe, 0xd, 0x9, 0xa, 0xd, 0xc, 0xd,
+    0xf, 0xb, 0x4, 0xd, 0xb, 0xe, 0xa, 0x4, 0x6, 0xd, 0xa, 0xc,
+    0xd, 0xc, 0xf, 0xe, 0xa, 0xf, 0xf, 0xf, 0x8, 0x6, 0xd, 0xf,
+    0xf, 0x5, 0xf, 0x6, 0x9, 0xa, 0x5, 0x8, 0xf, 0xf, 0xf, 0xf,
+    0x9, 0xf, 0x9, 0xf, 0x8, 0xc, 0xe, 0x9, 0xa, 0xd, 0xf, 0xc,
+    0xf, 0xb, 0x5, 0xe, 0x8, 0xf, 0x9, 0xd, 0x3, 0x9, 0xe, 0xd,
+    0xa, 0x9, 0xe, 0x9, 0xd, 0xd, 0xf, 0xe, 0xd, 0xf, 0xb, 0xe,
+    0xe, 0xb,
+};
+
+static const uint32_t abc1_codes[218] = {
+    0xfce, 0xfcf, 0x7fd2, 0x7fd3, 0x1fce, 0x7ce, 0x10, 0x11, 0xfd0, 0x7fd4, 0xe0, 0x1fcf,
+    0xe1, 0x7fd5, 0x1fd0, 0x0, 0x68, 0x7cf, 0x7fd6, 0x7fd7, 0xe2, 0x7fd8, 0x3d6, 0x7fd9,
+    0x7fda, 0xfd1, 0x7d0, 0x1fd1, 0x1fd2, 0x7d1, 0xfd2, 0xfd3, 0x7d2, 0xfd4, 0x7d3, 0xfd5,
+    0xfd6, 0xfd7, 0x7fdb, 0x7d4, 0x3d7, 0x7d5, 0x3d8, 0x7d6, 0x3fd2, 0x3fd3, 0xe3, 0x3d9,
+    0xfd8, 0xe4, 0x7fdc, 0x3da, 0x7d7, 0x1de, 0x1df, 0x7d8, 0x1fd3, 0x1e0, 0xe5, 0xe6,
+    0x3fd4, 0x3db, 0x1fd4, 0x69, 0x7fdd, 0x12, 0x7d9, 0xfd9, 0x3dc, 0x3fd5, 0x7fde, 0x1fd5,
+    0x6a, 0x6b, 0x1fd6, 0xfda, 0x1fd7, 0x7da, 0x6c, 0x6d, 0x3fd6, 0x7fdf, 0x1fd8, 0x2e,
+    0xfdb, 0xfdc, 0x7fe0, 0x3fd7, 0x1fd9, 0x6e, 0x13, 0xe7, 0x7fe1, 0x7fe2, 0x4, 0x3fd8,
+    0x7db, 0x5, 0x1e1, 0x3fd9, 0x7fe3, 0x3dd, 0x7fe4, 0x3fda, 0x7dc, 0xe8, 0x7fe5, 0x2f,
+    0xfdd, 0x3de, 0x3fdb, 0x7fe6, 0xfde, 0x7dd, 0x6f, 0x3fdc, 0x7fe7, 0xfdf, 0x1fda, 0x7fe8,
+    0x7fe9, 0x7fea, 0x3df, 0x7feb, 0x7de, 0x7df, 0xfe0, 0x3fdd, 0x30, 0x3fde, 0xe9, 0x1fdb,
+    0x7e0, 0x7e1, 0xea, 0x7fec, 0xfe1, 0x3fdf, 0x1fdc, 0x1e2, 0x3e0, 0x1fdd, 0xfe2, 0x1fde,
+    0x7fed, 0x7e2, 0x6, 0x1fdf, 0x7e3, 0x3fe0, 0x3e1, 0x7, 0x31, 0x1fe0, 0x3e2, 0xfe3,
+    0x1fe1, 0xfe4, 0x7fee, 0x3fe1, 0x3e3, 0x7fef, 0x7ff0, 0x7ff1, 0xeb, 0x32, 0x1fe2, 0x7ff2,
+    0x7ff3, 0x14, 0x7ff4, 0x33, 0x1e3, 0x3e4, 0x15, 0xec, 0x7ff5, 0x7ff6, 0x7ff7, 0x7ff8,
+    0x1e4, 0x7ff9, 0x1e5, 0x7ffa, 0xed, 0xfe5, 0x3fe2, 0x1e6, 0x3e5, 0x1fe3, 0x7ffb, 0xfe6,
+    0x7ffc, 0x7e4, 0x16, 0x3fe3, 0xee, 0x7ffd, 0x1e7, 0x1fe4, 0x1, 0x1e8, 0x3fe4, 0x1fe5,
+    0x3e6, 0x1e9, 0x3fe5, 0x1ea, 0x1fe6, 0x1fe7, 0x7ffe, 0x3fe6, 0x1fe8, 0x7fff, 0x7e5, 0x3fe7,
+    0x3fe8, 0x7e6,
+};
+
+static const huf_offset_t abc1_token_offsets[219] = {
+    0x0, 0x5, 0xe, 0x16, 0x1f, 0x24, 0x2a, 0x2d, 0x30, 0x39, 0x3e, 0x43,
+    0x49, 0x4b, 0x53, 0x5c, 0x5f, 0x61, 0x63, 0x65, 0x67, 0x69, 0x6b, 0x6d,
+    0x6f, 0x71, 0x73, 0x75, 0x7a, 0x7c, 0x7e, 0x80, 0x82, 0x84, 0x86, 0x88,
+    0x8a, 0x8c, 0x8e, 0x90, 0x92, 0x94, 0x96, 0x98, 0x9a, 0x9c, 0x9e, 0xa0,
+    0xa2, 0xa4, 0xa6, 0xac, 0xae, 0xb0, 0xb2, 0xb4, 0xb6, 0xba, 0xbc, 0xbe,
+    0xc0, 0xc2, 0xc4, 0xc8, 0xcc, 0xd0, 0xd6, 0xd8, 0xda, 0xdc, 0xde, 0xe7,
+    0xe9, 0xec, 0xef, 0xf4, 0xf9, 0xff, 0x107, 0x10b, 0x111, 0x11d, 0x125, 0x129,
+    0x12e, 0x131, 0x134, 0x13a, 0x141, 0x148, 0x14d, 0x150, 0x154, 0x15c, 0x162, 0x167,
+    0x16c, 0x170, 0x173, 0x178, 0x180, 0x185, 0x18a, 0x191, 0x19a, 0x19f, 0x1a4, 0x1ac,
+    0x1b0, 0x1b8, 0x1c1, 0x1c7, 0x1d0, 0x1d6, 0x1db, 0x1df, 0x1e6, 0x1ec, 0x1f0, 0x1f9,
+    0x202, 0x20b, 0x212, 0x216, 0x21a, 0x220, 0x224, 0x229, 0x231, 0x234, 0x23b, 0x240,
+    0x249, 0x250, 0x254, 0x25a, 0x261, 0x26a, 0x270, 0x278, 0x27c, 0x280, 0x289, 0x28d,
+    0x291, 0x299, 0x29d, 0x2a2, 0x2a8, 0x2ad, 0x2b5, 0x2ba, 0x2bd, 0x2c0, 0x2c9, 0x2ce,
+    0x2d4, 0x2d6, 0x2dd, 0x2e3, 0x2eb, 0x2ef, 0x2f6, 0x2ff, 0x304, 0x309, 0x30c, 0x314,
+    0x31c, 0x321, 0x324, 0x32a, 0x32d, 0x32f, 0x331, 0x336, 0x33d, 0x345, 0x34d, 0x352,
+    0x35a, 0x360, 0x368, 0x36b, 0x374, 0x377, 0x37c, 0x385, 0x387, 0x389, 0x38b, 0x391,
+    0x39a, 0x39e, 0x3a0, 0x3a6, 0x3ae, 0x3b0, 0x3b5, 0x3bb, 0x3c0, 0x3c2, 0x3c4, 0x3cc,
+    0x3d0, 0x3d2, 0x3d5, 0x3da, 0x3dd, 0x3e3, 0x3ea, 0x3f2, 0x3f9, 0x402, 0x406, 0x40f,
+    0x417, 0x41c, 0x424,
+};
+
+static const char abc1_strings[1060] =
+    "#fsm\000"
+    "^1200000\000"
+    "/1961/1\000"
+    "^2181818\000"
+    "%9\\8\000"
+    "&emin\000"
+    "+3\000"
+    "-3\000"
+    "^1000000\000"
+    "/8/9\000"
+    "/1/4\000"
+    "&ador\000"
+    "\n\000"
+    "/3847/4\000"
+    "^1636363\000"
+    "-2\000"
+    " \000"
+    "'\000"
+    ")\000"
+    "(\000"
+    "*\000"
+    "-\000"
+    ",\000"
+    "1\000"
+    "2\000"
+    "A\000"
+    "C\000"
+    "#em7\000"
+    "E\000"
+    "D\000"
+    "G\000"
+    "F\000"
+    "H\000"
+    "K\000"
+    "M\000"
+    "L\000"
+    "O\000"
+    "N\000"
+    "Q\000"
+    "P\000"
+    "S\000"
+    "R\000"
+    "T\000"
+    "W\000"
+    "V\000"
+    "Y\000"
+    "a\000"
+    "c\000"
+    "b\000"
+    "e\000"
+    "/12/1\000"
+    "g\000"
+    "f\000"
+    "i\000"
+    "h\000"
+    "k\000"
+    "+15\000"
+    "l\000"
+    "o\000"
+    "n\000"
+    "q\000"
+    "p\000"
+    "+14\000"
+    "#am\000"
+    "-14\000"
+    "#dmaj\000"
+    "w\000"
+    "v\000"
+    "y\000"
+    "x\000"
+    "^1411764\000"
+    "z\000"
+    "+7\000"
+    "-7\000"
+    "%2\\2\000"
+    "/8/1\000"
+    "&edor\000"
+    "/1/1961\000"
+    "#bm\000"
+    "#cmaj\000"
+    "/276376/737\000"
+    "/2973/2\000"
+    "+17\000"
+    "/3/1\000"
+    "+6\000"
+    "-6\000"
+    "&ddor\000"
+    "/496/1\000"
+    "/1/992\000"
+    "/3/2\000"
+    "+1\000"
+    "#a7\000"
+    "/2973/4\000"
+    "&dmix\000"
+    "/2/1\000"
+    "/7/4\000"
+    "#b7\000"
+    "+0\000"
+    "%4\\4\000"
+    "/1/1478\000"
+    "/8/3\000"
+    "/1/6\000"
+    "/1/499\000"
+    "/553/282\000"
+    "%3\\4\000"
+    "/4/1\000"
+    "/1/3850\000"
+    "#em\000"
+    "/1961/2\000"
+    "^1500000\000"
+    "&amix\000"
+    "^1600000\000"
+    "#emaj\000"
+    "%2\\4\000"
+    "#d7\000"
+    "#dmaj7\000"
+    "#cdim\000"
+    "+16\000"
+    "^2400000\000"
+    "^1125000\000"
+    "^1384615\000"
+    "/983/1\000"
+    "-10\000"
+    "#cm\000"
+    "#fmaj\000"
+    "#e7\000"
+    "/3/8\000"
+    "/1/5668\000"
+    "-5\000"
+    "/991/2\000"
+    "/3/4\000"
+    "^2250000\000"
+    "/1/991\000"
+    "#dm\000"
+    "#amaj\000"
+    "/998/1\000"
+    "^1799999\000"
+    "&amaj\000"
+    "/1/3862\000"
+    "+12\000"
+    "-12\000"
+    "^1333333\000"
+    "-11\000"
+    "+11\000"
+    "/1/3847\000"
+    "#g7\000"
+    "/1/2\000"
+    "&amin\000"
+    "/4/3\000"
+    "/1478/3\000"
+    "%6\\8\000"
+    "+2\000"
+    "-4\000"
+    "^1846153\000"
+    "/6/1\000"
+    "#bmaj\000"
+    "J\000"
+    "/991/1\000"
+    "&bmin\000"
+    "/1/1963\000"
+    "+10\000"
+    "/992/1\000"
+    "^2666666\000"
+    "/9/4\000"
+    "/2/3\000"
+    "+5\000"
+    "/1931/2\000"
+    "/1961/4\000"
+    "#bm7\000"
+    "-1\000"
+    "%12\\8\000"
+    "+4\000"
+    "t\000"
+    "d\000"
+    "/1/3\000"
+    "*title\000"
+    "/5883/4\000"
+    "/2913/1\000"
+    "/4/9\000"
+    "/1963/2\000"
+    "&gmaj\000"
+    "/2834/3\000"
+    "-9\000"
+    "^2699999\000"
+    "+9\000"
+    "#am7\000"
+    "^1285714\000"
+    "s\000"
+    "B\000"
+    "I\000"
+    "#gdim\000"
+    "^1714285\000"
+    "+19\000"
+    "m\000"
+    "#gmaj\000"
+    "/1/1966\000"
+    "r\000"
+    "#fs7\000"
+    "&dmaj\000"
+    "/9/2\000"
+    "|\000"
+    "~\000"
+    "/1/2913\000"
+    "#gm\000"
+    "u\000"
+    "-8\000"
+    "/1/7\000"
+    "+8\000"
+    "&cmaj\000"
+    "/991/3\000"
+    "/1/2917\000"
+    "/991/4\000"
+    "^3000000\000"
+    "+13\000"
+    "^2000000\000"
+    "/1925/2\000"
+    "/1/9\000"
+    "*preset\000";
+
+static const huffman_op abc1_ops[218] = {
+    {35, 0, 0},
+    {94, 1200000, 0},
+    {47, 1961, 1},
+    {94, 2181818, 0},
+    {37, 9, 8},
+    {38, 0, 0},
+    {43, 3, 0},
+    {45, 3, 0},
+    {94, 1000000, 0},
+    {47, 8, 9},
+    {47, 1, 4},
+    {38, 0, 0},
+    {10, 0, 0},
+    {47, 3847, 4},
+    {94, 1636363, 0},
+    {45, 2, 0},
+    {32, 0, 0},
+    {39, 0, 0},
+    {41, 0, 0},
+    {40, 0, 0},
+    {42, 0, 0},
+    {45, 0, 0},
+    {44, 0, 0},
+    {49, 0, 0},
+    {50, 0, 0},
+    {65, 0, 0},
+    {67, 0, 0},
+    {35, 0, 0},
+    {69, 0, 0},
+    {68, 0, 0},
+    {71, 0, 0},
+    {70, 0, 0},
+    {72, 0, 0},
+    {75, 0, 0},
+    {77, 0, 0},
+    {76, 0, 0},
+    {79, 0, 0},
+    {78, 0, 0},
+    {81, 0, 0},
+    {80, 0, 0},
+    {83, 0, 0},
+    {82, 0, 0},
+    {84, 0, 0},
+    {87, 0, 0},
+    {86, 0, 0},
+    {89, 0, 0},
+    {97, 0, 0},
+    {99, 0, 0},
+    {98, 0, 0},
+    {101, 0, 0},
+    {47, 12, 1},
+    {103, 0, 0},
+    {102, 0, 0},
+    {105, 0, 0},
+    {104, 0, 0},
+    {107, 0, 0},
+    {43, 15, 0},
+    {108, 0, 0},
+    {111, 0, 0},
+    {110, 0, 0},
+    {113, 0, 0},
+    {112, 0, 0},
+    {43, 14, 0},
+    {35, 0, 0},
+    {45, 14, 0},
+    {35, 0, 0},
+    {119, 0, 0},
+    {118, 0, 0},
+    {121, 0, 0},
+    {120, 0, 0},
+    {94, 1411764, 0},
+    {122, 0, 0},
+    {43, 7, 0},
+    {45, 7, 0},
+    {37, 2, 2},
+    {47, 8, 1},
+    {38, 0, 0},
+    {47, 1, 1961},
+    {35, 0, 0},
+    {35, 0, 0},
+    {47, 276376, 737},
+    {47, 2973, 2},
+    {43, 17, 0},
+    {47, 3, 1},
+    {43, 6, 0},
+    {45, 6, 0},
+    {38, 0, 0},
+    {47, 496, 1},
+    {47, 1, 992},
+    {47, 3, 2},
+    {43, 1, 0},
+    {35, 0, 0},
+    {47, 2973, 4},
+    {38, 0, 0},
+    {47, 2, 1},
+    {47, 7, 4},
+    {35, 0, 0},
+    {43, 0, 0},
+    {37, 4, 4},
+    {47, 1, 1478},
+    {47, 8, 3},
+    {47, 1, 6},
+    {47, 1, 499},
+    {47, 553, 282},
+    {37, 3, 4},
+    {47, 4, 1},
+    {47, 1, 3850},
+    {35, 0, 0},
+    {47, 1961, 2},
+    {94, 1500000, 0},
+    {38, 0, 0},
+    {94, 1600000, 0},
+    {35, 0, 0},
+    {37, 2, 4},
+    {35, 0, 0},
+    {35, 0, 0},
+    {35, 0, 0},
+    {43, 16, 0},
+    {94, 2400000, 0},
+    {94, 1125000, 0},
+    {94, 1384615, 0},
+    {47, 983, 1},
+    {45, 10, 0},
+    {35, 0, 0},
+    {35, 0, 0},
+    {35, 0, 0},
+    {47, 3, 8},
+    {47, 1, 5668},
+    {45, 5, 0},
+    {47, 991, 2},
+    {47, 3, 4},
+    {94, 2250000, 0},
+    {47, 1, 991},
+    {35, 0, 0},
+    {35, 0, 0},
+    {47, 998, 1},
+    {94, 1799999, 0},
+    {38, 0, 0},
+    {47, 1, 3862},
+    {43, 12, 0},
+    {45, 12, 0},
+    {94, 1333333, 0},
+    {45, 11, 0},
+    {43, 11, 0},
+    {47, 1, 3847},
+    {35, 0, 0},
+    {47, 1, 2},
+    {38, 0, 0},
+    {47, 4, 3},
+    {47, 1478, 3},
+    {37, 6, 8},
+    {43, 2, 0},
+    {45, 4, 0},
+    {94, 1846153, 0},
+    {47, 6, 1},
+    {35, 0, 0},
+    {74, 0, 0},
+    {47, 991, 1},
+    {38, 0, 0},
+    {47, 1, 1963},
+    {43, 10, 0},
+    {47, 992, 1},
+    {94, 2666666, 0},
+    {47, 9, 4},
+    {47, 2, 3},
+    {43, 5, 0},
+    {47, 1931, 2},
+    {47, 1961, 4},
+    {35, 0, 0},
+    {45, 1, 0},
+    {37, 12, 8},
+    {43, 4, 0},
+    {116, 0, 0},
+    {100, 0, 0},
+    {47, 1, 3},
+    {42, 0, 0},
+    {47, 5883, 4},
+    {47, 2913, 1},
+    {47, 4, 9},
+    {47, 1963, 2},
+    {38, 0, 0},
+    {47, 2834, 3},
+    {45, 9, 0},
+    {94, 2699999, 0},
+    {43, 9, 0},
+    {35, 0, 0},
+    {94, 1285714, 0},
+    {115, 0, 0},
+    {66, 0, 0},
+    {73, 0, 0},
+    {35, 0, 0},
+    {94, 1714285, 0},
+    {43, 19, 0},
+    {109, 0, 0},
+    {35, 0, 0},
+    {47, 1, 1966},
+    {114, 0, 0},
+    {35, 0, 0},
+    {38, 0, 0},
+    {47, 9, 2},
+    {124, 0, 0},
+    {126, 0, 0},
+    {47, 1, 2913},
+    {35, 0, 0},
+    {117, 0, 0},
+    {45, 8, 0},
+    {47, 1, 7},
+    {43, 8, 0},
+    {38, 0, 0},
+    {47, 991, 3},
+    {47, 1, 2917},
+    {47, 991, 4},
+    {94, 3000000, 0},
+    {43, 13, 0},
+    {94, 2000000, 0},
+    {47, 1925, 2},
+    {47, 1, 9},
+    {42, 0, 0},
+};
+
+static const uint32_t abc1_lut_entries[704] = {
+    0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0xa08, 0xf03, 0x4105, 0x6104, 0x1007,
+    0xc803, 0xc205, 0x9704, 0x3909, 0xf03, 0x705, 0x5e04, 0xa506, 0xc803, 0xae05, 0x9204, 0x6908,
+    0xf03, 0x5a05, 0x6104, 0x4e07, 0xc803, 0x5306, 0x9704, 0x80020001, 0xf03, 0x605, 0x5e04, 0x9806,
+    0xc803, 0xa905, 0x9204, 0x3108, 0xf03, 0x4105, 0x6104, 0x4807, 0xc803, 0xc205, 0x9704, 0xc909,
+    0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0xaf08, 0xf03, 0x5a05, 0x6104, 0x5907,
+    0xc803, 0x6b06, 0x9704, 0x80020202, 0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0x1408,
+    0xf03, 0x4105, 0x6104, 0x3f07, 0xc803, 0xc205, 0x9704, 0xb409, 0xf03, 0x705, 0x5e04, 0xa506,
+    0xc803, 0xae05, 0x9204, 0x8608, 0xf03, 0x5a05, 0x6104, 0x4f07, 0xc803, 0x5306, 0x9704, 0x80020602,
+    0xf03, 0x605, 0x5e04, 0x9806, 0xc803, 0xa905, 0x9204, 0x3b08, 0xf03, 0x4105, 0x6104, 0x4907,
+    0xc803, 0xc205, 0x9704, 0x80020a01, 0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0xc408,
+    0xf03, 0x5a05, 0x6104, 0x7207, 0xc803, 0x6b06, 0x9704, 0x80020c04, 0xf03, 0x605, 0x5e04, 0x8006,
+    0xc803, 0xa905, 0x9204, 0xc08, 0xf03, 0x4105, 0x6104, 0x1007, 0xc803, 0xc205, 0x9704, 0x8b09,
+    0xf03, 0x705, 0x5e04, 0xa506, 0xc803, 0xae05, 0x9204, 0x8208, 0xf03, 0x5a05, 0x6104, 0x4e07,
+    0xc803, 0x5306, 0x9704, 0x80021c01, 0xf03, 0x605, 0x5e04, 0x9806, 0xc803, 0xa905, 0x9204, 0x3a08,
+    0xf03, 0x4105, 0x6104, 0x4807, 0xc803, 0xc205, 0x9704, 0xcf09, 0xf03, 0x705, 0x5e04, 0xab06,
+    0xc803, 0xae05, 0x9204, 0xb808, 0xf03, 0x5a05, 0x6104, 0x5907, 0xc803, 0x6b06, 0x9704, 0x80021e03,
+    0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0x2e08, 0xf03, 0x4105, 0x6104, 0x3f07,
+    0xc803, 0xc205, 0x9704, 0xbb09, 0xf03, 0x705, 0x5e04, 0xa506, 0xc803, 0xae05, 0x9204, 0xa408,
+    0xf03, 0x5a05, 0x6104, 0x4f07, 0xc803, 0x5306, 0x9704, 0x80022602, 0xf03, 0x605, 0x5e04, 0x9806,
+    0xc803, 0xa905, 0x9204, 0x5b08, 0xf03, 0x4105, 0x6104, 0x4907, 0xc803, 0xc205, 0x9704, 0x80022a01,
+    0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0x3509, 0xf03, 0x5a05, 0x6104, 0x7207,
+    0xc803, 0x6b06, 0x9704, 0x80022c05, 0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0xa08,
+    0xf03, 0x4105, 0x6104, 0x1007, 0xc803, 0xc205, 0x9704, 0x6209, 0xf03, 0x705, 0x5e04, 0xa506,
+    0xc803, 0xae05, 0x9204, 0x6908, 0xf03, 0x5a05, 0x6104, 0x4e07, 0xc803, 0x5306, 0x9704, 0x80024c01,
+    0xf03, 0x605, 0x5e04, 0x9806, 0xc803, 0xa905, 0x9204, 0x3108, 0xf03, 0x4105, 0x6104, 0x4807,
+    0xc803, 0xc205, 0x9704, 0xcd09, 0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0xaf08,
+    0xf03, 0x5a05, 0x6104, 0x5907, 0xc803, 0x6b06, 0x9704, 0x80024e03, 0xf03, 0x605, 0x5e04, 0x8006,
+    0xc803, 0xa905, 0x9204, 0x1408, 0xf03, 0x4105, 0x6104, 0x3f07, 0xc803, 0xc205, 0x9704, 0xb609,
+    0xf03, 0x705, 0x5e04, 0xa506, 0xc803, 0xae05, 0x9204, 0x8608, 0xf03, 0x5a05, 0x6104, 0x4f07,
+    0xc803, 0x5306, 0x9704, 0x80025602, 0xf03, 0x605, 0x5e04, 0x9806, 0xc803, 0xa905, 0x9204, 0x3b08,
+    0xf03, 0x4105, 0x6104, 0x4907, 0xc803, 0xc205, 0x9704, 0x80025a01, 0xf03, 0x705, 0x5e04, 0xab06,
+    0xc803, 0xae05, 0x9204, 0xc408, 0xf03, 0x5a05, 0x6104, 0x7207, 0xc803, 0x6b06, 0x9704, 0x80025c04,
+    0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0xc08, 0xf03, 0x4105, 0x6104, 0x1007,
+    0xc803, 0xc205, 0x9704, 0xac09, 0xf03, 0x705, 0x5e04, 0xa506, 0xc803, 0xae05, 0x9204, 0x8208,
+    0xf03, 0x5a05, 0x6104, 0x4e07, 0xc803, 0x5306, 0x9704, 0x80026c02, 0xf03, 0x605, 0x5e04, 0x9806,
+    0xc803, 0xa905, 0x9204, 0x3a08, 0xf03, 0x4105, 0x6104, 0x4807, 0xc803, 0xc205, 0x9704, 0x80027001,
+    0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0xb808, 0xf03, 0x5a05, 0x6104, 0x5907,
+    0xc803, 0x6b06, 0x9704, 0x80027203, 0xf03, 0x605, 0x5e04, 0x8006, 0xc803, 0xa905, 0x9204, 0x2e08,
+    0xf03, 0x4105, 0x6104, 0x3f07, 0xc803, 0xc205, 0x9704, 0xc609, 0xf03, 0x705, 0x5e04, 0xa506,
+    0xc803, 0xae05, 0x9204, 0xa408, 0xf03, 0x5a05, 0x6104, 0x4f07, 0xc803, 0x5306, 0x9704, 0x80027a02,
+    0xf03, 0x605, 0x5e04, 0x9806, 0xc803, 0xa905, 0x9204, 0x5b08, 0xf03, 0x4105, 0x6104, 0x4907,
+    0xc803, 0xc205, 0x9704, 0x80027e01, 0xf03, 0x705, 0x5e04, 0xab06, 0xc803, 0xae05, 0x9204, 0x3609,
+    0xf03, 0x5a05, 0x6104, 0x7207, 0xc803, 0x6b06, 0x9704, 0x80028006, 0x8c0a, 0x960a, 0x840b, 0x910b,
+    0x850b, 0x940b, 0x1a0b, 0x200b, 0x1d0b, 0x220b, 0x2a0a, 0x2f0a, 0x7e0c, 0x9d0c, 0x8e0c, 0xbf0c,
+    0x880c, 0xb90c, 0x9b0c, 0x40d, 0x7e0c, 0x9d0c, 0x8e0c, 0xbf0c, 0x880c, 0xb90c, 0x9b0c, 0xb0d,
+    0xad0a, 0xbc0a, 0x80c, 0x210c, 0x1e0c, 0x240c, 0x190c, 0x230c, 0x1f0c, 0x250c, 0x370b, 0x4d0b,
+    0x420b, 0x600b, 0x440a, 0x650a, 0x990d, 0xd40d, 0xc70d, 0x5f0e, 0xa60d, 0x3c0e, 0xd00d, 0x730e,
+    0x9c0d, 0x2c0e, 0xcb0d, 0x670e, 0xbd0d, 0x500e, 0xd10d, 0x810e, 0x990d, 0xd40d, 0xc70d, 0x630e,
+    0xa60d, 0x450e, 0xd00d, 0x7f0e, 0x9c0d, 0x2d0e, 0xcb0d, 0x6e0e, 0xbd0d, 0x570e, 0xd10d, 0x890e,
+    0x9a0a, 0xa00a, 0xc10b, 0xd90b, 0xd60b, 0xc, 0xc10b, 0xd90b, 0xd60b, 0x10c, 0x270b, 0x2b0b,
+    0x290b, 0x340b, 0x330a, 0x3d0a, 0xe0d, 0x520d, 0x3e0d, 0x8a0d, 0x1c0d, 0x760d, 0x4a0d, 0x8f0d,
+    0x1b0d, 0x580d, 0x470d, 0x8d0d, 0x380d, 0x830d, 0x4c0d, 0x930d, 0xcc0a, 0x50b, 0xcc0a, 0x110b,
+    0x160a, 0x280a, 0x300c, 0x550c, 0x4b0c, 0x700c, 0x430c, 0x6c0c, 0x540c, 0x750c, 0x680b, 0x7c0b,
+    0x710b, 0x7d0b, 0x6d0a, 0x7a0a, 0x950e, 0x560f, 0xd80e, 0xa20f, 0xca0e, 0x770f, 0x150f, 0xb30f,
+    0xba0e, 0x660f, 0x90f, 0xaa0f, 0xd30e, 0x870f, 0x320f, 0xc00f, 0x9f0e, 0x5d0f, 0x20f, 0xa70f,
+    0xce0e, 0x790f, 0x180f, 0xb70f, 0xc30e, 0x6f0f, 0x120f, 0xb10f, 0xd70e, 0x9e0f, 0x460f, 0xd20f,
+    0x950e, 0x5c0f, 0xd80e, 0xa30f, 0xca0e, 0x780f, 0x170f, 0xb50f, 0xba0e, 0x6a0f, 0xd0f, 0xb00f,
+    0xd30e, 0x900f, 0x400f, 0xc50f, 0x9f0e, 0x640f, 0x30f, 0xa80f, 0xce0e, 0x7b0f, 0x260f, 0xbe0f,
+    0xc30e, 0x740f, 0x130f, 0xb20f, 0xd70e, 0xa10f, 0x510f, 0xd50f,
+};
+
+static const huffman_lut abc1_lut = {9, 704, (uint32_t*)abc1_lut_entries};
+
+static const huffman_table abc1_table = {218, (uint8_t*)abc1_n_bits, (uint32_t*)abc1_codes,
+    (huf_offset_t*)abc1_token_offsets, (char*)abc1_strings, (huffman_lut*)&abc1_lut, (huffman_op*)abc1_ops, 1};
+
+#endif
@@ -0,0 +1,337 @@
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "synth.h"
+#include "spsc_ring.h"
+#include "render_pipeline.h"
+
+/* Sent by the decoder after the last tune */
+#define PIPELINE_DONE 0xff
+
+/* A slot of the block ring is [n_samples:u32] [padding] [samples];
+a block with no samples ends the output */
+#define BLOCK_HEADER 8
+
+/* A slot of the event ring */
+typedef struct pipeline_event
+{
+    uint8_t type; /* EVENT_NOTE, EVENT_REST, EVENT_TUNE_END or PIPELINE_DONE */
+    uint8_t pitch;
+    uint32_t duration_us;
+} pipeline_event;
+
+typedef struct pipeline
+{
+    huffman_buffer buffer; /* the decoder's private copy, sharing the table */
+    const uint32_t *tune_index;
+    const uint32_t *tunes;
+    uint32_t n_tunes;
+    const pipeline_config *config;
+    spsc_ring *events, *blocks;
+    pipeline_stats *stats;
+    uint8_t stop; /* set when the output gives up; read with __atomic */
+} pipeline;
+
+void default_pipeline_config(pipeline_config *config)
+{
+    config->event_ring = 1024;
+    config->block_ring = 64;
+    config->block_samples = 1024;
+    config->sample_rate = 44100;
+    config->bits = 16;
+    config->spin = 64;
+    config->sleep_us = 50;
+}
+
+static int check_request(const uint32_t *tune_index, const uint32_t *tunes, uint32_t n_tunes, const pipeline_config *config)
+{
+    uint32_t i;
+    if(config->bits!=8 && config->bits!=16) {
+        printf("Error: samples must be 8 or 16 bits\n");
+        return 0;
+    }
+    if(config->block_samples==0 || config->sample_rate==0) {
+        printf("Error: bad block size or sample rate\n");
+        return 0;
+    }
+    for(i=0; i<n_tunes; i++) {
+        if(tunes[i]>=tune_index[0]) {
+            printf("Error: tune index out of range\n");
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int wait_ring(pipeline *p, uint32_t *polls, uint64_t *waits)
+{
+    /* Back off after finding a ring full or empty. Returns 0 if the
+    pipeline is stopping. */
+    struct timespec t;
+    if(__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE))
+        return 0;
+    if(*polls==0)
+        (*waits)++;
+    if(*polls >= p->config->spin && p->config->sleep_us) {
+        t.tv_sec = p->config->sleep_us/1000000;
+        t.tv_nsec = (p->config->sleep_us%1000000)*1000L;
+        nanosleep(&t, NULL);
+    }
+    else
+        sched_yield();
+    (*polls)++;
+    return 1;
+}
+
+static void push_event(pipeline *p, uint8_t type, uint8_t pitch, uint32_t duration_us)
+{
+    pipeline_event *e;
+    uint32_t polls = 0;
+    while(!(e = (pipeline_event*)ring_reserve(p->events)))
+        if(!wait_ring(p, &polls, &p->stats->decode_waits))
+            return;
+    e->type = type;
+    e->pitch = pitch;
+    e->duration_us = duration_us;
+    ring_publish(p->events);
+}
+
+static void decode_event(tune_context *ctx, uint32_t event_code)
+{
+    /* Pass notes, rests and tune ends to the synth stage */
+    pipeline *p = (pipeline*)ctx->callback_context;
+    switch(event_code) {
+        case EVENT_NOTE:
+            p->stats->events++;
+            push_event(p, EVENT_NOTE, ctx->current_note, ctx->current_duration);
+            break;
+        case EVENT_REST:
+            p->stats->events++;
+            push_event(p, EVENT_REST, 0, ctx->current_duration);
+            break;
+        case EVENT_TUNE_END:
+            push_event(p, EVENT_TUNE_END, 0, 0);
+            break;
+    }
+}
+
+static void *decode_stage(void *arg)
+{
+    pipeline *p = (pipeline*)arg;
+    tune_context *ctx = new_context();
+    uint32_t i;
+    ctx->event_callback = decode_event;
+    ctx->callback_context = p;
+    for(i=0; i<p->n_tunes && !__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE); i++) {
+        p->buffer.pos = p->tune_index[p->tunes[i]+1];
+        begin_tune(ctx);
+        while(step_tune(&p->buffer, ctx))
+            if(__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE))
+                break;
+    }
+    push_event(p, PIPELINE_DONE, 0, 0);
+    free_context(ctx);
+    return NULL;
+}
+
+static uint8_t *next_block(pipeline *p)
+{
+    uint8_t *block;
+    uint32_t polls = 0;
+    while(!(block = ring_reserve(p->blocks)))
+        if(!wait_ring(p, &polls, &p->stats->synth_waits))
+            return NULL;
+    return block;
+}
+
+static void send_block(pipeline *p, uint8_t *block, uint32_t n_samples)
+{
+    *(uint32_t*)block = n_samples;
+    ring_publish(p->blocks);
+}
+
+static void *synth_stage(void *arg)
+{
+    pipeline *p = (pipeline*)arg;
+    const pipeline_config *cfg = p->config;
+    uint32_t sample_bytes = cfg->bits/8, filled = 0, polls, done = 0;
+    square_synth synth;
+    pipeline_event *e;
+    uint8_t *block = NULL;
+
+    init_synth(&synth, cfg->sample_rate, SYNTH_AMPLITUDE);
+    while(!done) {
+        polls = 0;
+        while(!(e = (pipeline_event*)ring_front(p->events)))
+            if(!wait_ring(p, &polls, &p->stats->synth_waits))
+                return NULL;
+        if(e->type==EVENT_NOTE || e->type==EVENT_REST)
+            synth_note(&synth, e->pitch, e->duration_us, e->type==EVENT_REST);
+        done = e->type==PIPELINE_DONE;
+        ring_consume(p->events);
+
+        /* Render the note across as many blocks as it takes */
+        while(synth.samples_left > 0) {
+            if(!block && !(block = next_block(p)))
+                return NULL;
+            filled += synth_render(&synth, block+BLOCK_HEADER+filled*sample_bytes, cfg->block_samples-filled, cfg->bits);
+            if(filled==cfg->block_samples) {
+                send_block(p, block, filled);
+                block = NULL;
+                filled = 0;
+            }
+        }
+    }
+    /* The last, partly filled block, then an empty one to end */
+    if(filled > 0) {
+        send_block(p, block, filled);
+        block = NULL;
+    }
+    if(!block && !(block = next_block(p)))
+        return NULL;
+    send_block(p, block, 0);
+    return NULL;
+}
+
+static int output_stage(pipeline *p, pipeline_output_type output, void *output_context)
+{
+    /* Pass blocks to the output until the empty one */
+    uint8_t *block;
+    uint32_t n_samples, polls;
+    int ok;
+    while(1) {
+        polls = 0;
+        while(!(block = ring_front(p->blocks)))
+            wait_ring(p, &polls, &p->stats->output_waits);
+        n_samples = *(uint32_t*)block;
+        if(n_samples==0) {
+            ring_consume(p->blocks);
+            return 1;
+        }
+        ok = output(output_context, block+BLOCK_HEADER, n_samples*(p->config->bits/8));
+        p->stats->blocks++;
+        p->stats->samples += n_samples;
+        ring_consume(p->blocks);
+        if(!ok) {
+            __atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+}
+
+int render_pipeline(huffman_buffer *buffer, const uint32_t *tune_index, const uint32_t *tunes, uint32_t n_tunes,
+    const pipeline_config *config, pipeline_output_type output, void *output_context, pipeline_stats *stats)
+{
+    /* Render tunes[0..n_tunes) one after another, decoding and
+    synthesising on two threads and calling output from this one.
+    Returns 1 if every block was output. */
+    pipeline p;
+    pthread_t decoder, synthesiser;
+    int ok = 0;
+
+    memset(stats, 0, sizeof(pipeline_stats));
+    if(!check_request(tune_index, tunes, n_tunes, config))
+        return 0;
+    p.buffer = *buffer;
+    p.buffer.stats = NULL; /* the counters are not thread-safe */
+    p.tune_index = tune_index;
+    p.tunes = tunes;
+    p.n_tunes = n_tunes;
+    p.config = config;
+    p.stats = stats;
+    p.stop = 0;
+    p.events = new_spsc_ring(config->event_ring, sizeof(pipeline_event));
+    p.blocks = new_spsc_ring(config->block_ring, BLOCK_HEADER + config->block_samples*(config->bits/8));
+    if(p.events && p.blocks) {
+        if(pthread_create(&decoder, NULL, decode_stage, &p)) {
+            printf("Error: could not start the decode thread\n");
+        }
+        else {
+            if(pthread_create(&synthesiser, NULL, synth_stage, &p)) {
+                printf("Error: could not start the synth thread\n");
+                __atomic_store_n(&p.stop, 1, __ATOMIC_RELEASE);
+            }
+            else {
+                ok = output_stage(&p, output, output_context);
+                pthread_join(synthesiser, NULL);
+            }
+            pthread_join(decoder, NULL);
+        }
+    }
+    if(p.events)
+        free_spsc_ring(p.events);
+    if(p.blocks)
+        free_spsc_ring(p.blocks);
+    return ok;
+}
+
+typedef struct serial_state
+{
+    square_synth synth;
+    pipeline_stats *stats;
+} serial_state;
+
+static void serial_event(tune_context *ctx, uint32_t event_code)
+{
+    serial_state *s = (serial_state*)ctx->callback_context;
+    if(event_code==EVENT_NOTE || event_code==EVENT_REST) {
+        s->stats->events++;
+        synth_note(&s->synth, event_code==EVENT_REST ? 0 : ctx->current_note, ctx->current_duration, event_code==EVENT_REST);
+    }
+}
+
+int render_serial(huffman_buffer *buffer, const uint32_t *tune_index, const uint32_t *tunes, uint32_t n_tunes,
+    const pipeline_config *config, pipeline_output_type output, void *output_context, pipeline_stats *stats)
+{
+    /* Render the same samples as render_pipeline, decoding, synthesising
+    and calling output in turn on this thread. The rings and waits in
+    config are not used. */
+    serial_state s;
+    tune_context *ctx;
+    uint32_t i, filled = 0, sample_bytes = config->bits/8, in_tune;
+    uint8_t *block;
+    int ok = 1;
+
+    memset(stats, 0, sizeof(pipeline_stats));
+    if(!check_request(tune_index, tunes, n_tunes, config))
+        return 0;
+    block = malloc(config->block_samples*sample_bytes);
+    ctx = new_context();
+    ctx->event_callback = serial_event;
+    ctx->callback_context = &s;
+    ctx->stats = buffer->stats;
+    init_synth(&s.synth, config->sample_rate, SYNTH_AMPLITUDE);
+    s.stats = stats;
+    for(i=0; i<n_tunes && ok; i++) {
+        buffer->pos = tune_index[tunes[i]+1];
+        begin_tune(ctx);
+        in_tune = 1;
+        while(in_tune && ok) {
+            in_tune = step_tune(buffer, ctx);
+            while(s.synth.samples_left > 0 && ok) {
+                filled += synth_render(&s.synth, block+filled*sample_bytes, config->block_samples-filled, config->bits);
+                if(filled==config->block_samples) {
+                    ok = output(output_context, block, filled*sample_bytes);
+                    stats->blocks++;
+                    stats->samples += filled;
+                    filled = 0;
+                }
+            }
+        }
+    }
+    if(filled > 0 && ok) {
+        ok = output(output_context, block, filled*sample_bytes);
+        stats->blocks++;
+        stats->samples += filled;
+    }
+    free_context(ctx);
+    free(block);
+    return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef RENDER_PIPELINE_H
+#define RENDER_PIPELINE_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "spsc_ring.h"
+
+/*
+    Renders tunes to samples in three stages on their own threads, so
+    that a slow write does not hold up decoding:
+
+        decode  (thread)  step_tune -> notes and rests -> event ring
+        synth   (thread)  event ring -> synth_note/synth_render -> block ring
+        output  (caller)  block ring -> output callback
+
+    The rings are spsc_rings: each stage may run at most a ring's length
+    ahead of the next, and a stage that finds its ring full (or empty)
+    yields and polls it again config.spin times, then sleeps
+    config.sleep_us between polls (or keeps yielding, if 0), counting
+    each stall in pipeline_stats.
+    Tunes are rendered back to back, with the oscillator's phase
+    carried across them; bars make no sound.
+*/
+
+typedef struct pipeline_config
+{
+    uint32_t event_ring; /* events the decoder may run ahead */
+    uint32_t block_ring; /* blocks the synth may run ahead */
+    uint32_t block_samples; /* samples per block */
+    uint32_t sample_rate;
+    uint8_t bits; /* 8 or 16, as synth_render */
+    uint32_t spin; /* polls of a full or empty ring, yielding between them, before sleeping */
+    uint32_t sleep_us; /* between polls after that; 0 yields instead */
+} pipeline_config;
+
+typedef struct pipeline_stats
+{
+    uint64_t events; /* notes and rests */
+    uint64_t blocks;
+    uint64_t samples;
+    uint64_t decode_waits; /* event ring full */
+    uint64_t synth_waits; /* event ring empty, or block ring full */
+    uint64_t output_waits; /* block ring empty */
+} pipeline_stats;
+
+/* Called with each block of samples; returns 0 to stop rendering */
+typedef int(*pipeline_output_type)(void *output_context, const uint8_t *samples, uint32_t n_bytes);
+
+void default_pipeline_config(pipeline_config *config);
+int render_pipeline(huffman_buffer *buffer, const uint32_t *tune_index, const uint32_t *tunes, uint32_t n_tunes,
+    const pipeline_config *config, pipeline_output_type output, void *output_context, pipeline_stats *stats);
+int render_serial(huffman_buffer *buffer, const uint32_t *tune_index, const uint32_t *tunes, uint32_t n_tunes,
+    const pipeline_config *config, pipeline_output_type output, void *output_context, pipeline_stats *stats);
+
+#endif
@@ -0,0 +1,271 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "synth.h"
+#include "tune_summary.h"
+#include "set_player.h"
+
+void default_set_config(set_config *config)
+{
+    config->sample_rate = 44100;
+    config->bits = 16;
+    config->crossfade_ms = 0;
+    config->gap_bars = 0;
+    config->prefetch_symbols = 16;
+}
+
+static void voice_callback(tune_context *ctx, uint32_t event_code)
+{
+    /* Pass notes and rests to the voice's oscillator */
+    set_voice *v = (set_voice*)ctx->callback_context;
+    if(event_code==EVENT_NOTE)
+        synth_note(&v->synth, ctx->current_note, ctx->current_duration, 0);
+    else if(event_code==EVENT_REST)
+        synth_note(&v->synth, 0, ctx->current_duration, 1);
+}
+
+static void load_voice(set_player *p, set_voice *v, uint32_t slot)
+{
+    /* Set v up to play the tune in slot; nothing is decoded yet */
+    v->buffer = *p->buffer;
+    v->buffer.pos = p->tune_index[p->tunes[slot]+1];
+    init_synth(&v->synth, p->config.sample_rate, SYNTH_AMPLITUDE);
+    v->slot = slot;
+    v->loaded = 1;
+    v->in_tune = 1;
+    v->position = 0;
+    begin_tune(v->ctx);
+}
+
+static int voice_primed(set_voice *v)
+{
+    /* Has the voice decoded as far as its first note? */
+    return v->synth.samples_left > 0 || !v->in_tune;
+}
+
+static void prime_voice(set_voice *v, uint32_t max_symbols)
+{
+    /* Decode up to max_symbols of the voice's tune, stopping once it
+    has a note ready */
+    while(!voice_primed(v) && max_symbols-- > 0)
+        v->in_tune = step_tune(&v->buffer, v->ctx);
+}
+
+static uint32_t voice_render(set_voice *v, uint8_t *dest, uint32_t n_samples, uint8_t bits)
+{
+    /* Render up to n_samples of the voice's tune, decoding notes as the
+    oscillator needs them; fewer only at the end of the tune */
+    uint32_t done = 0;
+    while(done < n_samples) {
+        if(v->synth.samples_left==0) {
+            if(!v->in_tune)
+                break;
+            v->in_tune = step_tune(&v->buffer, v->ctx);
+            continue;
+        }
+        done += synth_render(&v->synth, dest+done*(bits/8), n_samples-done, bits);
+    }
+    v->position += done;
+    return done;
+}
+
+set_player *new_set_player(huffman_buffer *buffer, uint8_t *summaries, const uint32_t *tune_index,
+    const uint32_t *tunes, uint32_t n_tunes, const set_config *config)
+{
+    /* Create a player for tunes[0..n_tunes), summarising each (from
+    the summary section, if given and at config's rate) to find the
+    lengths, gaps and crossfades */
+    set_player *p;
+    tune_summary summary;
+    uint64_t fade = (uint64_t)config->crossfade_ms*config->sample_rate/1000, bar;
+    uint32_t i, v;
+
+    if(config->bits!=8 && config->bits!=16) {
+        printf("Error: samples must be 8 or 16 bits\n");
+        return NULL;
+    }
+    for(i=0; i<n_tunes; i++) {
+        if(tunes[i]>=tune_index[0]) {
+            printf("Error: tune index out of range\n");
+            return NULL;
+        }
+    }
+    p = calloc(1, sizeof(set_player));
+    p->buffer = buffer;
+    p->tune_index = tune_index;
+    p->tunes = tunes;
+    p->n_tunes = n_tunes;
+    p->config = *config;
+    p->lengths = calloc(n_tunes+1, sizeof(uint64_t));
+    p->gaps = calloc(n_tunes+1, sizeof(uint64_t));
+    p->fades = calloc(n_tunes+1, sizeof(uint64_t));
+    for(i=0; i<n_tunes; i++) {
+        get_tune_summary(buffer, summaries, tune_index, tunes[i], config->sample_rate, &summary);
+        p->lengths[i] = summary.n_samples;
+        if(i+1<n_tunes && config->gap_bars) {
+            /* A tune with no bar duration plays quarter bars of a second */
+            bar = summary.bar_duration ? summary.bar_duration : (uint64_t)(1000000/BASE_DURATION);
+            p->gaps[i] = config->gap_bars*bar*config->sample_rate/1000000;
+        }
+    }
+    for(i=0; i+1<n_tunes && fade>0 && !config->gap_bars; i++) {
+        /* At most half of either tune, so fades never overlap */
+        p->fades[i] = fade;
+        if(p->fades[i] > p->lengths[i]/2)
+            p->fades[i] = p->lengths[i]/2;
+        if(p->fades[i] > p->lengths[i+1]/2)
+            p->fades[i] = p->lengths[i+1]/2;
+    }
+    for(v=0; v<2; v++) {
+        p->voices[v].ctx = new_context();
+        p->voices[v].ctx->event_callback = voice_callback;
+        p->voices[v].ctx->callback_context = &p->voices[v];
+        p->voices[v].ctx->stats = buffer->stats;
+    }
+    p->current = 0;
+    for(v=0; v<2 && p->next_slot<n_tunes; v++)
+        load_voice(p, &p->voices[v], p->next_slot++);
+    return p;
+}
+
+void free_set_player(set_player *player)
+{
+    free_context(player->voices[0].ctx);
+    free_context(player->voices[1].ctx);
+    free(player->lengths);
+    free(player->gaps);
+    free(player->fades);
+    free(player);
+}
+
+static void check_primed(set_player *p, set_voice *v)
+{
+    /* The next tune is needed now: finish priming it if need be */
+    if(!voice_primed(v)) {
+        p->late_primes++;
+        prime_voice(v, UINT32_MAX);
+    }
+}
+
+static void next_tune(set_player *p)
+{
+    /* Hand over to the other voice, and load the tune after it into
+    the one that has finished */
+    set_voice *done = &p->voices[p->current];
+    done->loaded = 0;
+    p->current ^= 1;
+    p->transitions++;
+    if(p->next_slot < p->n_tunes)
+        load_voice(p, done, p->next_slot++);
+}
+
+static void end_tune(set_player *p)
+{
+    /* The current tune has run out */
+    set_voice *a = &p->voices[p->current], *b = &p->voices[p->current^1];
+    if(!b->loaded) {
+        a->loaded = 0; /* the end of the set */
+        return;
+    }
+    check_primed(p, b);
+    if(p->gaps[a->slot] > 0) {
+        a->loaded = 0;
+        p->gap_left = p->gaps[a->slot];
+        return;
+    }
+    /* Straight on, with the oscillator's phase carried over */
+    b->synth.phase = a->synth.phase % b->synth.cycle;
+    next_tune(p);
+}
+
+static uint32_t crossfade(set_player *p, uint8_t *dest, uint32_t n_samples)
+{
+    /* Mix the end of the current tune into the start of the next,
+    up to n_samples at a time; returns the number of samples mixed */
+    set_voice *a = &p->voices[p->current], *b = &p->voices[p->current^1];
+    uint16_t mix_a[SET_MIX_BLOCK], mix_b[SET_MIX_BLOCK];
+    uint64_t fade = p->fades[a->slot], j = b->position, level;
+    uint32_t i, k = n_samples < SET_MIX_BLOCK ? n_samples : SET_MIX_BLOCK, got;
+    uint16_t *dest16 = (uint16_t*)dest;
+
+    if(b->position==0)
+        check_primed(p, b);
+    if(k > fade - j)
+        k = fade - j;
+    got = voice_render(a, (uint8_t*)mix_a, k, 16);
+    memset(mix_a+got, 0, (k-got)*sizeof(uint16_t));
+    got = voice_render(b, (uint8_t*)mix_b, k, 16);
+    memset(mix_b+got, 0, (k-got)*sizeof(uint16_t));
+    for(i=0; i<k; i++, j++) {
+        level = (mix_a[i]*(fade-j) + mix_b[i]*j)/fade;
+        if(p->config.bits==8)
+            dest[i] = level>>8;
+        else
+            dest16[i] = level;
+    }
+    if(b->position >= fade)
+        next_tune(p);
+    return k;
+}
+
+uint32_t set_render(set_player *p, uint8_t *dest, uint32_t n_samples)
+{
+    /* Render up to n_samples of the set into dest, as unsigned 8 bit or
+    native-endian 16 bit samples; fewer only at the end of the set */
+    uint32_t done = 0, bytes = p->config.bits/8, k, limit;
+    uint64_t fade, fade_at;
+    set_voice *a, *b = &p->voices[p->current^1];
+
+    /* Decode a little more of the next tune */
+    if(b->loaded)
+        prime_voice(b, p->config.prefetch_symbols);
+    while(done < n_samples) {
+        a = &p->voices[p->current];
+        b = &p->voices[p->current^1];
+        if(p->gap_left > 0) {
+            k = p->gap_left < n_samples-done ? (uint32_t)p->gap_left : n_samples-done;
+            memset(dest+done*bytes, 0, k*bytes);
+            p->gap_left -= k;
+            done += k;
+            if(p->gap_left==0)
+                next_tune(p);
+            continue;
+        }
+        if(!a->loaded)
+            break;
+        limit = n_samples-done;
+        fade = b->loaded ? p->fades[a->slot] : 0;
+        if(fade > 0) {
+            fade_at = p->lengths[a->slot] > fade ? p->lengths[a->slot]-fade : 0;
+            if(a->position >= fade_at) {
+                done += crossfade(p, dest+done*bytes, n_samples-done);
+                continue;
+            }
+            if(fade_at - a->position < limit)
+                limit = fade_at - a->position;
+        }
+        k = voice_render(a, dest+done*bytes, limit, p->config.bits);
+        done += k;
+        if(k < limit)
+            end_tune(p);
+    }
+    return done;
+}
+
+uint64_t set_length(set_player *player)
+{
+    /* The number of samples set_render will produce in all */
+    uint64_t total = 0;
+    uint32_t i;
+    for(i=0; i<player->n_tunes; i++)
+        total += player->lengths[i] + player->gaps[i] - player->fades[i];
+    return total;
+}
+
+int set_finished(set_player *player)
+{
+    return !player->voices[player->current].loaded && player->gap_left==0;
+}
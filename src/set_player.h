@@ -0,0 +1,75 @@
+#ifndef SET_PLAYER_H
+#define SET_PLAYER_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "synth.h"
+
+/*
+    Gapless playback of a set: a list of tunes played one after another
+    into one stream of samples, pulled with set_render as a DAC or
+    writer needs them.
+
+    Two voices (each a decoding cursor, context and oscillator) take
+    turns. While one plays, the other is loaded with the next tune and
+    primed a few symbols per set_render call (the header, up to its
+    first note), so that a change of tune costs no more than any other
+    note. Between tunes the stream either runs straight on, with the
+    oscillator's phase carried over; or crossfades linearly over
+    crossfade_ms, both voices sounding; or pauses for gap_bars bars of
+    the outgoing tune (gap_bars takes precedence). The tunes' lengths
+    are found up front with get_tune_summary, so the crossfades can
+    start on time and set_length is exact before anything is played.
+*/
+
+#define SET_MIX_BLOCK 256 /* samples mixed at a time while crossfading */
+
+typedef struct set_config
+{
+    uint32_t sample_rate;
+    uint8_t bits; /* 8 or 16, as synth_render */
+    uint32_t crossfade_ms; /* 0 for none */
+    uint32_t gap_bars; /* bars of silence between tunes; 0 for none */
+    uint32_t prefetch_symbols; /* most symbols of the next tune decoded per set_render */
+} set_config;
+
+typedef struct set_voice
+{
+    huffman_buffer buffer; /* private copy, sharing the table */
+    tune_context *ctx;
+    square_synth synth;
+    uint32_t slot; /* position of its tune in the set */
+    uint8_t loaded; /* 1 if it holds a tune not yet finished */
+    uint8_t in_tune; /* 1 while there are symbols left to decode */
+    uint64_t position; /* samples rendered */
+} set_voice;
+
+typedef struct set_player
+{
+    huffman_buffer *buffer; /* shared, read only */
+    const uint32_t *tune_index;
+    const uint32_t *tunes;
+    uint32_t n_tunes;
+    set_config config;
+    uint64_t *lengths; /* samples, per slot */
+    uint64_t *gaps; /* silence after each slot, in samples */
+    uint64_t *fades; /* overlap of each slot with the next, in samples */
+    set_voice voices[2];
+    uint8_t current; /* the voice playing */
+    uint32_t next_slot; /* the next tune to load */
+    uint64_t gap_left; /* silence still to play before the next tune */
+    /* statistics */
+    uint32_t transitions;
+    uint32_t late_primes; /* next tunes not primed by the time they were needed */
+} set_player;
+
+void default_set_config(set_config *config);
+set_player *new_set_player(huffman_buffer *buffer, uint8_t *summaries, const uint32_t *tune_index,
+    const uint32_t *tunes, uint32_t n_tunes, const set_config *config);
+void free_set_player(set_player *player);
+uint32_t set_render(set_player *player, uint8_t *dest, uint32_t n_samples);
+uint64_t set_length(set_player *player);
+int set_finished(set_player *player);
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "spsc_ring.h"
+
+spsc_ring *new_spsc_ring(uint32_t capacity, uint32_t slot_size)
+{
+    /* Create a ring of at least capacity slots of slot_size bytes */
+    spsc_ring *ring;
+    uint32_t n = 1;
+    if(capacity==0 || slot_size==0 || capacity>(1u<<24)) {
+        printf("Error: bad ring size %u\n", capacity);
+        return NULL;
+    }
+    while(n<capacity)
+        n <<= 1;
+    ring = calloc(1, sizeof(spsc_ring));
+    ring->slot_size = (slot_size+7) & ~7u;
+    ring->mask = n-1;
+    ring->slots = malloc((size_t)n*ring->slot_size);
+    if(!ring->slots) {
+        printf("Error: could not allocate ring\n");
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void free_spsc_ring(spsc_ring *ring)
+{
+    free(ring->slots);
+    free(ring);
+}
+
+uint8_t *ring_reserve(spsc_ring *ring)
+{
+    /* Producer: the next free slot, or NULL if the ring is full */
+    uint32_t head = ring->head;
+    if(head - ring->tail_cache > ring->mask) {
+        ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if(head - ring->tail_cache > ring->mask)
+            return NULL;
+    }
+    return ring->slots + (size_t)(head & ring->mask)*ring->slot_size;
+}
+
+void ring_publish(spsc_ring *ring)
+{
+    /* Producer: hand the slot from ring_reserve to the consumer */
+    __atomic_store_n(&ring->head, ring->head+1, __ATOMIC_RELEASE);
+}
+
+uint8_t *ring_front(spsc_ring *ring)
+{
+    /* Consumer: the oldest published slot, or NULL if the ring is empty */
+    uint32_t tail = ring->tail;
+    if(tail==ring->head_cache) {
+        ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if(tail==ring->head_cache)
+            return NULL;
+    }
+    return ring->slots + (size_t)(tail & ring->mask)*ring->slot_size;
+}
+
+void ring_consume(spsc_ring *ring)
+{
+    /* Consumer: give the slot from ring_front back to the producer */
+    __atomic_store_n(&ring->tail, ring->tail+1, __ATOMIC_RELEASE);
+}
+
+uint32_t ring_capacity(spsc_ring *ring)
+{
+    return ring->mask+1;
+}
@@ -0,0 +1,46 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+
+/*
+    Lock-free ring of fixed-size slots, for exactly one producer thread
+    and one consumer thread. Slots are written and read in place:
+
+        producer: p = ring_reserve(r); fill p; ring_publish(r);
+        consumer: p = ring_front(r); use p; ring_consume(r);
+
+    ring_reserve returns NULL when the ring is full and ring_front when
+    it is empty; what to do then (spin, sleep, drop) is up to the caller.
+    Each side keeps its own index and a cached copy of the other's, so
+    the shared indices are only read when the cached one runs out.
+    Uses the GCC/Clang __atomic builtins, as C99 has no atomics.
+*/
+
+#define RING_CACHE_LINE 64
+
+typedef struct spsc_ring
+{
+    uint8_t *slots;
+    uint32_t slot_size; /* bytes, rounded up to a multiple of 8 */
+    uint32_t mask; /* capacity-1; the capacity is a power of two */
+    /* producer side */
+    uint8_t pad_0[RING_CACHE_LINE];
+    uint32_t head; /* slots published; written only by the producer */
+    uint32_t tail_cache;
+    /* consumer side */
+    uint8_t pad_1[RING_CACHE_LINE];
+    uint32_t tail; /* slots consumed; written only by the consumer */
+    uint32_t head_cache;
+    uint8_t pad_2[RING_CACHE_LINE];
+} spsc_ring;
+
+spsc_ring *new_spsc_ring(uint32_t capacity, uint32_t slot_size);
+void free_spsc_ring(spsc_ring *ring);
+uint8_t *ring_reserve(spsc_ring *ring);
+void ring_publish(spsc_ring *ring);
+uint8_t *ring_front(spsc_ring *ring);
+void ring_consume(spsc_ring *ring);
+uint32_t ring_capacity(spsc_ring *ring);
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "music_data.h"
+#include "synth.h"
+
+void init_synth(square_synth *synth, uint32_t sample_rate, uint16_t amplitude)
+{
+    /* Set up a silent oscillator in caller-supplied storage */
+    synth->sample_rate = sample_rate;
+    synth->amplitude = amplitude;
+    synth->level = 0;
+    synth->phase = 0;
+    synth->cycle = SYNTH_FREQ_COUNTER;
+    synth->samples_left = 0;
+}
+
+void synth_note(square_synth *synth, uint8_t note, uint32_t duration_us, uint8_t rest)
+{
+    /* Start a note (or, if rest=1, a silence) of duration_us.
+    The phase carries on from the last note. */
+    uint32_t hz = midi_to_hz(note);
+    if(hz==0)
+        hz = 1;
+    synth->samples_left = (uint32_t)((uint64_t)duration_us*synth->sample_rate/1000000);
+    synth->cycle = (uint32_t)((uint64_t)SYNTH_FREQ_COUNTER*synth->sample_rate/hz);
+    if(synth->cycle<SYNTH_FREQ_COUNTER)
+        synth->cycle = SYNTH_FREQ_COUNTER; /* at or above the sample rate */
+    if(synth->phase>=synth->cycle)
+        synth->phase %= synth->cycle;
+    synth->level = rest ? 0 : synth->amplitude;
+}
+
+uint32_t synth_render(square_synth *synth, uint8_t *dest, uint32_t n_samples, uint8_t bits)
+{
+    /* Render up to n_samples of the current note into dest, as unsigned
+    8 bit or native-endian 16 bit samples (bits = 8 or 16), stopping early
+    at the end of the note. Returns the number of samples written. */
+    uint32_t i, phase = synth->phase, cycle = synth->cycle, duty = synth->cycle/2;
+    uint16_t level = synth->level;
+    uint8_t level8 = level>>8;
+    uint16_t *dest16 = (uint16_t*)dest;
+    if(n_samples > synth->samples_left)
+        n_samples = synth->samples_left;
+    if(bits==8) {
+        for(i=0; i<n_samples; i++) {
+            dest[i] = phase<duty ? level8 : 0;
+            phase += SYNTH_FREQ_COUNTER;
+            if(phase>=cycle)
+                phase -= cycle;
+        }
+    }
+    else {
+        for(i=0; i<n_samples; i++) {
+            dest16[i] = phase<duty ? level : 0;
+            phase += SYNTH_FREQ_COUNTER;
+            if(phase>=cycle)
+                phase -= cycle;
+        }
+    }
+    synth->phase = phase;
+    synth->samples_left -= n_samples;
+    return n_samples;
+}
@@ -0,0 +1,29 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+
+/* Fixed-point square wave oscillator, rendering one note at a time
+into 8 or 16 bit sample buffers. Only integer adds and compares are
+done per sample. */
+
+/* Constant to increase frequency resolution; otherwise
+roundoff will introduce detuning errors at high pitches */
+#define SYNTH_FREQ_COUNTER 4096
+#define SYNTH_AMPLITUDE 8192 /* 16 bit level of a note, as the wav writer uses */
+
+typedef struct square_synth
+{
+    uint32_t sample_rate;
+    uint16_t amplitude; /* 16 bit level of a note; 8 bit output uses the top byte */
+    uint16_t level; /* amplitude, or 0 during rests */
+    uint32_t phase; /* position in the cycle, in SYNTH_FREQ_COUNTER units per sample */
+    uint32_t cycle; /* length of a cycle, in the same units */
+    uint32_t samples_left; /* samples still to render of the current note */
+} square_synth;
+
+void init_synth(square_synth *synth, uint32_t sample_rate, uint16_t amplitude);
+void synth_note(square_synth *synth, uint8_t note, uint32_t duration_us, uint8_t rest);
+uint32_t synth_render(square_synth *synth, uint8_t *dest, uint32_t n_samples, uint8_t bits);
+
+#endif
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "title_directory.h"
+#include "binary.h"
+
+/* A title paired with its tune, used while building the directory */
+typedef struct title_entry
+{
+    char title[MAX_NORMALISED_TITLE];
+    uint32_t tune;
+} title_entry;
+
+void normalise_title(const char *title, char *out)
+{
+    /* Normalise a title for matching: lower case letters and digits,
+    with every run of anything else collapsed to a single space, and no
+    leading or trailing space. out must hold MAX_NORMALISED_TITLE bytes. */
+    char *p = out;
+    int space = 0;
+    while(*title && p < out+MAX_NORMALISED_TITLE-1) {
+        if(isalnum((unsigned char)*title)) {
+            if(space && p!=out)
+                *p++ = ' ';
+            if(p < out+MAX_NORMALISED_TITLE-1)
+                *p++ = tolower((unsigned char)*title);
+            space = 0;
+        }
+        else
+            space = 1;
+        title++;
+    }
+    *p = '\0';
+}
+
+static int compare_titles(const void *a, const void *b)
+{
+    return strcmp(((title_entry*)a)->title, ((title_entry*)b)->title);
+}
+
+title_directory *build_title_directory(huffman_buffer *buffer, uint32_t *tune_index)
+{
+    /* Build a title directory in memory by reading the title at the start
+    of every tune. Tunes without a title are left out. Returns NULL if
+    this build does not keep titles. */
+    uint32_t n_tunes = tune_index[0];
+    title_entry *titles;
+    tune_context *ctx;
+    title_directory *dir;
+    uint32_t i, n = 0, length, len;
+    uint8_t *offsets, *p;
+
+    if(MAX_TITLE < 2) {
+        printf("Error: titles are not kept in this build (MAX_TITLE is %d)\n", MAX_TITLE);
+        return NULL;
+    }
+    titles = malloc(sizeof(title_entry)*(n_tunes ? n_tunes : 1));
+    ctx = new_context();
+    for(i=0; i<n_tunes; i++) {
+        seek_to_tune(i, tune_index, buffer);
+        scan_tune_header(buffer, ctx);
+        if(!ctx->has_title)
+            continue;
+        normalise_title(ctx->meta->title, titles[n].title);
+        titles[n].tune = i;
+        n++;
+    }
+    free_context(ctx);
+    qsort(titles, n, sizeof(title_entry), compare_titles);
+
+    /* Serialise into the section format */
+    length = 4 + 4*n;
+    for(i=0; i<n; i++)
+        length += 5 + strlen(titles[i].title);
+    dir = malloc(sizeof(title_directory));
+    dir->n_titles = n;
+    dir->data = malloc(length);
+    dir->length = length;
+    dir->owns_data = 1;
+    offsets = dir->data;
+    writebuf_u32(&offsets, n);
+    p = offsets + 4*n;
+    for(i=0; i<n; i++) {
+        len = strlen(titles[i].title);
+        writebuf_u32(&offsets, p - dir->data);
+        writebuf_u32(&p, titles[i].tune);
+        writebuf_u8(&p, len);
+        memcpy(p, titles[i].title, len);
+        p += len;
+    }
+    free(titles);
+    return dir;
+}
+
+static int compare_entry(uint8_t *entry, const char *title, uint32_t title_len, int prefix);
+
+static int check_title_directory(uint8_t *section, uint32_t length, uint32_t n_tunes)
+{
+    /* 1 if every entry of the section lies within it, names a tune
+    below n_tunes, and the entries are in sorted order */
+    uint8_t *p = section, *entry, *tune, *prev = NULL;
+    uint32_t n, i, offset;
+    if(length < 4)
+        return 0;
+    n = readbuf_u32(&p);
+    if(n > (length-4)/4)
+        return 0;
+    for(i=0; i<n; i++) {
+        offset = readbuf_u32(&p);
+        if(offset < 4 + 4*n || offset > length || length - offset < 5)
+            return 0;
+        entry = section + offset;
+        if(entry[4] > length - offset - 5)
+            return 0;
+        tune = entry;
+        if(readbuf_u32(&tune) >= n_tunes)
+            return 0;
+        if(prev && compare_entry(prev, (char*)entry+5, entry[4], 0) > 0)
+            return 0;
+        prev = entry;
+    }
+    return 1;
+}
+
+title_directory *load_title_directory(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes)
+{
+    /* Use the title directory section in the file, if there is one and
+    it fits the file's n_tunes tunes; otherwise return NULL.
+    The directory points into the file data, which must outlive it. */
+    uint32_t length;
+    uint8_t *p = find_section(buffer, file_end, TITLE_DIRECTORY_TAG, &length);
+    title_directory *dir;
+    if(p==NULL)
+        return NULL;
+    if(!check_title_directory(p, length, n_tunes)) {
+        printf("Error: title directory section does not match the tunes\n");
+        return NULL;
+    }
+    dir = malloc(sizeof(title_directory));
+    dir->data = p;
+    dir->length = length;
+    dir->n_titles = readbuf_u32(&p);
+    dir->owns_data = 0;
+    return dir;
+}
+
+void free_title_directory(title_directory *dir)
+{
+    if(dir->owns_data)
+        free(dir->data);
+    free(dir);
+}
+
+static uint8_t *directory_entry(title_directory *dir, uint32_t i)
+{
+    /* Return a pointer to entry i */
+    uint8_t *p = dir->data + 4 + 4*i;
+    return dir->data + readbuf_u32(&p);
+}
+
+static int compare_entry(uint8_t *entry, const char *title, uint32_t title_len, int prefix)
+{
+    /* Compare entry's title with title, as strcmp. If prefix is set,
+    an entry which starts with title compares equal. */
+    uint32_t len = entry[4];
+    int cmp = memcmp(entry+5, title, len < title_len ? len : title_len);
+    if(cmp!=0)
+        return cmp;
+    if(len < title_len)
+        return -1;
+    if(len > title_len && !prefix)
+        return 1;
+    return 0;
+}
+
+static uint32_t lower_bound(title_directory *dir, const char *title, uint32_t title_len, int prefix)
+{
+    /* Index of the first entry not less than title */
+    uint32_t lo = 0, hi = dir->n_titles, mid;
+    while(lo < hi) {
+        mid = lo + (hi-lo)/2;
+        if(compare_entry(directory_entry(dir, mid), title, title_len, prefix) < 0)
+            lo = mid+1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+uint32_t find_tune_by_title(title_directory *dir, const char *title)
+{
+    /* Return the index of the tune with this title (compared after
+    normalisation), or INVALID_CODE if there is none */
+    char norm[MAX_NORMALISED_TITLE];
+    uint32_t len, i;
+    uint8_t *entry, *p;
+    normalise_title(title, norm);
+    len = strlen(norm);
+    i = lower_bound(dir, norm, len, 0);
+    if(i>=dir->n_titles)
+        return INVALID_CODE;
+    entry = directory_entry(dir, i);
+    if(compare_entry(entry, norm, len, 0)!=0)
+        return INVALID_CODE;
+    p = entry;
+    return readbuf_u32(&p);
+}
+
+uint32_t find_tunes_by_prefix(title_directory *dir, const char *prefix, uint32_t *tunes, uint32_t max_tunes)
+{
+    /* Write the indices of up to max_tunes tunes whose titles start with
+    prefix (after normalisation) to tunes, in title order, and return
+    how many were written */
+    char norm[MAX_NORMALISED_TITLE];
+    uint32_t len, i, n = 0;
+    uint8_t *entry, *p;
+    normalise_title(prefix, norm);
+    len = strlen(norm);
+    for(i=lower_bound(dir, norm, len, 1); i<dir->n_titles && n<max_tunes; i++) {
+        entry = directory_entry(dir, i);
+        if(compare_entry(entry, norm, len, 1)!=0)
+            break;
+        p = entry;
+        tunes[n++] = readbuf_u32(&p);
+    }
+    return n;
+}
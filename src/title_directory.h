@@ -0,0 +1,40 @@
+#ifndef TITLE_DIRECTORY_H
+#define TITLE_DIRECTORY_H
+
+#include <stdint.h>
+#include "huffman.h"
+
+#define TITLE_DIRECTORY_TAG "TDIR"
+#define MAX_NORMALISED_TITLE 256 /* an entry's title length is a u8 */
+
+/*
+    Title directory section payload:
+        [n_titles:u32] [entry offset from start of payload:u32*n_titles] [entries]
+    Each entry:
+        [tune index:u32] [N len of title:u8] [normalised title:u8*N]
+    Entries are sorted by normalised title, so lookups are a binary search
+    over the offsets, directly on the file data. load_title_directory
+    checks the count, offsets, title lengths and tune indices against the
+    section, and the sort order, before any lookup uses them.
+
+    Building needs the titles kept while decoding, so it is refused in
+    builds with MAX_TITLE of 1 (COMPACT); lookups in a directory already
+    in the file still work there.
+*/
+
+typedef struct title_directory
+{
+    uint32_t n_titles;
+    uint8_t *data; /* the section payload */
+    uint32_t length;
+    uint8_t owns_data; /* 1 if data was built in memory rather than found in the file */
+} title_directory;
+
+void normalise_title(const char *title, char *out);
+title_directory *build_title_directory(huffman_buffer *buffer, uint32_t *tune_index);
+title_directory *load_title_directory(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes);
+uint32_t find_tune_by_title(title_directory *dir, const char *title);
+uint32_t find_tunes_by_prefix(title_directory *dir, const char *prefix, uint32_t *tunes, uint32_t max_tunes);
+void free_title_directory(title_directory *dir);
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "tune_cache.h"
+
+/* Decoded-tune cache: a tune's notes, rests and bars are decoded once
+into a flat array of tune_events, and replays iterate that array instead
+of seeking and re-running parse_tune. Chord and key events are not kept. */
+
+/* Growable array of events, filled by record_callback */
+typedef struct event_recorder
+{
+    tune_event *events;
+    uint32_t n_events;
+    uint32_t max_events;
+} event_recorder;
+
+static void record_callback(tune_context *ctx, uint32_t event_code)
+{
+    /* Append notes, rests and bars to the recorder in callback_context */
+    event_recorder *rec = (event_recorder*)ctx->callback_context;
+    tune_event *ev;
+    if(event_code!=EVENT_NOTE && event_code!=EVENT_REST && event_code!=EVENT_BAR)
+        return;
+    if(rec->n_events==rec->max_events) {
+        rec->max_events = rec->max_events ? rec->max_events*2 : 256;
+        rec->events = realloc(rec->events, sizeof(tune_event)*rec->max_events);
+    }
+    ev = &rec->events[rec->n_events++];
+    ev->type = event_code;
+    if(event_code==EVENT_BAR) {
+        ev->pitch = 0;
+        ev->start_us = ctx->bar_start_time;
+        ev->duration_us = 0;
+    }
+    else {
+        /* Rests keep the last note's pitch, as the parser leaves it */
+        ev->pitch = ctx->current_note;
+        ev->start_us = ctx->note_start_time;
+        ev->duration_us = ctx->current_duration;
+    }
+}
+
+tune_cache *new_tune_cache(huffman_buffer *buffer, uint32_t *tune_index, uint32_t budget)
+{
+    /* Create an empty cache for the tunes in buffer, holding at most
+    (about) budget bytes of events */
+    tune_cache *cache = malloc(sizeof(tune_cache));
+    cache->buffer = buffer;
+    cache->tune_index = tune_index;
+    cache->budget = budget;
+    cache->used = 0;
+    cache->head = NULL;
+    cache->tail = NULL;
+    cache->slots = calloc(tune_index[0], sizeof(cached_tune*));
+    cache->ctx = new_context();
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->n_cached = 0;
+    return cache;
+}
+
+static uint32_t entry_size(cached_tune *entry)
+{
+    /* Bytes charged against the budget for one entry */
+    return sizeof(cached_tune) + entry->n_events*sizeof(tune_event);
+}
+
+static void unlink_entry(tune_cache *cache, cached_tune *entry)
+{
+    /* Take entry out of the LRU list */
+    if(entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if(entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+}
+
+static void push_front(tune_cache *cache, cached_tune *entry)
+{
+    /* Make entry the most recently used */
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if(cache->head)
+        cache->head->prev = entry;
+    cache->head = entry;
+    if(cache->tail==NULL)
+        cache->tail = entry;
+}
+
+static void evict(tune_cache *cache)
+{
+    /* Drop the least recently used tune */
+    cached_tune *entry = cache->tail;
+    unlink_entry(cache, entry);
+    cache->slots[entry->tune] = NULL;
+    cache->used -= entry_size(entry);
+    cache->n_cached--;
+    cache->evictions++;
+    free(entry->events);
+    free(entry);
+}
+
+static cached_tune *decode_tune(tune_cache *cache, uint32_t ix)
+{
+    /* Decode tune ix into a new entry */
+    event_recorder rec = {NULL, 0, 0};
+    cached_tune *entry = malloc(sizeof(cached_tune));
+    seek_to_tune(ix, cache->tune_index, cache->buffer);
+    cache->ctx->event_callback = record_callback;
+    cache->ctx->callback_context = &rec;
+    parse_tune_context(cache->buffer, cache->ctx);
+    entry->tune = ix;
+    entry->n_events = rec.n_events;
+    /* Trim to size, so the budget is what is really held */
+    entry->events = rec.n_events ? realloc(rec.events, sizeof(tune_event)*rec.n_events) : rec.events;
+    return entry;
+}
+
+tune_event *cache_get_events(tune_cache *cache, uint32_t ix, uint32_t *n_events)
+{
+    /* Return the events of tune ix, decoding and caching them on a miss.
+    The array belongs to the cache, and is valid until the next call.
+    A tune bigger than the whole budget is still cached, until the next
+    miss evicts it. Returns NULL if ix is out of range. */
+    cached_tune *entry;
+    if(ix>=cache->tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return NULL;
+    }
+    entry = cache->slots[ix];
+    if(entry) {
+        cache->hits++;
+        unlink_entry(cache, entry);
+    }
+    else {
+        cache->misses++;
+        entry = decode_tune(cache, ix);
+        while(cache->tail && cache->used + entry_size(entry) > cache->budget)
+            evict(cache);
+        cache->slots[ix] = entry;
+        cache->used += entry_size(entry);
+        cache->n_cached++;
+    }
+    push_front(cache, entry);
+    *n_events = entry->n_events;
+    return entry->events;
+}
+
+void replay_tune(tune_cache *cache, uint32_t ix, event_callback_type callback, void *callback_context)
+{
+    /* Play tune ix from the cache, firing the same note, rest and bar
+    events as parse_tune, with the context fields they use filled in */
+    uint32_t n_events, i;
+    tune_event *events = cache_get_events(cache, ix, &n_events);
+    tune_context *ctx = cache->ctx;
+    if(events==NULL)
+        return;
+    reset_context(ctx);
+    ctx->event_callback = callback;
+    ctx->callback_context = callback_context;
+    EVENT(ctx, EVENT_TUNE_START);
+    for(i=0; i<n_events; i++) {
+        if(events[i].type==EVENT_BAR) {
+            ctx->bar_count++;
+            ctx->bar_start_time = events[i].start_us;
+            ctx->time = events[i].start_us;
+        }
+        else {
+            ctx->current_note = events[i].pitch;
+            ctx->current_duration = events[i].duration_us;
+            ctx->note_on = events[i].type==EVENT_NOTE;
+            ctx->note_start_time = events[i].start_us;
+            ctx->note_end_time = events[i].start_us + events[i].duration_us;
+            ctx->time = ctx->note_start_time;
+        }
+        EVENT(ctx, events[i].type);
+        if(events[i].type!=EVENT_BAR)
+            ctx->time = ctx->note_end_time;
+    }
+    EVENT(ctx, EVENT_TUNE_END);
+}
+
+void print_cache_stats(tune_cache *cache, FILE *f)
+{
+    /* Write the hit/miss statistics to f, one "name value" pair per line */
+    fprintf(f, "cache_hits %d\n", cache->hits);
+    fprintf(f, "cache_misses %d\n", cache->misses);
+    fprintf(f, "cache_evictions %d\n", cache->evictions);
+    fprintf(f, "cache_tunes %d\n", cache->n_cached);
+    fprintf(f, "cache_bytes %d\n", cache->used);
+    fprintf(f, "cache_budget %d\n", cache->budget);
+}
+
+void free_tune_cache(tune_cache *cache)
+{
+    /* Free the cache and everything in it (but not the buffer or index) */
+    while(cache->tail)
+        evict(cache);
+    free(cache->slots);
+    free_context(cache->ctx);
+    free(cache);
+}
@@ -0,0 +1,51 @@
+#ifndef TUNE_CACHE_H
+#define TUNE_CACHE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+/* One note, rest or bar of a decoded tune */
+typedef struct tune_event
+{
+    uint8_t type; /* EVENT_NOTE, EVENT_REST or EVENT_BAR */
+    uint8_t pitch; /* MIDI note; 0 for bars */
+    uint32_t start_us;
+    uint32_t duration_us; /* 0 for bars */
+} tune_event;
+
+/* A decoded tune held in the cache */
+typedef struct cached_tune
+{
+    uint32_t tune;
+    uint32_t n_events;
+    tune_event *events;
+    struct cached_tune *prev, *next; /* LRU list, most recently used first */
+} cached_tune;
+
+/* Cache of decoded tunes, keyed by tune index, with LRU eviction
+once the events held exceed budget bytes */
+typedef struct tune_cache
+{
+    huffman_buffer *buffer;
+    uint32_t *tune_index;
+    uint32_t budget; /* bytes */
+    uint32_t used; /* bytes */
+    cached_tune *head, *tail;
+    cached_tune **slots; /* by tune index; NULL if not cached */
+    tune_context *ctx; /* used for decoding, and for replay */
+    /* statistics */
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t n_cached;
+} tune_cache;
+
+tune_cache *new_tune_cache(huffman_buffer *buffer, uint32_t *tune_index, uint32_t budget);
+void free_tune_cache(tune_cache *cache);
+tune_event *cache_get_events(tune_cache *cache, uint32_t ix, uint32_t *n_events);
+void replay_tune(tune_cache *cache, uint32_t ix, event_callback_type callback, void *callback_context);
+void print_cache_stats(tune_cache *cache, FILE *f);
+
+#endif
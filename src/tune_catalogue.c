@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "tune_catalogue.h"
+#include "binary.h"
+
+/* Catalogue of tune metadata (title, key, meter, rhythm, bar duration),
+read either from the metadata section without any decoding, or by
+scanning only the header of each tune. */
+
+int check_tune_index(const uint32_t *index, uint32_t n_words, uint32_t n_bits)
+{
+    /* 1 if the n_words at index are a tune index for n_bits of data: a
+    count that matches, and offsets in increasing order within the data */
+    uint32_t i;
+    if(n_words < 1 || index[0] != n_words-1)
+        return 0;
+    for(i=1; i<n_words; i++)
+        if(index[i] >= n_bits || (i>1 && index[i] <= index[i-1]))
+            return 0;
+    return 1;
+}
+
+uint32_t *load_tune_index(huffman_buffer *buffer, uint8_t *file_end)
+{
+    /* Return a copy of the tune index section if the file has one that
+    fits the data, otherwise build the index with create_tune_index */
+    uint32_t length;
+    uint8_t *p = find_section(buffer, file_end, TUNE_INDEX_TAG, &length);
+    uint32_t *index;
+    uint32_t i, n;
+    if(p==NULL)
+        return create_tune_index(buffer);
+    n = length/4;
+    index = malloc(sizeof(uint32_t)*(n ? n : 1));
+    for(i=0; i<n; i++)
+        index[i] = readbuf_u32(&p);
+    if(length%4 || !check_tune_index(index, n, buffer->n_bits)) {
+        printf("Error: tune index section does not match the data; rebuilding it\n");
+        free(index);
+        return create_tune_index(buffer);
+    }
+    return index;
+}
+
+uint8_t *build_index_section(uint32_t *tune_index, uint32_t *length)
+{
+    /* Return a malloc'd tune index section payload, setting *length */
+    uint32_t i, n = tune_index[0]+1;
+    uint8_t *data = malloc(4*n);
+    uint8_t *p = data;
+    for(i=0; i<n; i++)
+        writebuf_u32(&p, tune_index[i]);
+    *length = 4*n;
+    return data;
+}
+
+static uint8_t *write_field(uint8_t *p, char *field)
+{
+    /* Write a length-prefixed string */
+    uint8_t len = strlen(field);
+    *p++ = len;
+    memcpy(p, field, len);
+    return p + len;
+}
+
+uint8_t *build_metadata_section(huffman_buffer *buffer, uint32_t *tune_index, uint32_t *length)
+{
+    /* Scan the header of every tune, and return a malloc'd metadata
+    section payload, setting *length */
+    uint32_t n_tunes = tune_index[0];
+    /* Records are at most 4+2+(1+5)+(1+MAX_RHYTHM)+(1+MAX_TITLE) bytes */
+    uint32_t max_record = 14 + MAX_RHYTHM + MAX_TITLE;
+    uint8_t *data = malloc(4 + n_tunes*(4+max_record));
+    uint8_t *offsets = data;
+    uint8_t *p = data + 4 + 4*n_tunes;
+    tune_context *ctx = new_context();
+    uint32_t i;
+
+    writebuf_u32(&offsets, n_tunes);
+    for(i=0; i<n_tunes; i++) {
+        seek_to_tune(i, tune_index, buffer);
+        scan_tune_header(buffer, ctx);
+        writebuf_u32(&offsets, p - data);
+        writebuf_u32(&p, ctx->meta->bar_duration);
+        writebuf_u8(&p, ctx->meta->meter_numerator);
+        writebuf_u8(&p, ctx->meta->meter_denominator);
+        p = write_field(p, ctx->meta->key);
+        p = write_field(p, ctx->meta->rhythm);
+        p = write_field(p, ctx->meta->title);
+    }
+    free_context(ctx);
+    *length = p - data;
+    return data;
+}
+
+static uint8_t *read_field(uint8_t *p, char *field, uint32_t max_len)
+{
+    /* Read a length-prefixed string into field, truncating to fit max_len bytes */
+    uint8_t len = *p++;
+    uint32_t n = len < max_len ? len : max_len-1;
+    memcpy(field, p, n);
+    field[n] = '\0';
+    return p + len;
+}
+
+static int check_metadata_section(uint8_t *section, uint32_t length, uint32_t n_tunes)
+{
+    /* 1 if the section has a record for each of n_tunes tunes, every one
+    lying within it */
+    uint8_t *p = section, *record;
+    uint32_t i, k, offset;
+    if(length < 4 || readbuf_u32(&p) != n_tunes || n_tunes > (length-4)/4)
+        return 0;
+    for(i=0; i<n_tunes; i++) {
+        offset = readbuf_u32(&p);
+        /* the fixed part, then three length-prefixed fields */
+        if(offset < 4 + 4*n_tunes || offset > length || length - offset < 6)
+            return 0;
+        record = section + offset + 6;
+        for(k=0; k<3; k++) {
+            if(record >= section+length || *record > section+length-record-1)
+                return 0;
+            record += 1 + *record;
+        }
+    }
+    return 1;
+}
+
+uint8_t *load_metadata_section(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes)
+{
+    /* The metadata section payload, or NULL if the file has none or it
+    does not fit n_tunes tunes */
+    uint32_t length;
+    uint8_t *section = find_section(buffer, file_end, TUNE_METADATA_TAG, &length);
+    if(section!=NULL && !check_metadata_section(section, length, n_tunes)) {
+        printf("Error: metadata section does not match the tunes\n");
+        return NULL;
+    }
+    return section;
+}
+
+void read_tune_metadata(uint8_t *section, uint32_t ix, tune_metadata *meta)
+{
+    /* Fill meta with the record for tune ix from a metadata section
+    payload, which must have been checked by load_metadata_section */
+    uint8_t *p = section + 4 + 4*ix;
+    p = section + readbuf_u32(&p);
+    meta->bar_duration = readbuf_u32(&p);
+    meta->meter_numerator = readbuf_u8(&p);
+    meta->meter_denominator = readbuf_u8(&p);
+    p = read_field(p, meta->key, sizeof(meta->key));
+    p = read_field(p, meta->rhythm, MAX_RHYTHM);
+    read_field(p, meta->title, MAX_TITLE);
+    strcpy(meta->chord, "");
+    meta->chord_type = NULL;
+}
+
+tune_metadata *read_catalogue(huffman_buffer *buffer, uint8_t *file_end, uint32_t *tune_index)
+{
+    /* Return a malloc'd array with the metadata of every tune. This uses the
+    metadata section if the file has one that fits; otherwise it decodes
+    only the start of each tune, seeking to the next with tune_index. */
+    uint32_t n_tunes = tune_index[0];
+    tune_metadata *catalogue = malloc(sizeof(tune_metadata)*(n_tunes ? n_tunes : 1));
+    uint32_t i;
+    uint8_t *section = load_metadata_section(buffer, file_end, n_tunes);
+    tune_context *ctx;
+
+    if(section!=NULL) {
+        for(i=0; i<n_tunes; i++)
+            read_tune_metadata(section, i, &catalogue[i]);
+        return catalogue;
+    }
+    ctx = new_context();
+    for(i=0; i<n_tunes; i++) {
+        seek_to_tune(i, tune_index, buffer);
+        scan_tune_header(buffer, ctx);
+        catalogue[i] = *ctx->meta;
+        catalogue[i].chord_type = NULL;
+    }
+    free_context(ctx);
+    return catalogue;
+}
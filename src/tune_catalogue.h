@@ -0,0 +1,32 @@
+#ifndef TUNE_CATALOGUE_H
+#define TUNE_CATALOGUE_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+#define TUNE_INDEX_TAG "TIDX"
+#define TUNE_METADATA_TAG "TMET"
+
+/*
+    Tune index section payload, exactly as create_tune_index returns it:
+        [n_tunes:u32] [bit offset of tune:u32*n_tunes]
+    Tune metadata section payload:
+        [n_tunes:u32] [record offset from start of payload:u32*n_tunes] [records]
+    Each record:
+        [bar_duration:u32] [meter_numerator:u8] [meter_denominator:u8]
+        [N:u8] [key:u8*N] [N:u8] [rhythm:u8*N] [N:u8] [title:u8*N]
+    Both are checked against the data before use (offsets within it and
+    increasing, records within the section); a section that does not fit
+    is ignored, and the index rebuilt or the tunes scanned instead.
+*/
+
+int check_tune_index(const uint32_t *index, uint32_t n_words, uint32_t n_bits);
+uint32_t *load_tune_index(huffman_buffer *buffer, uint8_t *file_end);
+uint8_t *build_index_section(uint32_t *tune_index, uint32_t *length);
+uint8_t *build_metadata_section(huffman_buffer *buffer, uint32_t *tune_index, uint32_t *length);
+uint8_t *load_metadata_section(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes);
+void read_tune_metadata(uint8_t *section, uint32_t ix, tune_metadata *meta);
+tune_metadata *read_catalogue(huffman_buffer *buffer, uint8_t *file_end, uint32_t *tune_index);
+
+#endif
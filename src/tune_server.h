@@ -0,0 +1,31 @@
+#ifndef TUNE_SERVER_H
+#define TUNE_SERVER_H
+
+/*
+    Protocol between huf_server and its clients (such as huf_load), over
+    a Unix domain stream socket. Requests are text lines:
+        BOOKS                  one line per book: "<book>\t<n_tunes>\t<file name>"
+        LIST <book>            one line per tune: "<tune>\t<title>"
+        EVENTS <book> <tune>   the notes, rests and bars of a tune, as records
+        PCM <book> <tune>      the tune synthesised as unsigned 16 bit mono samples
+                               at SERVER_SAMPLE_RATE, as synth_render writes them
+    A connection may send any number of requests; they are answered in
+    order. A client that shuts down its sending side still gets the
+    answers to the requests it sent, then the server closes. Each response is a sequence of chunks,
+        [length:u32] [payload:u8*length]
+    ending with an empty chunk. The first chunk is "OK", or "ERR <message>"
+    with no chunks after it except the empty one.
+    Event records are:
+        [type:u8] [pitch:u8] [start_us:u32] [duration_us:u32]
+    with the type an EVENT_ code and fields as in tune_event (tune_cache.h).
+    Lengths and event fields are little-endian; samples are in the
+    server's byte order.
+*/
+
+#define DEFAULT_SOCKET "/tmp/huf_server.sock"
+#define SERVER_SAMPLE_RATE 22050
+#define MAX_REQUEST 256 /* longest request line */
+#define SERVER_CHUNK 4096 /* largest chunk payload the server sends */
+#define EVENT_RECORD_BYTES 10
+
+#endif
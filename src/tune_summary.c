@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+#include "huffman_sections.h"
+#include "tune_summary.h"
+#include "binary.h"
+
+/* Per-tune duration, sample count, note range, bars and tempo changes,
+from a single pass that follows only timing and pitch, or read from the
+summary section without decoding anything. */
+
+static void add_note(tune_summary *summary, uint8_t note, uint32_t duration_us, int rest)
+{
+    summary->duration_us += duration_us;
+    /* Rounded per note, as synth_note does */
+    summary->n_samples += (uint64_t)duration_us*summary->sample_rate/1000000;
+    if(rest) {
+        summary->n_rests++;
+        return;
+    }
+    if(summary->n_notes==0 || note<summary->min_note)
+        summary->min_note = note;
+    if(summary->n_notes==0 || note>summary->max_note)
+        summary->max_note = note;
+    summary->n_notes++;
+}
+
+void summarise_tune(huffman_buffer *buffer, uint32_t sample_rate, tune_summary *summary)
+{
+    /* Summarise the tune at the current position, leaving the buffer
+    after it. Times and pitches follow execute_op exactly, but no events
+    are fired and no text is kept; title and rhythm strings are skipped. */
+    huffman_table *table = buffer->table;
+    uint32_t nl = lookup_symbol_index(TUNE_TERMINATOR, table);
+    uint32_t string_end = lookup_symbol_index(STRING_TERMINATOR, table);
+    uint32_t symbol, duration = 1000000, n_bar_durations = 0;
+    uint8_t note = BASE_NOTE;
+    int in_string = 0;
+    huffman_op parsed, *op;
+    char *name;
+
+    memset(summary, 0, sizeof(tune_summary));
+    summary->sample_rate = sample_rate;
+    while((symbol = read_symbol(buffer))!=nl) {
+        if(symbol==INVALID_CODE) {
+            printf("Error: invalid code\n");
+            break;
+        }
+        if(in_string) {
+            in_string = symbol!=string_end;
+            continue;
+        }
+        if(table->ops)
+            op = &table->ops[symbol];
+        else {
+            parse_op(TOKEN_STRING(table, symbol), &parsed);
+            op = &parsed;
+        }
+        switch(op->op) {
+            case '*':
+                name = TOKEN_STRING(table, symbol)+1;
+                in_string = !strcmp(name, "title") || !strcmp(name, "rhythm");
+                break;
+            case '^':
+                if(n_bar_durations++==0)
+                    summary->bar_duration = op->a;
+                duration = op->a * BASE_DURATION;
+                break;
+            case '|':
+                summary->n_bars++;
+                break;
+            case '+':
+                note += op->a;
+                add_note(summary, note, duration, 0);
+                break;
+            case '-':
+                note -= op->a;
+                add_note(summary, note, duration, 0);
+                break;
+            case '~':
+                add_note(summary, note, duration, 1);
+                break;
+            case '/':
+                duration *= op->a;
+                duration /= op->b;
+                break;
+        }
+    }
+    summary->n_tempo_changes = n_bar_durations>0 ? n_bar_durations-1 : 0;
+}
+
+uint8_t *build_summary_section(huffman_buffer *buffer, uint32_t *tune_index, uint32_t *length)
+{
+    /* Summarise every tune, and return a malloc'd summary section
+    payload, setting *length */
+    uint32_t i, n_tunes = tune_index[0];
+    uint8_t *data = malloc(4 + n_tunes*SUMMARY_RECORD_BYTES);
+    uint8_t *p = data;
+    tune_summary summary;
+
+    writebuf_u32(&p, n_tunes);
+    for(i=0; i<n_tunes; i++) {
+        seek_to_tune(i, tune_index, buffer);
+        summarise_tune(buffer, SUMMARY_SAMPLE_RATE, &summary);
+        writebuf_u32(&p, (uint32_t)summary.duration_us);
+        writebuf_u32(&p, (uint32_t)summary.n_samples);
+        writebuf_u32(&p, summary.n_notes);
+        writebuf_u32(&p, summary.n_rests);
+        writebuf_u32(&p, summary.n_bars);
+        writebuf_u32(&p, summary.bar_duration);
+        writebuf_u32(&p, summary.n_tempo_changes);
+        writebuf_u8(&p, summary.min_note);
+        writebuf_u8(&p, summary.max_note);
+    }
+    *length = p - data;
+    return data;
+}
+
+uint8_t *load_summary_section(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes)
+{
+    /* Return the summary section payload, in place, or NULL if the file
+    has none or it does not cover n_tunes tunes */
+    uint32_t length;
+    uint8_t *section = find_section(buffer, file_end, TUNE_SUMMARY_TAG, &length);
+    uint8_t *p = section;
+    if(section==NULL)
+        return NULL;
+    if(length!=4+(uint64_t)n_tunes*SUMMARY_RECORD_BYTES || readbuf_u32(&p)!=n_tunes) {
+        printf("Error: tune summary section does not match the tunes\n");
+        return NULL;
+    }
+    return section;
+}
+
+void read_tune_summary(uint8_t *section, uint32_t ix, tune_summary *summary)
+{
+    /* Read the record for tune ix from a summary section */
+    uint8_t *p = section + 4 + ix*SUMMARY_RECORD_BYTES;
+    summary->sample_rate = SUMMARY_SAMPLE_RATE;
+    summary->duration_us = readbuf_u32(&p);
+    summary->n_samples = readbuf_u32(&p);
+    summary->n_notes = readbuf_u32(&p);
+    summary->n_rests = readbuf_u32(&p);
+    summary->n_bars = readbuf_u32(&p);
+    summary->bar_duration = readbuf_u32(&p);
+    summary->n_tempo_changes = readbuf_u32(&p);
+    summary->min_note = readbuf_u8(&p);
+    summary->max_note = readbuf_u8(&p);
+}
+
+void get_tune_summary(huffman_buffer *buffer, uint8_t *section, const uint32_t *tune_index, uint32_t ix, uint32_t sample_rate, tune_summary *summary)
+{
+    /* Summarise tune ix from the section if there is one and its sample
+    counts are at sample_rate, otherwise with summarise_tune on a private
+    copy of the buffer (whose position is left alone) */
+    huffman_buffer copy;
+    if(section && sample_rate==SUMMARY_SAMPLE_RATE) {
+        read_tune_summary(section, ix, summary);
+        return;
+    }
+    copy = *buffer;
+    copy.pos = tune_index[ix+1];
+    summarise_tune(&copy, sample_rate, summary);
+}
@@ -0,0 +1,40 @@
+#ifndef TUNE_SUMMARY_H
+#define TUNE_SUMMARY_H
+
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+#define TUNE_SUMMARY_TAG "TSUM"
+#define SUMMARY_SAMPLE_RATE 44100 /* the rate of the sample counts in the section */
+#define SUMMARY_RECORD_BYTES 30
+
+/*
+    Tune summary section payload:
+        [n_tunes:u32] [record:u8*SUMMARY_RECORD_BYTES*n_tunes]
+    Each record:
+        [duration_us:u32] [n_samples at SUMMARY_SAMPLE_RATE:u32]
+        [n_notes:u32] [n_rests:u32] [n_bars:u32] [bar_duration:u32]
+        [n_tempo_changes:u32] [min_note:u8] [max_note:u8]
+*/
+
+typedef struct tune_summary
+{
+    uint64_t duration_us; /* of all the notes and rests */
+    uint64_t n_samples; /* at sample_rate, each note rounded as synth_note does */
+    uint32_t sample_rate;
+    uint32_t n_notes;
+    uint32_t n_rests;
+    uint32_t n_bars;
+    uint32_t bar_duration; /* the first one given, in microseconds */
+    uint32_t n_tempo_changes; /* bar durations given after the first */
+    uint8_t min_note, max_note; /* MIDI notes; both 0 if there are no notes */
+} tune_summary;
+
+void summarise_tune(huffman_buffer *buffer, uint32_t sample_rate, tune_summary *summary);
+uint8_t *build_summary_section(huffman_buffer *buffer, uint32_t *tune_index, uint32_t *length);
+uint8_t *load_summary_section(huffman_buffer *buffer, uint8_t *file_end, uint32_t n_tunes);
+void read_tune_summary(uint8_t *section, uint32_t ix, tune_summary *summary);
+void get_tune_summary(huffman_buffer *buffer, uint8_t *section, const uint32_t *tune_index, uint32_t ix, uint32_t sample_rate, tune_summary *summary);
+
+#endif
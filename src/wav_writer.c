@@ -9,22 +9,12 @@ with plain square wave oscillators for notes */
 #include "huffman_tunes.h"
 #include "music_data.h"
 #include "binary.h"
-
-typedef struct wav_context
-{
-    FILE *f;
-    uint32_t sample_rate;
-    uint32_t n_channels;
-    uint32_t bits_per_sample;
-    uint32_t n_samples;
-} wav_context;
-
-
+#include "tune_summary.h"
+#include "wav_writer.h"
 
 void write_header(wav_context *ctx)
 {
-    /* Write the WAV header to the file */
-    fseek(ctx->f, 0, SEEK_SET);
+    /* Write the WAV header, for n_samples, at the current position */
     write_bytes(ctx->f, "RIFF", 4);
     write_u32(ctx->f, ctx->n_samples*ctx->n_channels*ctx->bits_per_sample/8+36);
     write_bytes(ctx->f, "WAVE", 4);
@@ -49,6 +39,9 @@ wav_context *open_wav(char *fname, uint32_t sample_rate, uint32_t n_channels, ui
     ctx->n_channels = n_channels;
     ctx->bits_per_sample = bits_per_sample;
     ctx->n_samples = 0;
+    ctx->expected_samples = 0;
+    ctx->streaming = 0;
+    ctx->stats = NULL;
     write_header(ctx); /* DUMMY HEADER */
     return ctx;
 }
@@ -56,11 +49,42 @@ wav_context *open_wav(char *fname, uint32_t sample_rate, uint32_t n_channels, ui
 void finalise_wav(wav_context *ctx)
 {
     /* Finalise the WAV file */
+    fseek(ctx->f, 0, SEEK_SET);
     write_header(ctx); /* Real header */
     fclose(ctx->f);
     free(ctx);
 }
 
+wav_context *stream_wav(FILE *f, uint32_t sample_rate, uint32_t n_channels, uint32_t bits_per_sample, uint32_t n_samples)
+{
+    /* Start a WAV stream of exactly n_samples on an open file, writing
+    the final header straight away; nothing is ever seeked, so f can
+    be a pipe or socket */
+    wav_context *ctx = malloc(sizeof(wav_context));
+    ctx->f = f;
+    ctx->sample_rate = sample_rate;
+    ctx->n_channels = n_channels;
+    ctx->bits_per_sample = bits_per_sample;
+    ctx->n_samples = n_samples;
+    write_header(ctx);
+    ctx->n_samples = 0;
+    ctx->expected_samples = n_samples;
+    ctx->streaming = 1;
+    ctx->stats = NULL;
+    return ctx;
+}
+
+int end_wav_stream(wav_context *ctx)
+{
+    /* Free a stream from stream_wav, leaving the file open. Returns 0
+    if the samples written do not match the header. */
+    int ok = ctx->n_samples==ctx->expected_samples;
+    if(!ok)
+        printf("Error: wrote %u samples, but the header says %u\n", ctx->n_samples, ctx->expected_samples);
+    free(ctx);
+    return ok;
+}
+
 /* Constant to increase frequency resolution; otherwise
 roundoff will introduce detuning errors at high pitches */
 #define FREQ_COUNTER 4096
@@ -69,7 +93,7 @@ roundoff will introduce detuning errors at high pitches */
     if rest=1, the note is silent.  */
 void write_note(wav_context *wav, uint8_t note, uint32_t duration_us, uint8_t rest)
 {
-    uint64_t n_samples = (duration_us/1000)*wav->sample_rate/1000;    
+    uint64_t n_samples = (uint64_t)duration_us*wav->sample_rate/1000000; /* as synth_note */
     uint32_t hz = midi_to_hz(note);
     uint32_t cycle = FREQ_COUNTER*wav->sample_rate/hz;
     uint32_t duty_cycle = cycle/2;
@@ -88,6 +112,7 @@ void write_note(wav_context *wav, uint8_t note, uint32_t duration_us, uint8_t re
         wav->n_samples++; 
         k += FREQ_COUNTER;
     }        
+    STAT_ADD(wav->stats, samples_written, n_samples);
 }
 
 
@@ -110,19 +135,51 @@ void wav_callback(tune_context *ctx, uint32_t event_code)
         case EVENT_BAR:
             write_u16(wav->f, 32767); /* Write a click to the WAV file */
             write_u16(wav->f, 0); /* Write a click to the WAV file */
-            wav->n_samples++;
+            wav->n_samples += 2;
             
             break;
         case EVENT_TUNE_START:
             /* The tune has started */
-            /* Open a WAV file for writing */
-            wav = open_wav("tune.wav", 44100, 1, 16);
-            ctx->callback_context = wav;
+            /* Open a WAV file for writing, unless we were given a stream */
+            if(wav==NULL) {
+                wav = open_wav("tune.wav", 44100, 1, 16);
+                wav->stats = ctx->stats;
+                ctx->callback_context = wav;
+            }
             break;
         case EVENT_TUNE_END:
             /* The tune has ended */
-            /* Finalise the WAV file */
-            finalise_wav(wav);
+            /* Finalise the WAV file; a stream is ended by its owner */
+            if(!wav->streaming) {
+                finalise_wav(wav);
+                ctx->callback_context = NULL;
+            }
             break;
     }
+}
+
+int write_tune_wav(huffman_buffer *buffer, uint8_t *summary_section, const uint32_t *tune_index, uint32_t ix, FILE *f)
+{
+    /* Write tune ix to f as a 44.1kHz 16 bit WAV, as wav_callback would,
+    but with the sizes in the header known before any samples are
+    written, from the tune's summary. Returns 0 on error. */
+    tune_summary summary;
+    tune_context *ctx;
+    wav_context *wav;
+    if(ix>=tune_index[0]) {
+        printf("Error: tune index out of range\n");
+        return 0;
+    }
+    get_tune_summary(buffer, summary_section, tune_index, ix, 44100, &summary);
+    /* Each bar adds a two sample click */
+    wav = stream_wav(f, 44100, 1, 16, (uint32_t)(summary.n_samples + 2*summary.n_bars));
+    wav->stats = buffer->stats;
+    ctx = new_context();
+    ctx->event_callback = wav_callback;
+    ctx->callback_context = wav;
+    ctx->stats = buffer->stats;
+    buffer->pos = tune_index[ix+1];
+    parse_tune_context(buffer, ctx);
+    free_context(ctx);
+    return end_wav_stream(wav);
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huffman.h"
+#include "huffman_tunes.h"
+
+/* WAV output of tunes as plain square waves. open_wav/finalise_wav
+write a placeholder header and seek back to fix it at the end;
+stream_wav writes the final header first, for outputs that cannot seek,
+given the sample count (from a tune_summary). */
+
+typedef struct wav_context
+{
+    FILE *f;
+    uint32_t sample_rate;
+    uint32_t n_channels;
+    uint32_t bits_per_sample;
+    uint32_t n_samples;
+    uint32_t expected_samples; /* streams: the count in the header */
+    uint8_t streaming; /* 1 if made by stream_wav */
+    huf_stats *stats;
+} wav_context;
+
+wav_context *open_wav(char *fname, uint32_t sample_rate, uint32_t n_channels, uint32_t bits_per_sample);
+void finalise_wav(wav_context *ctx);
+wav_context *stream_wav(FILE *f, uint32_t sample_rate, uint32_t n_channels, uint32_t bits_per_sample, uint32_t n_samples);
+int end_wav_stream(wav_context *ctx);
+void write_header(wav_context *ctx);
+void write_note(wav_context *wav, uint8_t note, uint32_t duration_us, uint8_t rest);
+void wav_callback(tune_context *ctx, uint32_t event_code);
+int write_tune_wav(huffman_buffer *buffer, uint8_t *summary_section, const uint32_t *tune_index, uint32_t ix, FILE *f);
+
+#endif